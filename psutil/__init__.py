@@ -24,13 +24,16 @@ import collections
 import contextlib
 import datetime
 import functools
+import heapq
 import os
+import re
 import signal
 import socket
 import subprocess
 import sys
 import threading
 import time
+import types
 import warnings
 from typing import TYPE_CHECKING as _TYPE_CHECKING
 
@@ -55,11 +58,14 @@ from ._common import WINDOWS
 from ._common import AccessDenied
 from ._common import Error
 from ._common import NoSuchProcess
+from ._common import ScanContext as _ScanContext
 from ._common import TimeoutExpired
 from ._common import ZombieProcess
 from ._common import bytes2human
+from ._common import call_with_timeout as _call_with_timeout
 from ._common import debug
 from ._common import memoize_when_activated
+from ._common import memoize_when_scanning as _memoize_when_scanning
 from ._common import warn
 from ._common import wrap_numbers as _wrap_numbers
 from ._enums import BatteryTime
@@ -72,6 +78,7 @@ if _TYPE_CHECKING:
     from typing import Any
     from typing import Callable
     from typing import Generator
+    from typing import Iterable
     from typing import Iterator
 
     from ._ntuples import pconn
@@ -90,6 +97,7 @@ if _TYPE_CHECKING:
     from ._ntuples import popenfile
     from ._ntuples import ppagefaults
     from ._ntuples import pthread
+    from ._ntuples import pthreadinfo
     from ._ntuples import puids
     from ._ntuples import sbattery
     from ._ntuples import sconn
@@ -97,13 +105,17 @@ if _TYPE_CHECKING:
     from ._ntuples import scpustats
     from ._ntuples import scputimes
     from ._ntuples import sdiskio
+    from ._ntuples import sdiskiostats
     from ._ntuples import sdiskpart
     from ._ntuples import sdiskusage
+    from ._ntuples import sdiskusagefull
     from ._ntuples import sfan
     from ._ntuples import shwtemp
     from ._ntuples import snetio
     from ._ntuples import snicaddr
     from ._ntuples import snicstats
+    from ._ntuples import sopenfile
+    from ._ntuples import sprocgroup
     from ._ntuples import sswap
     from ._ntuples import suser
     from ._ntuples import svmem
@@ -229,6 +241,9 @@ else:  # pragma: no cover
 
 from . import _psutil
 
+if POSIX:
+    from . import _psposix
+
 # fmt: off
 __all__ = [
     # exceptions
@@ -244,10 +259,11 @@ __all__ = [
     "SUNOS", "WINDOWS", "AIX",
 
     # classes
-    "Process", "Popen",
+    "Process", "Popen", "ProcessTree",
 
     # functions
     "pid_exists", "pids", "process_iter", "wait_procs",             # proc
+    "top_processes", "process_rollup",
     "virtual_memory", "swap_memory",                                # memory
     "cpu_times", "cpu_percent", "cpu_times_percent", "cpu_count",   # cpu
     "cpu_stats", "getloadavg",  # "cpu_freq",
@@ -297,6 +313,7 @@ _timer = getattr(time, 'monotonic', time.time)
 _TOTAL_PHYMEM = None
 _LOWEST_PID = None
 _SENTINEL = object()
+_NO_PREFETCH = types.MappingProxyType({})
 
 # Sanity check in case the user messed up with psutil installation
 # or did something weird with sys.path. In this case we might end
@@ -345,6 +362,70 @@ else:  # pragma: no cover
         return ret
 
 
+if hasattr(_psplatform, 'proc_tree_scan'):
+    # Faster version (Linux).
+    _proc_tree_scan = _psplatform.proc_tree_scan
+else:
+
+    def _proc_tree_scan():
+        """Return a list of `(pid, ppid, create_time, name)` tuples for
+        all running processes. Used by `ProcessTree`.
+        """
+        ret = []
+        with _ScanContext():
+            for pid, ppid in _ppid_map().items():
+                proc = _psplatform.Process(pid)
+                try:
+                    ctime = proc.create_time()
+                except AccessDenied:
+                    ctime = 0.0
+                except (NoSuchProcess, ZombieProcess):
+                    continue
+                try:
+                    name = proc.name()
+                except AccessDenied:
+                    name = ""
+                except (NoSuchProcess, ZombieProcess):
+                    continue
+                ret.append((pid, ppid, ctime, name))
+        return ret
+
+
+@functools.lru_cache(maxsize=64)
+def _as_dict_plan(valid_names, attrs):
+    """Validate the *attrs* passed to `Process.as_dict()` and return
+    the tuple of method names to call. Cached, so that this is done
+    once per `process_iter(attrs=...)` pass instead of per process.
+    """
+    if not attrs:
+        return tuple(sorted(valid_names))
+    # Deprecated attrs: not returned by default but still accepted if
+    # explicitly requested.
+    deprecated_names = {"memory_full_info"}
+    invalid_names = attrs - valid_names - deprecated_names
+    if invalid_names:
+        msg = "invalid attr name{} {}".format(
+            "s" if len(invalid_names) > 1 else "",
+            ", ".join(map(repr, invalid_names)),
+        )
+        raise ValueError(msg)
+    return tuple(sorted(attrs))
+
+
+# System-wide values Process methods depend on. Within a scan (e.g.
+# process_iter(attrs=[...])) they are retrieved only once.
+
+
+@_memoize_when_scanning
+def _scan_cpu_count():
+    return cpu_count()
+
+
+@_memoize_when_scanning
+def _scan_total_phymem():
+    return virtual_memory().total
+
+
 def _pprint_secs(secs):
     """Format seconds in a human readable form."""
     now = time.time()
@@ -388,6 +469,30 @@ def _use_prefetch(method):
     return wrapper
 
 
+class _LazyAttr:
+    """Non-data descriptor computing an instance attribute via
+    *factory* on first access. From then on the value lives in the
+    instance `__dict__`, which takes precedence over the descriptor,
+    so it costs nothing on later accesses.
+    """
+
+    __slots__ = ("factory", "name")
+
+    def __init__(self, factory):
+        self.factory = factory
+        self.name = None
+
+    def __set_name__(self, owner, name):
+        self.name = name
+
+    def __get__(self, obj, cls=None):
+        if obj is None:
+            return self
+        # setdefault() is atomic: if 2 threads race here they both get
+        # the same object.
+        return obj.__dict__.setdefault(self.name, self.factory(obj))
+
+
 class Process:
     """Represents an OS process identified by a PID.
 
@@ -407,9 +512,44 @@ class Process:
 
     attrs: frozenset[str] = frozenset()  # dynamically set later
 
+    # Class-level defaults, so that instances created by _from_ident()
+    # only store what differs from them. This keeps the instances
+    # cached by process_iter() small.
+    _name = None
+    _exe = None
+    _create_time = None
+    _gone = False
+    _pid_reused = False
+    _hash = None
+    _ppid = None
+    _last_sys_cpu_times = None
+    _last_proc_cpu_times = None
+    _exitcode = _SENTINEL
+    _prefetch = _NO_PREFETCH
+    _ad_value = _SENTINEL
+    # Names of the methods which raised AccessDenied, skipped by
+    # as_dict() (see process_iter(cache_denied=True)).
+    _denied = None
+    # Created on first use.
+    _lock = _LazyAttr(lambda _: threading.RLock())
+    _proc = _LazyAttr(lambda self: _psplatform.Process(self._pid))
+
     def __init__(self, pid: int | None = None) -> None:
         self._init(pid)
 
+    @classmethod
+    def _from_ident(cls, pid, ctime):
+        """Return an instance for a PID whose identity (monotonic
+        creation time, see `_get_ident()`) is already known, e.g. out
+        of a native scan of all processes. No system call is issued:
+        the platform implementation and the lock are created on first
+        use, everything else starts with the class-level defaults.
+        """
+        self = object.__new__(cls)
+        self._pid = pid
+        self._ident = (pid, ctime)
+        return self
+
     def _init(self, pid, _ignore_nsp=False):
         if pid is None:
             pid = os.getpid()
@@ -430,7 +570,6 @@ class Process:
         self._gone = False
         self._pid_reused = False
         self._hash = None
-        self._lock = threading.RLock()
         # used for caching on Windows only (on POSIX ppid may change)
         self._ppid = None
         # platform-specific modules define an _psplatform.Process
@@ -670,7 +809,11 @@ class Process:
                     self._proc.oneshot_exit()
 
     def as_dict(
-        self, attrs: Collection[str] | None = None, ad_value: Any = None
+        self,
+        attrs: Collection[str] | None = None,
+        ad_value: Any = None,
+        timeout: float | None = None,
+        timeout_value: Any = _SENTINEL,
     ) -> dict[str, Any]:
         """Utility method returning process information as a
         hashable dictionary.
@@ -683,36 +826,69 @@ class Process:
         *ad_value* is the value which gets assigned in case
         `AccessDenied` or `ZombieProcess` exception is raised when
         retrieving that particular process information.
-        """
-        valid_names = self.attrs
-        # Deprecated attrs: not returned by default but still accepted if
-        # explicitly requested.
-        deprecated_names = {"memory_full_info"}
 
+        If *timeout* is specified the information is retrieved in a
+        separate thread, and the attributes which are not retrieved
+        within *timeout* seconds (e.g. because reading
+        `/proc/<pid>/cmdline` blocks while the process holds its mmap
+        lock) are assigned *timeout_value* (default: *ad_value*). While
+        a previous call for the same process is still stuck nothing is
+        retrieved.
+        """
         if attrs is not None:
             if not isinstance(attrs, (list, tuple, set, frozenset)):
                 msg = f"invalid attrs type {type(attrs)}"
                 raise TypeError(msg)
-            attrs = set(attrs)
-            invalid_names = attrs - valid_names - deprecated_names
-            if invalid_names:
-                msg = "invalid attr name{} {}".format(
-                    "s" if len(invalid_names) > 1 else "",
-                    ", ".join(map(repr, invalid_names)),
-                )
-                raise ValueError(msg)
-
+            attrs = frozenset(attrs)
+        if timeout is not None and timeout < 0:
+            msg = "timeout must be a positive number"
+            raise ValueError(msg)
+        names = _as_dict_plan(self.attrs, attrs)
+        if timeout is None:
+            return self._as_dict(names, attrs, ad_value, {})
+        if timeout_value is _SENTINEL:
+            timeout_value = ad_value
+
+        # A separate instance does the work, so that our lock is not
+        # held by a thread which may stay stuck.
+        proc = Process._from_ident(self.pid, self._ident[1])
+        proc._denied = self._denied
         retdict = {}
-        names = attrs or sorted(valid_names)
+        deadline = _timer() + timeout
+        fun = functools.partial(
+            proc._as_dict, names, attrs, ad_value, retdict, deadline
+        )
+        if _call_with_timeout(fun, timeout, key=self._ident):
+            return retdict
+        debug(f"as_dict() of PID {self.pid} timed out after {timeout} secs")
+        retdict = retdict.copy()
+        for name in names:
+            retdict.setdefault(name, timeout_value)
+        return retdict
+
+    def _as_dict(self, names, attrs, ad_value, retdict, deadline=None):
         with self.oneshot():
+            if hasattr(self._proc, "oneshot_plan"):
+                # let the implementation know what's coming
+                self._proc.oneshot_plan(names)
+            denied = self._denied
             for name in names:
+                if deadline is not None and _timer() > deadline:
+                    break  # the caller gave up on us
+                if denied and name in denied:
+                    retdict[name] = ad_value
+                    continue
                 try:
                     if name == 'pid':
                         ret = self.pid
                     else:
                         meth = getattr(self, name)
                         ret = meth()
-                except (AccessDenied, ZombieProcess):
+                except ZombieProcess:
+                    ret = ad_value
+                except AccessDenied:
+                    if denied is not None:
+                        denied.add(name)
                     ret = ad_value
                 except NotImplementedError:
                     # in case of not implemented functionality (may happen
@@ -820,26 +996,7 @@ class Process:
         # https://github.com/giampaolo/psutil/issues/692
         if WINDOWS and self._name is not None:
             return self._name
-        name = self._proc.name()
-        if POSIX and len(name) >= 15:
-            # On UNIX the name gets truncated to the first 15 characters.
-            # If it matches the first part of the cmdline we return that
-            # one instead because it's usually more explicative.
-            # Examples are "gnome-keyring-d" vs. "gnome-keyring-daemon".
-            try:
-                cmdline = self.cmdline()
-            except (AccessDenied, ZombieProcess):
-                # Just pass and return the truncated name: it's better
-                # than nothing. Note: there are actual cases where a
-                # zombie process can return a name() but not a
-                # cmdline(), see:
-                # https://github.com/giampaolo/psutil/issues/2239
-                pass
-            else:
-                if cmdline:
-                    extended_name = os.path.basename(cmdline[0])
-                    if extended_name.startswith(name):
-                        name = extended_name
+        name = _extend_name(self._proc.name(), self.cmdline)
         self._name = name
         self._proc._name = name
         return name
@@ -905,7 +1062,9 @@ class Process:
     def username(self) -> str:
         """The name of the user that owns the process.
 
-        On UNIX this is calculated by using the real process uid.
+        On UNIX this is calculated by using the real process uid. The
+        uid -> name resolution is cached for 5 minutes, or until
+        /etc/passwd changes.
         """
         if POSIX:
             if pwd is None:
@@ -915,12 +1074,7 @@ class Process:
             uids = self.uids()
             if self._is_ad_value(uids):
                 return uids
-            real_uid = uids.real
-            try:
-                return pwd.getpwuid(real_uid).pw_name
-            except KeyError:
-                # the uid can't be resolved by the system
-                return str(real_uid)
+            return _psposix.username(uids.real)
         else:
             return self._proc.username()
 
@@ -983,6 +1137,16 @@ class Process:
             """
             return self._proc.num_fds()
 
+    if hasattr(_psplatform.Process, "num_fds_by_kind"):
+
+        @_use_prefetch
+        def num_fds_by_kind(self) -> dict[str, int]:
+            """Return the number of file descriptors opened by this
+            process by kind, as a dict including all the kinds listed
+            in psutil.open_files() (Linux only).
+            """
+            return self._proc.num_fds_by_kind()
+
     if hasattr(_psplatform.Process, "io_counters"):
 
         @_use_prefetch
@@ -1122,6 +1286,16 @@ class Process:
             """
             return self._proc.threads()
 
+    if hasattr(_psplatform.Process, "threads_info"):
+
+        @_use_prefetch
+        def threads_info(self) -> list[pthreadinfo]:
+            """Same as threads() but also return the name, status,
+            last CPU, context switches and scheduler run / wait time
+            of each thread, all read in one pass (Linux only).
+            """
+            return self._proc.threads_info()
+
     def children(self, recursive: bool = False) -> list[Process]:
         """Return the children of this process as a list of Process
         instances, preemptively checking whether PID has been reused.
@@ -1150,12 +1324,27 @@ class Process:
         is lost.
         """
         self._raise_if_pid_reused()
-        ppid_map = _ppid_map()
         # Get a fresh (non-cached) ctime in case the system clock was
         # updated. TODO: use a monotonic ctime on platforms where it's
         # supported.
         proc_ctime = Process(self.pid).create_time()
         ret = []
+        # On Linux the kernel can tell the children of a process
+        # directly, so there's no need to scan all PIDs.
+        child_pids = None
+        if hasattr(self._proc, "children_pids"):
+            child_pids = self._proc.children_pids(recursive)
+        if child_pids is not None:
+            for pid in child_pids:
+                try:
+                    child = Process(pid)
+                    if proc_ctime <= child.create_time():
+                        ret.append(child)
+                except (NoSuchProcess, ZombieProcess):
+                    pass
+            return ret
+
+        ppid_map = _ppid_map()
         if not recursive:
             for pid, ppid in ppid_map.items():
                 if ppid == self.pid:
@@ -1237,7 +1426,7 @@ class Process:
         if interval is not None and interval < 0:
             msg = f"interval is not positive (got {interval!r})"
             raise ValueError(msg)
-        num_cpus = cpu_count() or 1
+        num_cpus = _scan_cpu_count() or 1
 
         def timer():
             return _timer() * num_cpus
@@ -1416,7 +1605,7 @@ class Process:
         value = getattr(metrics, memtype)
 
         # use cached value if available
-        total_phymem = _TOTAL_PHYMEM or virtual_memory().total
+        total_phymem = _TOTAL_PHYMEM or _scan_total_phymem()
         if not total_phymem > 0:
             # we should never get here
             msg = (
@@ -1747,6 +1936,227 @@ class Popen(Process):
         return ret
 
 
+# =====================================================================
+# --- ProcessTree class
+# =====================================================================
+
+
+class ProcessTree:
+    """A snapshot of the parent / child relationships of all running
+    processes, taken out of a single scan of the process table.
+
+    Queries are answered from memory, without issuing any system call,
+    and return PIDs rather than `Process` instances. A process is
+    considered the child of its PPID only if it was created after it,
+    which discards PIDs reused in the meantime, same as
+    `Process.children()` does. Use `refresh()` to get an up to date
+    snapshot.
+
+      >>> import psutil
+      >>> tree = psutil.ProcessTree()
+      >>> tree.children(1)
+      [305, 316, 642, 1203]
+      >>> tree.ancestors(4321)
+      [1203, 1]
+      >>> tree.name(1203)
+      'sshd'
+    """
+
+    __slots__ = ("_children", "_procs", "timestamp")
+
+    def __init__(self) -> None:
+        self.timestamp = time.time()
+        # {pid: (ppid, create_time, name)}
+        self._procs = {x[0]: x[1:] for x in _proc_tree_scan()}
+        # {pid: [child_pid, ...]}
+        self._children = collections.defaultdict(list)
+        for pid in self._procs:
+            ppid = self._linked_ppid(self._procs, pid)
+            if ppid is not None:
+                self._children[ppid].append(pid)
+
+    @staticmethod
+    def _linked_ppid(procs, pid):
+        # Return the PPID of `pid` unless it's unknown or the parent
+        # was created after the child (its PID has been reused).
+        ppid, ctime, _ = procs[pid]
+        parent = procs.get(ppid)
+        if parent is None or ppid == pid or parent[1] > ctime:
+            return None
+        return ppid
+
+    def _get(self, pid):
+        try:
+            return self._procs[pid]
+        except KeyError:
+            msg = "process not found in the snapshot"
+            raise NoSuchProcess(pid, msg=msg) from None
+
+    def __repr__(self):
+        return f"{self.__class__.__name__}(procs={len(self._procs)})"
+
+    def __len__(self) -> int:
+        return len(self._procs)
+
+    def __contains__(self, pid: int) -> bool:
+        return pid in self._procs
+
+    def __iter__(self) -> Iterator[int]:
+        return iter(self._procs)
+
+    def pids(self) -> list[int]:
+        """Return a sorted list of the PIDs in the snapshot."""
+        return sorted(self._procs)
+
+    def ppid(self, pid: int) -> int:
+        """Return the PPID of *pid* as reported by the OS."""
+        return self._get(pid)[0]
+
+    def create_time(self, pid: int) -> float:
+        """Return the creation time of *pid*, same as
+        `Process.create_time()`.
+        """
+        return self._get(pid)[1]
+
+    def name(self, pid: int) -> str:
+        """Return the name of *pid*. On Linux this is the name as
+        seen by the kernel, which is truncated to 15 characters.
+        """
+        return self._get(pid)[2]
+
+    def parent(self, pid: int) -> int | None:
+        """Return the parent PID of *pid*, or None if its parent is
+        not known.
+        """
+        self._get(pid)
+        return self._linked_ppid(self._procs, pid)
+
+    def roots(self) -> list[int]:
+        """Return the PIDs of the processes with no known parent."""
+        return [x for x in self._procs if self.parent(x) is None]
+
+    def children(self, pid: int, recursive: bool = False) -> list[int]:
+        """Return the children PIDs of *pid*. If *recursive* is True
+        return all of its descendants, parents before children.
+        """
+        self._get(pid)
+        if not recursive:
+            return list(self._children.get(pid, ()))
+        ret = []
+        seen = {pid}
+        queue = collections.deque(self._children.get(pid, ()))
+        while queue:
+            child = queue.popleft()
+            if child in seen:
+                continue  # can only happen with reused PIDs
+            seen.add(child)
+            ret.append(child)
+            queue.extend(self._children.get(child, ()))
+        return ret
+
+    def descendants(self, pid: int) -> list[int]:
+        """Same as `children(pid, recursive=True)`."""
+        return self.children(pid, recursive=True)
+
+    def ancestors(self, pid: int) -> list[int]:
+        """Return the PIDs of the parents of *pid*, starting from its
+        parent up to the root of its tree.
+        """
+        ret = []
+        seen = {pid}
+        ppid = self.parent(pid)
+        while ppid is not None and ppid not in seen:
+            seen.add(ppid)
+            ret.append(ppid)
+            ppid = self._linked_ppid(self._procs, ppid)
+        return ret
+
+    def subtree_totals(self, values: dict[int, float]) -> dict[int, float]:
+        """Given a `{pid: value}` dict (e.g. CPU or memory usage), return
+        a `{pid: total}` dict where total is the sum of the values of
+        the process and of all of its descendants. PIDs missing from
+        *values* count as 0. All processes are computed in a single
+        pass.
+        """
+        totals = {}
+        order = []
+        seen = set()
+        for root in self.roots():
+            stack = [root]
+            while stack:
+                pid = stack.pop()
+                if pid in seen:
+                    continue
+                seen.add(pid)
+                order.append(pid)
+                stack.extend(self._children.get(pid, ()))
+        # Children always come after their parent in `order`.
+        for pid in reversed(order):
+            total = values.get(pid, 0)
+            for child in self._children.get(pid, ()):
+                total += totals.get(child, 0)
+            totals[pid] = total
+        return totals
+
+    def refresh(self) -> ProcessTree:
+        """Return a new, up to date snapshot. This snapshot is left
+        untouched. The OS is scanned again, but only the processes
+        which appeared, disappeared or changed parent since this
+        snapshot are re-linked into the tree.
+        """
+        old = self._procs
+        procs = {}
+        changed = []
+        for pid, ppid, ctime, name in _proc_tree_scan():
+            entry = old.get(pid)
+            if entry is None or entry[0] != ppid or entry[1] != ctime:
+                changed.append(pid)
+                entry = (ppid, ctime, name)
+            elif entry[2] != name:  # exec()
+                entry = (ppid, ctime, name)
+            procs[pid] = entry
+        gone = [x for x in old if x not in procs]
+
+        # Children lists are shared with this snapshot: copy the ones
+        # which are about to change.
+        children = collections.defaultdict(list, self._children)
+        copied = set()
+
+        def edit(ppid):
+            if ppid not in copied:
+                children[ppid] = list(children.get(ppid, ()))
+                copied.add(ppid)
+            return children[ppid]
+
+        relink = list(changed)
+        changed = set(changed)
+        for pid in gone + relink:
+            if pid not in old:
+                continue
+            ppid = self._linked_ppid(old, pid)
+            if ppid is not None and pid in edit(ppid):
+                edit(ppid).remove(pid)
+            if pid not in procs or procs[pid][1] != old[pid][1]:
+                # A different process (or none) now: its former
+                # children have to be linked again.
+                relink.extend(
+                    child
+                    for child in children.pop(pid, ())
+                    if child in procs and child not in changed
+                )
+                copied.discard(pid)
+        for pid in relink:
+            ppid = self._linked_ppid(procs, pid)
+            if ppid is not None:
+                edit(ppid).append(pid)
+
+        tree = ProcessTree.__new__(ProcessTree)
+        tree.timestamp = time.time()
+        tree._procs = procs
+        tree._children = children
+        return tree
+
+
 # =====================================================================
 # --- system processes related functions
 # =====================================================================
@@ -1779,12 +2189,120 @@ def pid_exists(pid: int) -> bool:
         return _psplatform.pid_exists(pid)
 
 
+def _extend_name(name, cmdline):
+    """Given a process *name* and a *cmdline* function returning the
+    process cmdline, return the full name of the process.
+    """
+    if POSIX and len(name) >= 15:
+        # On UNIX the name gets truncated to the first 15 characters.
+        # If it matches the first part of the cmdline we return that
+        # one instead because it's usually more explicative.
+        # Examples are "gnome-keyring-d" vs. "gnome-keyring-daemon".
+        try:
+            args = cmdline()
+        except (AccessDenied, ZombieProcess):
+            # Just pass and return the truncated name: it's better
+            # than nothing. Note: there are actual cases where a
+            # zombie process can return a name() but not a
+            # cmdline(), see:
+            # https://github.com/giampaolo/psutil/issues/2239
+            pass
+        else:
+            if args:
+                extended_name = os.path.basename(args[0])
+                if extended_name.startswith(name):
+                    name = extended_name
+    return name
+
+
 _pmap = {}
 _pids_reused = set()
 
+_FILTER_KEYS = frozenset(
+    ("uids", "ppid", "status", "min_rss", "kernel_threads", "name", "cmdline")
+)
+
+
+def _filter_pids(filters):
+    """Return the PIDs of the processes matching *filters* (see
+    `process_iter()`), without creating `Process` instances.
+    """
+    invalid = set(filters) - _FILTER_KEYS
+    if invalid:
+        msg = f"invalid filter name(s) {', '.join(map(repr, invalid))}"
+        raise ValueError(msg)
+    uids = filters.get("uids")
+    if uids is not None:
+        uids = {
+            _psposix.username_uid(x) if isinstance(x, str) else x
+            for x in uids
+        }
+    ppid = filters.get("ppid")
+    statuses = filters.get("status")
+    if statuses is not None:
+        statuses = set(statuses)
+    min_rss = filters.get("min_rss", 0)
+    name_re = filters.get("name")
+    if name_re is not None:
+        name_re = re.compile(name_re)
+    cmdline_re = filters.get("cmdline")
+    if cmdline_re is not None:
+        cmdline_re = re.compile(cmdline_re)
+
+    if hasattr(_psplatform, "filter_pids"):
+        # Evaluate the cheap filters natively first.
+        candidates = _psplatform.filter_pids(
+            uids=uids,
+            ppid=ppid,
+            statuses=statuses,
+            min_rss=min_rss,
+            kernel_threads=filters.get("kernel_threads", True),
+        )
+    else:  # pragma: no cover
+        candidates = []
+        for pid in pids():
+            proc = _psplatform.Process(pid)
+            try:
+                if uids is not None and proc.uids().real not in uids:
+                    continue
+                if ppid is not None and proc.ppid() != ppid:
+                    continue
+                if statuses is not None and proc.status() not in statuses:
+                    continue
+                if min_rss and proc.memory_info().rss < min_rss:
+                    continue
+            except (NoSuchProcess, AccessDenied):
+                continue
+            candidates.append((pid, None, None))
+
+    ret = []
+    for pid, _, name in candidates:
+        proc = _psplatform.Process(pid)
+        try:
+            if name_re is not None:
+                # The native name may be truncated: match the same
+                # full name Process.name() would return.
+                if name is None:
+                    name = proc.name()
+                if not name_re.search(_extend_name(name, proc.cmdline)):
+                    continue
+            if cmdline_re is not None:
+                if not cmdline_re.search(" ".join(proc.cmdline())):
+                    continue
+        except (NoSuchProcess, AccessDenied):
+            continue
+        ret.append(pid)
+    return ret
+
 
 def process_iter(
-    attrs: Collection[str] | None = None, ad_value: Any = None
+    attrs: Collection[str] | None = None,
+    ad_value: Any = None,
+    filters: dict[str, Any] | None = None,
+    cache_denied: bool = False,
+    timeout: float | None = None,
+    scan_timeout: float | None = None,
+    timeout_value: Any = _SENTINEL,
 ) -> Iterator[Process]:
     """Return a generator yielding a `Process` instance for all
     running processes.
@@ -1806,11 +2324,48 @@ def process_iter(
 
     If a method raises `AccessDenied` during pre-fetch, it will return
     *ad_value* (default None) instead of raising.
+
+    *filters* is an optional dict restricting the processes which are
+    yielded. They are evaluated before `Process` instances are created
+    (on Linux natively, out of `/proc/<pid>/stat|status`):
+
+    - `uids`: collection of real UIDs or user names
+    - `ppid`: parent PID
+    - `status`: collection of `STATUS_*` constants
+    - `min_rss`: minimum RSS memory in bytes
+    - `kernel_threads`: False to exclude kernel threads (Linux)
+    - `name`: regex searched in the process name
+    - `cmdline`: regex searched in the space-joined command line
+
+    >>> psutil.process_iter(filters={"uids": ["svc"], "name": "^java$"})
+
+    During pre-fetch, system-wide values needed by some methods (boot
+    time, total physical memory, CPU count) are retrieved only once
+    and shared by all processes.
+
+    If *cache_denied* is True the methods raising `AccessDenied`
+    during pre-fetch are remembered per process, and later calls with
+    *cache_denied=True* return *ad_value* for them without retrying,
+    until the PID is reused or `process_iter.cache_clear()` is called.
+
+    If *timeout* is specified, pre-fetching the attributes of each
+    process may take at most *timeout* seconds. The ones which are not
+    retrieved in time are assigned *timeout_value* (default:
+    *ad_value*), so that a process which blocks reads of its `/proc`
+    files does not stall the whole scan (see `Process.as_dict()`).
+    If *scan_timeout* is specified, pre-fetching the attributes of all
+    processes may take at most *scan_timeout* seconds: afterwards the
+    remaining processes are yielded with all *attrs* assigned
+    *timeout_value*.
     """
     global _pmap
 
     def add(pid):
-        proc = Process(pid)
+        ctime = None if idents is None else idents[pid]
+        if ctime is None:
+            proc = Process(pid)
+        else:
+            proc = Process._from_ident(pid, ctime)
         pmap[proc.pid] = proc
         return proc
 
@@ -1833,30 +2388,82 @@ def process_iter(
                 "process_iter(attrs=Process.attrs) to retrieve all attributes"
             )
             warnings.warn(msg, UserWarning, stacklevel=2)
+    for value in (timeout, scan_timeout):
+        if value is not None and value < 0:
+            msg = "timeout must be a positive number"
+            raise ValueError(msg)
+    deadline = None
+    if scan_timeout is not None:
+        deadline = _timer() + scan_timeout
 
     pmap = _pmap.copy()
-    a = set(pids())
-    b = set(pmap)
-    new_pids = a - b
-    gone_pids = b - a
-    for pid in gone_pids:
-        remove(pid)
+    scan_ctx = _ScanContext()
+    if filters is None:
+        a = set(pids())
+        b = set(pmap)
+        new_pids = a - b
+        gone_pids = b - a
+        for pid in gone_pids:
+            remove(pid)
+    else:
+        # Non matching PIDs are neither yielded nor known to be gone.
+        a = set(_filter_pids(filters))
     while _pids_reused:
         pid = _pids_reused.pop()
         debug(f"refreshing Process instance for reused PID {pid}")
         remove(pid)
+    idents = None
+    if (
+        filters is None
+        and hasattr(_psplatform, "pid_idents")
+        and len(new_pids) > len(a) // 4
+    ):
+        # Many new PIDs (e.g. first call): get the identity of all of
+        # them in one native scan, and create lightweight instances.
+        idents = _psplatform.pid_idents()
     try:
-        ls = sorted(list(pmap.items()) + list(dict.fromkeys(new_pids).items()))
+        if filters is None:
+            ls = list(pmap.items()) + list(dict.fromkeys(new_pids).items())
+        else:
+            ls = [(pid, pmap.get(pid)) for pid in a]
+        ls.sort(key=lambda x: x[0])
         for pid, proc in ls:
             try:
                 if proc is None:  # new process
+                    if idents is not None and pid not in idents:
+                        continue  # gone in the meantime
                     proc = add(pid)
-                proc._prefetch = {}  # clear cache
+                proc._prefetch = _NO_PREFETCH  # clear cache
                 proc._ad_value = _SENTINEL
                 if attrs is not None:
-                    proc._prefetch = proc.as_dict(
-                        attrs=attrs, ad_value=ad_value
-                    )
+                    if not cache_denied:
+                        if proc._denied is not None:
+                            proc._denied = None
+                    elif proc._denied is None:
+                        proc._denied = set()
+                    elif proc._denied and not proc.is_running():
+                        # Make sure a reused PID does not inherit the
+                        # denied methods of the old process.
+                        _pids_reused.discard(pid)
+                        if idents is not None and pid not in idents:
+                            remove(pid)
+                            continue  # gone in the meantime
+                        proc = add(pid)
+                        proc._denied = set()
+                    proc_timeout = timeout
+                    if deadline is not None:
+                        left = max(deadline - _timer(), 0)
+                        if proc_timeout is None or left < proc_timeout:
+                            proc_timeout = left
+                    # Only active while pre-fetching, not while the
+                    # caller consumes the yielded process.
+                    with scan_ctx:
+                        proc._prefetch = proc.as_dict(
+                            attrs=attrs,
+                            ad_value=ad_value,
+                            timeout=proc_timeout,
+                            timeout_value=timeout_value,
+                        )
                     proc._ad_value = ad_value
                 yield proc
             except ZombieProcess:
@@ -1872,6 +2479,169 @@ process_iter.cache_clear = lambda: _pmap.clear()  # noqa: PLW0108
 process_iter.cache_clear.__doc__ = "Clear process_iter() internal cache."
 
 
+_TOP_KEYS = ("rss", "cpu", "io", "num_fds", "swap")
+
+
+def _top_value(proc, key):
+    if key == "rss":
+        return proc.memory_info().rss
+    if key == "cpu":
+        times = proc.cpu_times()
+        return times.user + times.system
+    if key == "io":
+        io = proc.io_counters()
+        return io.read_bytes + io.write_bytes
+    if key == "num_fds":
+        return proc.num_fds()
+    return proc.memory_footprint().swap
+
+
+if hasattr(_psplatform, "top_pids"):
+    # Faster version (Linux): selection happens natively.
+    _top_pids = _psplatform.top_pids
+else:  # pragma: no cover
+
+    def _top_pids(key, n, interval=None):
+        def sample():
+            ret = {}
+            for pid in pids():
+                try:
+                    proc = Process(pid)
+                    ret[proc._ident] = _top_value(proc._proc, key)
+                except (NoSuchProcess, AccessDenied, AttributeError):
+                    pass
+            return ret
+
+        values = sample()
+        if interval:
+            time.sleep(interval)
+            prev, values = values, sample()
+            values = {k: max(v - prev.get(k, 0), 0) for k, v in values.items()}
+        top = heapq.nlargest(n, values.items(), key=lambda x: x[1])
+        return [(pid, ctime, value) for (pid, ctime), value in top]
+
+
+def top_processes(
+    key: str, n: int = 20, interval: float | None = None
+) -> list[tuple[Process, Any]]:
+    """Return the *n* processes with the highest *key* value, as a
+    list of `(Process, value)` tuples sorted by value in descending
+    order. *key* can be:
+
+    - `rss`: resident memory, in bytes
+    - `cpu`: user + system CPU time, in seconds
+    - `io`: read + written bytes
+    - `num_fds`: number of file descriptors (POSIX)
+    - `swap`: swapped out memory, in bytes
+
+    If *interval* is > 0 the processes are sampled twice, *interval*
+    seconds apart, and the values are the difference between the two
+    samples (e.g. the CPU time spent or the bytes read / written
+    during that time).
+
+    Processes which can't be inspected (e.g. `AccessDenied`) are
+    skipped. On Linux the selection happens in C while scanning
+    `/proc`, so that no Python objects get created for the processes
+    which don't make it to the top.
+    """
+    if key not in _TOP_KEYS:
+        msg = f"invalid key {key!r}; valid ones are: {_TOP_KEYS}"
+        raise ValueError(msg)
+    if interval is not None and interval < 0:
+        msg = f"interval is not positive (got {interval!r})"
+        raise ValueError(msg)
+    ret = []
+    for pid, ctime, value in _top_pids(key, n, interval):
+        # Bind the instance to the process which got sampled, so that
+        # if the PID gets reused in the meantime it's not mistaken for
+        # it (is_running() returns False, kill() etc. raise NSP).
+        if ctime is None:
+            try:
+                proc = Process(pid)
+            except NoSuchProcess:
+                continue
+        else:
+            proc = Process._from_ident(pid, ctime)
+        ret.append((proc, value))
+    return ret
+
+
+_ROLLUP_KEYS = ("uid", "cgroup", "name")
+
+
+if hasattr(_psplatform, "process_rollup"):
+    # Faster version (Linux): grouping happens natively.
+    _process_rollup = _psplatform.process_rollup
+else:  # pragma: no cover
+
+    def _process_rollup(by, pss=False):
+        if by == "cgroup":
+            msg = "grouping by cgroup is only supported on Linux"
+            raise ValueError(msg)
+        groups = {}
+        for pid in pids():
+            proc = _psplatform.Process(pid)
+            try:
+                key = proc.uids().real if by == "uid" else proc.name()
+                rss = proc.memory_info().rss
+                times = proc.cpu_times()
+                threads = proc.num_threads()
+            except (NoSuchProcess, AccessDenied):
+                continue
+            values = [1, rss, 0, times.user + times.system, 0, threads, 0]
+            # Optional metrics: not available everywhere, or not
+            # readable for other users' processes.
+            errors = (NoSuchProcess, AccessDenied, AttributeError)
+            if pss:
+                try:
+                    values[2] = proc.memory_footprint().pss
+                except errors:
+                    pass
+            try:
+                values[4] = sum(proc.io_counters()[2:4])
+            except errors:
+                pass
+            try:
+                values[6] = proc.num_fds()
+            except errors:
+                pass
+            group = groups.setdefault(key, [0] * len(values))
+            for i, value in enumerate(values):
+                group[i] += value
+        ret = {}
+        for key, values in groups.items():
+            if not pss:
+                values[2] = None
+            ret[key] = _ntp.sprocgroup(*values)
+        return ret
+
+
+def process_rollup(
+    by: str = "uid", pss: bool = False
+) -> dict[Any, sprocgroup]:
+    """Return a dict mapping a group of processes to the sum of their
+    metrics, as a `(count, rss, pss, cpu_time, io_bytes, num_threads,
+    num_fds)` named tuple. *by* can be:
+
+    - `uid`: the real user ID (an int)
+    - `cgroup`: the cgroup v2 path, or the first cgroup v1 hierarchy
+      path if there's no v2 one (Linux)
+    - `name`: the process name
+
+    `pss` is only collected if *pss* is True, since it's expensive,
+    and is None otherwise. Processes which can't be fully inspected
+    (e.g. I/O counters of other users' processes) are still counted,
+    but don't contribute the values which couldn't be read.
+
+    On Linux all the processes are read and grouped in C, without
+    creating Python objects for each process.
+    """
+    if by not in _ROLLUP_KEYS:
+        msg = f"invalid by {by!r}; valid ones are: {_ROLLUP_KEYS}"
+        raise ValueError(msg)
+    return _process_rollup(by, pss)
+
+
 def wait_procs(
     procs: list[Process],
     timeout: float | None = None,
@@ -2094,6 +2864,22 @@ def _cpu_times_deltas(t1, t2):
     return _ntp.scputimes(*field_deltas)
 
 
+def _cpu_busy_percent(t1, t2):
+    """Return the busy CPU time between 2 `cpu_times()` named tuples,
+    as a percentage.
+    """
+    times_delta = _cpu_times_deltas(t1, t2)
+    all_delta = _cpu_tot_time(times_delta)
+    busy_delta = _cpu_busy_time(times_delta)
+
+    try:
+        busy_perc = (busy_delta / all_delta) * 100
+    except ZeroDivisionError:
+        return 0.0
+    else:
+        return round(busy_perc, 1)
+
+
 def cpu_percent(
     interval: float | None = None, percpu: bool = False
 ) -> float | list[float]:
@@ -2137,18 +2923,6 @@ def cpu_percent(
         msg = f"interval is not positive (got {interval})"
         raise ValueError(msg)
 
-    def calculate(t1, t2):
-        times_delta = _cpu_times_deltas(t1, t2)
-        all_delta = _cpu_tot_time(times_delta)
-        busy_delta = _cpu_busy_time(times_delta)
-
-        try:
-            busy_perc = (busy_delta / all_delta) * 100
-        except ZeroDivisionError:
-            return 0.0
-        else:
-            return round(busy_perc, 1)
-
     # system-wide usage
     if not percpu:
         if blocking:
@@ -2157,7 +2931,7 @@ def cpu_percent(
         else:
             t1 = _last_cpu_times.get(tid) or cpu_times()
         _last_cpu_times[tid] = cpu_times()
-        return calculate(t1, _last_cpu_times[tid])
+        return _cpu_busy_percent(t1, _last_cpu_times[tid])
     # per-cpu usage
     else:
         ret = []
@@ -2168,7 +2942,7 @@ def cpu_percent(
             tot1 = _last_per_cpu_times.get(tid) or cpu_times(percpu=True)
         _last_per_cpu_times[tid] = cpu_times(percpu=True)
         for t1, t2 in zip(tot1, _last_per_cpu_times[tid]):
-            ret.append(calculate(t1, t2))
+            ret.append(_cpu_busy_percent(t1, t2))
         return ret
 
 
@@ -2288,9 +3062,43 @@ if hasattr(_psplatform, "cpu_freq"):
 
                 return _ntp.scpufreq(current, min_, max_)
 
+    def _cpu_freq_cache_clear():
+        """Clear cpu_freq() internal cache."""
+        # On Linux the CPU topology and the min / max frequencies are
+        # cached, and refreshed when a CPU goes online or offline.
+        if hasattr(_psplatform, "cpu_freq_cache_clear"):
+            _psplatform.cpu_freq_cache_clear()
+
+    cpu_freq.cache_clear = _cpu_freq_cache_clear
+
     __all__.append("cpu_freq")
 
 
+if hasattr(_psplatform, "cpu_freq_times"):
+
+    def cpu_freq_times(
+        percpu: bool = False,
+    ) -> dict[float, float] | list[dict[float, float]]:
+        """Return how long CPUs spent running at each frequency, as a
+        dict mapping frequencies expressed in Mhz to cumulative seconds.
+        Values are summed across cpufreq policies, each one counted
+        once even if it's shared by many CPUs.
+
+        If *percpu* is True return a list of dicts, one for each CPU,
+        in the same order as `cpu_freq(percpu=True)`.
+        """
+        ret = _psplatform.cpu_freq_times(percpu)
+        if percpu:
+            return ret
+        total = {}
+        for cpu in ret:
+            for freq, secs in cpu.items():
+                total[freq] = total.get(freq, 0.0) + secs
+        return dict(sorted(total.items()))
+
+    __all__.append("cpu_freq_times")
+
+
 def getloadavg() -> tuple[float, float, float]:
     """Return the average system load over the last 1, 5 and 15 minutes
     as a tuple.
@@ -2378,6 +3186,34 @@ def disk_usage(path: str) -> sdiskusage:
     return _psplatform.disk_usage(path)
 
 
+if POSIX:
+
+    def disk_usage_many(
+        paths: Iterable[str] | None = None, timeout: float | None = None
+    ) -> dict[str, sdiskusagefull | OSError | TimeoutExpired]:
+        """Return disk usage statistics about many *paths* at once
+        (default: the mount points returned by disk_partitions()) as a
+        dict. Values are named tuples including the same fields as
+        disk_usage() plus inodes_total, inodes_used, inodes_free and
+        inodes_percent.
+
+        statvfs() is called for all paths concurrently, with the GIL
+        released. If a path is not available the value is an OSError
+        instance (e.g. FileNotFoundError), if it doesn't return within
+        *timeout* seconds (e.g. a hung NFS or FUSE mount) the value
+        is a TimeoutExpired instance. Exceptions are returned, not
+        raised.
+        """
+        if paths is None:
+            paths = [x.mountpoint for x in disk_partitions()]
+        if timeout is not None and timeout < 0:
+            msg = "timeout must be a positive number"
+            raise ValueError(msg)
+        return _psplatform.disk_usage_many(paths, timeout)
+
+    __all__.append("disk_usage_many")
+
+
 def disk_partitions(all: bool = False) -> list[sdiskpart]:
     """Return mounted partitions as a list of
     (device, mountpoint, fstype, opts) named tuple.
@@ -2387,10 +3223,22 @@ def disk_partitions(all: bool = False) -> list[sdiskpart]:
 
     If *all* parameter is False return physical devices only and ignore
     all others.
+
+    On Linux the result is cached until something gets mounted or
+    unmounted; use disk_partitions.cache_clear() to force a re-read.
     """
     return _psplatform.disk_partitions(all)
 
 
+def _disk_partitions_cache_clear() -> None:
+    """Clear the disk_partitions() cache (Linux only)."""
+    if hasattr(_psplatform, "disk_partitions_cache_clear"):
+        _psplatform.disk_partitions_cache_clear()
+
+
+disk_partitions.cache_clear = _disk_partitions_cache_clear
+
+
 def disk_io_counters(
     perdisk: bool = False, nowrap: bool = True
 ) -> sdiskio | dict[str, sdiskio] | None:
@@ -2435,10 +3283,106 @@ def disk_io_counters(
         return _ntp.sdiskio(*(sum(x) for x in zip(*rawdict.values())))
 
 
-disk_io_counters.cache_clear = functools.partial(
-    _wrap_numbers.cache_clear, 'psutil.disk_io_counters'
-)
-disk_io_counters.cache_clear.__doc__ = "Clears nowrap argument cache"
+def _disk_io_counters_cache_clear():
+    """Clears nowrap argument cache."""
+    _wrap_numbers.cache_clear('psutil.disk_io_counters')
+    # On Linux, also forget which devices are disks and which ones are
+    # partitions.
+    if hasattr(_psplatform, "disk_io_cache_clear"):
+        _psplatform.disk_io_cache_clear()
+
+
+disk_io_counters.cache_clear = _disk_io_counters_cache_clear
+
+
+if LINUX:
+    _last_disk_io_stats = {}
+
+    def disk_io_stats(
+        interval: float | None = None, perdisk: bool = False
+    ) -> sdiskiostats | dict[str, sdiskiostats] | None:
+        """Return extended disk I/O statistics, similar to "iostat -x",
+        calculated over an interval:
+
+         - read_await: average time (ms) reads took to be served,
+           including the time spent waiting in queue
+         - write_await: same as above, for writes
+         - total_await: same as above, for reads and writes
+         - service_time: average time (ms) the device was busy per I/O
+         - queue_depth: average number of queued / in-flight requests
+         - busy_percent: percentage of time the device was busy
+
+        When *interval* is > 0.0 compares disk counters before and
+        after the interval (blocking). When *interval* is 0.0 or None
+        compares them with the ones of the last call, returning
+        immediately. That means the first time this is called it will
+        return meaningless 0.0 values which you should ignore.
+
+        If *perdisk* is True return the same information for every
+        disk and partition as a dictionary.
+        """
+        tid = threading.current_thread().ident
+        if interval is not None and interval < 0:
+            msg = f"interval is not positive (got {interval})"
+            raise ValueError(msg)
+
+        def sample():
+            return (
+                time.monotonic(),
+                _psplatform.disk_io_counters(perdisk=perdisk),
+            )
+
+        def calculate(d1, d2, elapsed_ms, ndisks=1):
+            # (reads, writes, _, _, rtime, wtime, _, _, busy, weighted)
+            deltas = [b - a for a, b in zip(d1[:10], d2[:10])]
+            reads, writes, _, _, rtime, wtime, _, _, busy, weighted = deltas
+            ios = reads + writes
+
+            def div(a, b):
+                return round(a / b, 2) if b > 0 else 0.0
+
+            busy_perc = min(div(busy * 100, elapsed_ms * ndisks), 100.0)
+            return _ntp.sdiskiostats(
+                div(rtime, reads),
+                div(wtime, writes),
+                div(rtime + wtime, ios),
+                div(busy, ios),
+                div(weighted, elapsed_ms),
+                busy_perc,
+            )
+
+        key = (tid, perdisk)
+        if interval is not None and interval > 0.0:
+            t1, raw1 = sample()
+            time.sleep(interval)
+        else:
+            t1, raw1 = _last_disk_io_stats.get(key) or sample()
+        t2, raw2 = sample()
+        _last_disk_io_stats[key] = (t2, raw2)
+        elapsed_ms = (t2 - t1) * 1000
+
+        # Skip disks which appeared during the interval, or whose
+        # counters went backwards (wrapped, or device got replaced).
+        common = {}
+        for name, d2 in raw2.items():
+            d1 = raw1.get(name)
+            if d1 is not None and all(b >= a for a, b in zip(d1, d2)):
+                common[name] = (d1, d2)
+
+        if perdisk:
+            return {
+                name: calculate(d1, d2, elapsed_ms)
+                for name, (d1, d2) in common.items()
+            }
+        if not raw2:
+            return None
+        if not common:
+            return _ntp.sdiskiostats(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+        tot1 = [sum(x) for x in zip(*(d1 for d1, _ in common.values()))]
+        tot2 = [sum(x) for x in zip(*(d2 for _, d2 in common.values()))]
+        return calculate(tot1, tot2, elapsed_ms, ndisks=len(common))
+
+    __all__.append("disk_io_stats")
 
 
 # =====================================================================
@@ -2447,7 +3391,10 @@ disk_io_counters.cache_clear.__doc__ = "Clears nowrap argument cache"
 
 
 def net_io_counters(
-    pernic: bool = False, nowrap: bool = True
+    pernic: bool = False,
+    nowrap: bool = True,
+    prefix: str | None = None,
+    ifindex: int | None = None,
 ) -> snetio | dict[str, snetio] | None:
     """Return network I/O statistics as a named tuple including
     the following fields:
@@ -2466,17 +3413,42 @@ def net_io_counters(
     network interface as a dictionary with interface names as the
     keys.
 
+    If *prefix* is specified only the interfaces whose name starts
+    with it are considered (e.g. "eth"). If *ifindex* is specified
+    only the interface with that index is considered. On Linux the
+    filtering happens before the counters are collected, which is a
+    lot cheaper on systems with thousands of interfaces.
+
     If *nowrap* is True (default), counters that overflow and wrap to
     zero are automatically adjusted so they never decrease (this can
     happen on very busy or long-lived systems).
     `net_io_counters.cache_clear()` can be used to invalidate the
     *nowrap* cache.
     """
-    rawdict = _psplatform.net_io_counters()
+    if LINUX:
+        rawdict = _psplatform.net_io_counters(prefix=prefix, ifindex=ifindex)
+    else:
+        rawdict = _psplatform.net_io_counters()
+        if prefix:
+            rawdict = {
+                k: v for k, v in rawdict.items() if k.startswith(prefix)
+            }
+        if ifindex:
+            try:
+                ifname = socket.if_indextoname(ifindex)
+            except OSError:
+                rawdict = {}
+            else:
+                rawdict = {k: v for k, v in rawdict.items() if k == ifname}
     if not rawdict:
         return {} if pernic else None
     if nowrap:
-        rawdict = _wrap_numbers(rawdict, 'psutil.net_io_counters')
+        # Filtered queries are tracked separately, so that they don't
+        # make the unfiltered ones forget about the other NICs.
+        name = 'psutil.net_io_counters'
+        if prefix or ifindex:
+            name += f".{prefix or ''}.{ifindex or ''}"
+        rawdict = _wrap_numbers(rawdict, name)
     if pernic:
         for nic, fields in rawdict.items():
             rawdict[nic] = _ntp.snetio(*fields)
@@ -2485,10 +3457,16 @@ def net_io_counters(
         return _ntp.snetio(*[sum(x) for x in zip(*rawdict.values())])
 
 
-net_io_counters.cache_clear = functools.partial(
-    _wrap_numbers.cache_clear, 'psutil.net_io_counters'
-)
-net_io_counters.cache_clear.__doc__ = "Clears nowrap argument cache"
+def _net_io_counters_cache_clear():
+    """Clears nowrap argument cache."""
+    for name in list(_wrap_numbers.cache_info()[0]):
+        if name == 'psutil.net_io_counters' or name.startswith(
+            'psutil.net_io_counters.'
+        ):
+            _wrap_numbers.cache_clear(name)
+
+
+net_io_counters.cache_clear = _net_io_counters_cache_clear
 
 
 def net_connections(kind: str = 'inet') -> list[sconn]:
@@ -2523,7 +3501,11 @@ def net_connections(kind: str = 'inet') -> list[sconn]:
     return _psplatform.net_connections(kind)
 
 
-def net_if_addrs() -> dict[str, list[snicaddr]]:
+_net_if_addrs_cache = None
+_net_if_addrs_lock = threading.Lock()
+
+
+def net_if_addrs(cached: bool = False) -> dict[str, list[snicaddr]]:
     """Return a dictionary mapping each NIC (Network Interface Card) to
     a list of named tuples representing its addresses. Multiple
     addresses of the same family can exist per interface.
@@ -2538,7 +3520,36 @@ def net_if_addrs() -> dict[str, list[snicaddr]]:
     - broadcast: the broadcast address; always None on Windows
     - ptp: a "point to point" address (typically a VPN); always None on
       Windows
+
+    If *cached* is True (Linux only, ignored elsewhere) the result is
+    cached, and rebuilt only after the kernel notifies that a NIC or
+    an address was added, removed or changed.
     """
+    global _net_if_addrs_cache
+
+    if not cached or not hasattr(_psplatform, "net_if_addrs_changed"):
+        return _net_if_addrs()
+    with _net_if_addrs_lock:
+        # Must be asked first: the first call subscribes to the
+        # notifications.
+        changed = _psplatform.net_if_addrs_changed()
+        if changed or _net_if_addrs_cache is None:
+            _net_if_addrs_cache = _net_if_addrs()
+        return {k: list(v) for k, v in _net_if_addrs_cache.items()}
+
+
+def _net_if_addrs_cache_clear():
+    """Clear net_if_addrs(cached=True) internal cache."""
+    global _net_if_addrs_cache
+
+    with _net_if_addrs_lock:
+        _net_if_addrs_cache = None
+
+
+net_if_addrs.cache_clear = _net_if_addrs_cache_clear
+
+
+def _net_if_addrs():
     rawlist = _psplatform.net_if_addrs()
     rawlist.sort(key=lambda x: x[1])  # sort by family
     ret = collections.defaultdict(list)
@@ -2608,6 +3619,15 @@ def net_if_stats() -> dict[str, snicstats]:
 # =====================================================================
 
 
+def _sensors_cache_clear():
+    """Clear sensors_temperatures() and sensors_fans() internal cache."""
+    # On Linux the sensors found in /sys and their static attributes
+    # (name, label, high, critical) are cached, and refreshed when a
+    # hwmon or thermal device is added or removed.
+    if hasattr(_psplatform, "sensors_cache_clear"):
+        _psplatform.sensors_cache_clear()
+
+
 # Linux, macOS
 if hasattr(_psplatform, "sensors_temperatures"):
 
@@ -2647,6 +3667,7 @@ if hasattr(_psplatform, "sensors_temperatures"):
 
         return dict(ret)
 
+    sensors_temperatures.cache_clear = _sensors_cache_clear
     __all__.append("sensors_temperatures")
 
 
@@ -2660,6 +3681,7 @@ if hasattr(_psplatform, "sensors_fans"):
         """
         return _psplatform.sensors_fans()
 
+    sensors_fans.cache_clear = _sensors_cache_clear
     __all__.append("sensors_fans")
 
 
@@ -2711,6 +3733,52 @@ def users() -> list[suser]:
     return _psplatform.users()
 
 
+if LINUX:
+
+    def open_files(
+        kind: str | Collection[str] = "all",
+        prefix: str | None = None,
+        inode: int | None = None,
+    ) -> list[sopenfile]:
+        """Return the file descriptors opened by all processes (like
+        "lsof") as a list of named tuples including the following
+        fields:
+
+         - pid: the process which owns the fd
+         - fd: the file descriptor number
+         - path: the file path, or what the kernel shows for other fd
+           kinds (e.g. "socket:[1234]", "anon_inode:[eventfd]")
+         - kind: one of "file", "dir", "socket", "pipe", "char",
+           "block", "eventfd", "eventpoll", "signalfd", "timerfd",
+           "inotify", "pidfd", "anon_inode", "other"
+         - inode: the inode number
+         - position: the file position
+         - mode: the open() mode ("r", "w", "a", "r+", "a+")
+         - flags: the open() flags
+
+        *kind* ("all", a kind or a collection of kinds), *prefix* (only
+        paths starting with it) and *inode* restrict the results, and
+        are applied before any Python object gets created. Processes
+        which can't be inspected because of limited privileges are
+        skipped.
+        """
+        if kind == "all":
+            kinds = None
+        elif isinstance(kind, str):
+            kinds = (kind,)
+        else:
+            kinds = tuple(kind)
+        if kinds is not None:
+            for k in kinds:
+                if k not in _psplatform.FD_KINDS:
+                    msg = f"invalid kind {k!r}; choose between "
+                    msg += ", ".join(map(repr, _psplatform.FD_KINDS))
+                    raise ValueError(msg)
+        return _psplatform.open_files(kinds, prefix, inode)
+
+    __all__.append("open_files")
+
+
 # =====================================================================
 # --- Windows services
 # =====================================================================
@@ -10,7 +10,9 @@ psutil or third-party modules.
 
 import collections
 import functools
+import operator
 import os
+import queue
 import socket
 import stat
 import sys
@@ -47,6 +49,7 @@ __all__ = [
     'supports_ipv6', 'sockfam_to_enum', 'socktype_to_enum', "wrap_numbers",
     'open_text', 'open_binary', 'cat', 'bcat',
     'bytes2human', 'conn_to_ntuple', 'debug', 'warn',
+    'memoize_when_scanning', 'ScanContext', 'call_with_timeout',
     # shell utils
     'hilite', 'term_supports_colors', 'print_color',
 ]
@@ -294,6 +297,148 @@ def memoize_when_activated(fun):
     return wrapper
 
 
+_scan_tls = threading.local()
+
+
+class ScanContext:
+    """A cache shared by all the processes visited by a single scan
+    (e.g. a `process_iter()` pass), meant to store system-wide values
+    which per-process methods depend on (boot time, total physical
+    memory, ...). While the context is entered, functions decorated
+    with `memoize_when_scanning` are computed once and then reused.
+    The cache outlives the `with` block, so the same context can be
+    entered once per process.
+
+    >>> ctx = ScanContext()
+    >>> for proc in procs:
+    ...     with ctx:
+    ...         proc.as_dict(attrs=["create_time"])
+    """
+
+    __slots__ = ("_cache", "_prev")
+
+    def __init__(self):
+        self._cache = {}
+        self._prev = None
+
+    def __enter__(self):
+        # A nested context (e.g. as_dict() called during a bulk scan)
+        # keeps using the outer cache.
+        self._prev = getattr(_scan_tls, "cache", None)
+        if self._prev is None:
+            _scan_tls.cache = self._cache
+        return self
+
+    def __exit__(self, *args):
+        _scan_tls.cache = self._prev
+        self._prev = None
+
+
+def memoize_when_scanning(fun):
+    """A memoize decorator for module-level functions accepting no
+    arguments, which is active only within a `ScanContext`. Outside of
+    it the decorated function is called every time.
+    """
+
+    @functools.wraps(fun)
+    def wrapper():
+        cache = getattr(_scan_tls, "cache", None)
+        if cache is None:
+            return fun()
+        try:
+            return cache[fun]
+        except KeyError:
+            ret = cache[fun] = fun()
+            return ret
+
+    return wrapper
+
+
+_worker_tls = threading.local()
+# Max number of workers left behind by call_with_timeout() at any time.
+_MAX_STUCK_WORKERS = 16
+# {done_event: key} of the jobs whose worker was left behind.
+_stuck = {}
+_stuck_lock = threading.Lock()
+
+
+class _Worker:
+    """A daemon thread running the functions passed to
+    `call_with_timeout()` on behalf of one calling thread.
+    """
+
+    __slots__ = ("jobs",)
+
+    def __init__(self):
+        self.jobs = queue.SimpleQueue()
+        # The thread only references the queue, so that this object
+        # (and the thread with it) goes away with the calling thread.
+        threading.Thread(
+            target=self._run, args=(self.jobs,), name="psutil", daemon=True
+        ).start()
+
+    def __del__(self):
+        self.jobs.put(None)
+
+    @staticmethod
+    def _run(jobs):
+        while True:
+            job = jobs.get()
+            if job is None:
+                return
+            fun, cache, done, errors = job
+            _scan_tls.cache = cache
+            try:
+                fun()
+            except Exception as err:  # noqa: BLE001
+                errors.append(err)
+            finally:
+                _scan_tls.cache = None
+            with _stuck_lock:
+                done.set()
+                _stuck.pop(done, None)
+
+
+def call_with_timeout(fun, timeout, key=None):
+    """Call *fun* in a worker thread and wait at most *timeout* seconds
+    for it to complete. Return True if it did (re-raising its exception
+    if any), False otherwise. In that case the worker, which may be
+    stuck in an uninterruptible system call (e.g. a read of
+    /proc/<pid>/cmdline while the target process holds its mmap lock),
+    is abandoned: it exits as soon as *fun* returns, and the next call
+    starts a new one. The `ScanContext` of the calling thread is shared
+    with the worker.
+
+    While a worker left behind by a call with the same *key* (e.g. a
+    process identity) is still running, or if too many workers have
+    been left behind, return False right away instead of starting
+    another one which would likely get stuck as well.
+    """
+    if timeout <= 0:
+        return False
+    with _stuck_lock:
+        if len(_stuck) >= _MAX_STUCK_WORKERS:
+            return False
+        if key is not None and key in _stuck.values():
+            return False
+    worker = getattr(_worker_tls, "worker", None)
+    if worker is None:
+        worker = _worker_tls.worker = _Worker()
+    done = threading.Event()
+    errors = []
+    cache = getattr(_scan_tls, "cache", None)
+    worker.jobs.put((fun, cache, done, errors))
+    if not done.wait(timeout):
+        with _stuck_lock:
+            if not done.is_set():
+                _stuck[done] = key
+                _worker_tls.worker = None
+                return False
+    if errors:
+        raise errors.pop()
+    return True
+
+
 def isfile_strict(path):
     """Same as os.path.isfile() but does not swallow EACCES / EPERM
     exceptions, see:
@@ -506,6 +651,16 @@ class _WrapNumbers:
                 new_dict[key] = input_tuple
                 continue
 
+            if (
+                (key, 0) in self.reminders[name]
+                and key not in self.reminder_keys[name]
+                and all(map(operator.ge, input_tuple, old_tuple))
+            ):
+                # Fast path: this key was seen before and nothing
+                # wrapped, now or in the past.
+                new_dict[key] = input_tuple
+                continue
+
             bits = []
             for i in range(len(input_tuple)):
                 input_value = input_tuple[i]
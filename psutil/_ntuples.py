@@ -16,6 +16,7 @@ if TYPE_CHECKING:
     from ._enums import ConnectionStatus
     from ._enums import NicDuplex
     from ._enums import ProcessIOPriority
+    from ._enums import ProcessStatus
 
 from ._common import AIX
 from ._common import BSD
@@ -50,6 +51,20 @@ class sdiskusage(NamedTuple):
     percent: float
 
 
+if not WINDOWS:
+
+    # psutil.disk_usage_many()
+    class sdiskusagefull(NamedTuple):
+        total: int
+        used: int
+        free: int
+        percent: float
+        inodes_total: int
+        inodes_used: int
+        inodes_free: int
+        inodes_percent: float
+
+
 # psutil.disk_io_counters()
 class sdiskio(NamedTuple):
     read_count: int
@@ -63,10 +78,29 @@ class sdiskio(NamedTuple):
         read_merged_count: int
         write_merged_count: int
         busy_time: int
+        weighted_time: int
+        discard_count: int
+        discard_merged_count: int
+        discard_bytes: int
+        discard_time: int
+        flush_count: int
+        flush_time: int
     if FREEBSD:
         busy_time: int
 
 
+if LINUX:
+
+    # psutil.disk_io_stats()
+    class sdiskiostats(NamedTuple):
+        read_await: float
+        write_await: float
+        total_await: float
+        service_time: float
+        queue_depth: float
+        busy_percent: float
+
+
 # psutil.disk_partitions()
 class sdiskpart(NamedTuple):
     device: str
@@ -113,6 +147,20 @@ class sconn(NamedTuple):
     pid: int | None
 
 
+if LINUX:
+
+    # psutil.open_files()
+    class sopenfile(NamedTuple):
+        pid: int
+        fd: int
+        path: str
+        kind: str
+        inode: int
+        position: int
+        mode: str
+        flags: int
+
+
 # psutil.net_if_addrs()
 class snicaddr(NamedTuple):
     family: socket.AddressFamily
@@ -196,6 +244,17 @@ class sfan(NamedTuple):
     current: int
 
 
+# psutil.process_rollup()
+class sprocgroup(NamedTuple):
+    count: int
+    rss: int
+    pss: int | None
+    cpu_time: float
+    io_bytes: int
+    num_threads: int
+    num_fds: int
+
+
 if LINUX or WINDOWS or MACOS or BSD:
 
     # psutil.heap_info()
@@ -268,6 +327,22 @@ class pthread(NamedTuple):
     system_time: float
 
 
+if LINUX:
+
+    # psutil.Process.threads_info()
+    class pthreadinfo(NamedTuple):
+        id: int
+        name: str
+        status: ProcessStatus | str
+        cpu_num: int
+        user_time: float
+        system_time: float
+        voluntary_ctx_switches: int
+        involuntary_ctx_switches: int
+        run_time: float
+        wait_time: float
+
+
 # psutil.Process.uids()
 class puids(NamedTuple):
     real: int
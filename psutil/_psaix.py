@@ -148,6 +148,7 @@ def cpu_stats():
 
 disk_io_counters = _psutil.disk_io_counters
 disk_usage = _psposix.disk_usage
+disk_usage_many = _psposix.disk_usage_many
 
 
 def disk_partitions(all=False):
@@ -232,6 +232,7 @@ def disk_partitions(all=False):
 
 
 disk_usage = _psposix.disk_usage
+disk_usage_many = _psposix.disk_usage_many
 disk_io_counters = _psutil.disk_io_counters
 
 
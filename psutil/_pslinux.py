@@ -6,6 +6,7 @@
 
 import base64
 import collections
+import contextlib
 import enum
 import errno
 import functools
@@ -16,13 +17,14 @@ import resource
 import socket
 import struct
 import sys
+import threading
+import time
 import warnings
 from collections import defaultdict
 
 from . import _ntuples as ntp
 from . import _psposix
 from . import _psutil
-from ._common import ENCODING
 from ._common import AccessDenied
 from ._common import NoSuchProcess
 from ._common import ZombieProcess
@@ -33,6 +35,7 @@ from ._common import decode
 from ._common import get_procfs_path
 from ._common import isfile_strict
 from ._common import memoize_when_activated
+from ._common import memoize_when_scanning
 from ._common import open_binary
 from ._common import open_text
 from ._common import parse_environ_block
@@ -54,7 +57,9 @@ __extra__all__ = ['PROCFS_PATH']
 # =====================================================================
 
 
+SYSFS_PATH = "/sys"
 POWER_SUPPLY_PATH = "/sys/class/power_supply"
+CPU_SYSFS_PATH = "/sys/devices/system/cpu"
 HAS_PROC_SMAPS = os.path.exists(f"/proc/{os.getpid()}/smaps")
 HAS_PROC_SMAPS_ROLLUP = os.path.exists(f"/proc/{os.getpid()}/smaps_rollup")
 HAS_PROC_IO_PRIORITY = hasattr(_psutil, "proc_ioprio_get")
@@ -180,6 +185,35 @@ def is_storage_device(name):
     return os.access(path, os.F_OK)
 
 
+class StorageDevices:
+    """Cache is_storage_device() results. They never change for a given
+    device name, but we can't tell whether a name refers to the same
+    device over time, so the whole cache is rebuilt when the list of
+    devices (e.g. in /proc/diskstats) changes.
+    """
+
+    __slots__ = ['_cache']
+
+    def __init__(self):
+        self._cache = None
+
+    def clear(self):
+        self._cache = None
+
+    def get(self, names):
+        """Return the subset of `names` which are storage devices."""
+        key = tuple(names)
+        cache = self._cache
+        if cache is None or cache[0] != key:
+            cache = (key, {x for x in names if is_storage_device(x)})
+            self._cache = cache
+        return cache[1]
+
+
+_storage_devices = StorageDevices()
+disk_io_cache_clear = _storage_devices.clear
+
+
 # =====================================================================
 # --- system memory
 # =====================================================================
@@ -612,87 +646,163 @@ def cpu_stats():
 
 def _cpu_get_cpuinfo_freq():
     """Return current CPU frequency from cpuinfo if available."""
-    ret = []
-    with open_binary(f"{get_procfs_path()}/cpuinfo") as f:
-        for line in f:
-            key, _, value = line.partition(b':')
-            key = key.strip().lower()
-            # x86 says "cpu MHz", ppc "clock" (with a MHz suffix),
-            # s390x "cpu MHz dynamic" plus a "static" one we skip.
-            # https://github.com/torvalds/linux/blob/master/arch/powerpc/kernel/setup-common.c
-            # https://github.com/torvalds/linux/blob/master/arch/s390/kernel/processor.c
-            if key in {b'cpu mhz', b'clock', b'cpu mhz dynamic'}:
-                value = value.strip()
-                if value.endswith(b"MHz"):
-                    value = value[:-3]
-                ret.append(float(value))
-    return ret
+    return _psutil.cpuinfo_freqs(f"{get_procfs_path()}/cpuinfo")
+
+
+class CpuFreqTopology:
+    """Cache which cpufreq policy governs which CPU, plus the min and
+    max frequencies of each policy. With hundreds of CPUs, globbing
+    the policy dirs and reading "affected_cpus" and the min / max
+    files on every cpu_freq() call is what makes it slow, while none
+    of this changes unless a CPU goes online or offline. As such we
+    re-scan only when the content of /sys/devices/system/cpu/online
+    changes (or on cache_clear()), and read the only files which do
+    change (the current frequencies) from C.
+    """
 
+    __slots__ = ['_cache']
 
-if os.path.exists("/sys/devices/system/cpu/cpufreq/policy0") or os.path.exists(
-    "/sys/devices/system/cpu/cpu0/cpufreq"
-):
+    # one per online CPU, sorted by CPU number
+    CpuEntry = collections.namedtuple(
+        'CpuEntry', ['cpu', 'policy', 'curr_file', 'min', 'max']
+    )
 
-    def cpu_freq():
-        """Return frequency metrics for all CPUs.
-        Contrarily to other OSes, Linux updates these values in
-        real-time.
-        """
-        pjoin = os.path.join
-        cpuinfo_freqs = _cpu_get_cpuinfo_freq()
-        paths = glob.glob(
-            "/sys/devices/system/cpu/cpufreq/policy[0-9]*"
-        ) or glob.glob("/sys/devices/system/cpu/cpu[0-9]*/cpufreq")
+    def __init__(self):
+        self._cache = None
+
+    def clear(self):
+        self._cache = None
+
+    def scan(self, root):
+        paths = glob.glob(f"{root}/cpufreq/policy[0-9]*") or glob.glob(
+            f"{root}/cpu[0-9]*/cpufreq"
+        )
 
         # One policy may govern more than one CPU, so ask each policy
         # which CPUs it affects instead of assuming one per CPU. Offline
         # CPUs are listed by no policy, and are therefore left out.
         # https://github.com/giampaolo/psutil/issues/2512
-        cpu_to_path = {}
+        cpu_to_policy = {}
         for path in paths:
-            affected = bcat(pjoin(path, "affected_cpus"), fallback=None)
+            policy = os.path.relpath(path, root)
+            affected = bcat(f"{path}/affected_cpus", fallback=None)
             if affected is None:
-                cpu_to_path[int(re.search(r"[0-9]+", path).group())] = path
+                cpu = int(re.search(r"[0-9]+", policy).group())
+                cpu_to_policy[cpu] = policy
             else:
                 for cpu in affected.split():
-                    cpu_to_path[int(cpu)] = path
+                    cpu_to_policy[int(cpu)] = policy
+
+        policies = sorted(set(cpu_to_policy.values()))
+        names = []
+        for policy in policies:
+            names.extend((
+                f"{policy}/scaling_min_freq",
+                f"{policy}/scaling_max_freq",
+            ))
+        values = iter(_psutil.sysfs_read_ints(root, names))
+        minmax = {}
+        for policy in policies:
+            min_, max_ = next(values), next(values)
+            minmax[policy] = ((min_ or 0) / 1000, (max_ or 0) / 1000)
 
         ret = []
-        for i, cpu in enumerate(sorted(cpu_to_path)):
-            path = cpu_to_path[cpu]
-            if len(cpu_to_path) == len(cpuinfo_freqs):
-                # take cached value from cpuinfo if available, see:
-                # https://github.com/giampaolo/psutil/issues/1851
-                curr = cpuinfo_freqs[i] * 1000
-            else:
-                curr = bcat(pjoin(path, "scaling_cur_freq"), fallback=None)
-            if curr is None:
-                # Likely an old RedHat, see:
-                # https://github.com/giampaolo/psutil/issues/1071
-                curr = bcat(pjoin(path, "cpuinfo_cur_freq"), fallback=None)
-                if curr is None:
-                    online_path = f"/sys/devices/system/cpu/cpu{cpu}/online"
-                    # If the CPU core is offline skip it instead of
-                    # reporting it as all zeroes, otherwise it drags
-                    # down the average frequency. See:
-                    # https://github.com/giampaolo/psutil/issues/2628
-                    if cat(online_path, fallback=None) == "0\n":
-                        continue
-                    msg = "can't find current frequency file"
-                    raise NotImplementedError(msg)
-            curr = int(curr) / 1000
-            max_ = int(bcat(pjoin(path, "scaling_max_freq"))) / 1000
-            min_ = int(bcat(pjoin(path, "scaling_min_freq"))) / 1000
-            ret.append(ntp.scpufreq(curr, min_, max_))
+        for cpu in sorted(cpu_to_policy):
+            policy = cpu_to_policy[cpu]
+            curr_file = None
+            # "cpuinfo_cur_freq" is likely an old RedHat, see:
+            # https://github.com/giampaolo/psutil/issues/1071
+            for name in ("scaling_cur_freq", "cpuinfo_cur_freq"):
+                if os.path.exists(f"{root}/{policy}/{name}"):
+                    curr_file = f"{policy}/{name}"
+                    break
+            min_, max_ = minmax[policy]
+            ret.append(self.CpuEntry(cpu, policy, curr_file, min_, max_))
         return ret
 
-else:
-
-    def cpu_freq():
-        """Alternate implementation using /proc/cpuinfo.
-        min and max frequencies are not available and are set to 0.
+    def get(self):
+        """Return a list of CpuEntry, re-scanning sysfs only if the set
+        of online CPUs changed since last call.
         """
-        return [ntp.scpufreq(x, 0.0, 0.0) for x in _cpu_get_cpuinfo_freq()]
+        root = CPU_SYSFS_PATH
+        key = (root, bcat(f"{root}/online", fallback=None))
+        cache = self._cache
+        if cache is None or cache[0] != key:
+            # Replaced as a whole, so that concurrent readers never see
+            # a half-updated cache.
+            cache = (key, self.scan(root))
+            self._cache = cache
+        return cache[1]
+
+
+_cpufreq_topology = CpuFreqTopology()
+cpu_freq_cache_clear = _cpufreq_topology.clear
+
+
+def cpu_freq():
+    """Return frequency metrics for all CPUs.
+    Contrarily to other OSes, Linux updates these values in
+    real-time. If cpufreq is not available min and max frequencies
+    are set to 0 and the current one is taken from /proc/cpuinfo.
+    """
+    cpus = _cpufreq_topology.get()
+    cpuinfo_freqs = _cpu_get_cpuinfo_freq()
+    if not cpus:
+        return [ntp.scpufreq(x, 0.0, 0.0) for x in cpuinfo_freqs]
+
+    if len(cpus) == len(cpuinfo_freqs):
+        # take cached value from cpuinfo if available, see:
+        # https://github.com/giampaolo/psutil/issues/1851
+        currs = cpuinfo_freqs
+    else:
+        names = [x.curr_file for x in cpus if x.curr_file is not None]
+        values = iter(_psutil.sysfs_read_ints(CPU_SYSFS_PATH, names))
+        currs = []
+        for entry in cpus:
+            curr = next(values) if entry.curr_file is not None else None
+            if curr is None:
+                online_path = f"{CPU_SYSFS_PATH}/cpu{entry.cpu}/online"
+                # If the CPU core is offline skip it instead of
+                # reporting it as all zeroes, otherwise it drags
+                # down the average frequency. See:
+                # https://github.com/giampaolo/psutil/issues/2628
+                if cat(online_path, fallback=None) == "0\n":
+                    currs.append(None)
+                    continue
+                msg = "can't find current frequency file"
+                raise NotImplementedError(msg)
+            currs.append(curr / 1000)
+
+    return [
+        ntp.scpufreq(curr, entry.min, entry.max)
+        for entry, curr in zip(cpus, currs)
+        if curr is not None
+    ]
+
+
+def cpu_freq_times(percpu=True):
+    """Return the time spent at each frequency as a list of
+    {freq_mhz: seconds} dicts, from the cpufreq stats in
+    /sys/devices/system/cpu/cpufreq/policy*/stats/time_in_state.
+    These are kept per cpufreq policy: if *percpu* is True return one
+    dict per CPU (CPUs sharing a policy get the same values), else one
+    per policy. A dict is empty if stats are not available (kernels
+    built without CONFIG_CPU_FREQ_STAT, or drivers such as
+    intel_pstate in active mode which don't expose them).
+    """
+    cpus = _cpufreq_topology.get()
+    policies = list(dict.fromkeys(x.policy for x in cpus))
+    names = [f"{x}/stats/time_in_state" for x in policies]
+    rawlists = _psutil.cpufreq_time_in_state(CPU_SYSFS_PATH, names)
+    bypolicy = {}
+    for policy, rawlist in zip(policies, rawlists):
+        freqs = {}
+        for freq, ticks in sorted(rawlist or ()):
+            freqs[freq / 1000] = ticks / CLOCK_TICKS
+        bypolicy[policy] = freqs
+    if not percpu:
+        return list(bypolicy.values())
+    return [bypolicy[x.policy].copy() for x in cpus]
 
 
 # =====================================================================
@@ -703,6 +813,54 @@ else:
 net_if_addrs = _psutil.net_if_addrs
 
 
+class NetIfChangesWatcher:
+    """Tell whether a NIC or an IPv4 / IPv6 address was added, removed
+    or changed since the last call, by listening to rtnetlink
+    notifications (RTMGRP_LINK, RTMGRP_IPV4_IFADDR and
+    RTMGRP_IPV6_IFADDR groups). The socket is opened on first use.
+    """
+
+    __slots__ = ['_fd', '_lock', '_pid']
+
+    def __init__(self):
+        self._fd = None
+        self._pid = None
+        self._lock = threading.Lock()
+
+    def _close(self):
+        if self._fd is not None:
+            with contextlib.suppress(OSError):
+                os.close(self._fd)
+            self._fd = None
+
+    def changed(self):
+        """Return True if something changed since the last call. The
+        first call always returns True.
+        """
+        with self._lock:
+            if self._fd is not None and self._pid == os.getpid():
+                try:
+                    return _psutil.net_if_notify_drain(self._fd)
+                except OSError as err:
+                    debug(err)
+            # First call, or a forked child: the socket would be
+            # shared with the parent, which would steal notifications.
+            # Subscribe before the caller takes a new snapshot, so
+            # that no change can go unnoticed.
+            self._close()
+            try:
+                self._fd = _psutil.net_if_notify_open()
+            except OSError as err:
+                # Keep retrying (and reporting a change) next time.
+                debug(err)
+            else:
+                self._pid = os.getpid()
+            return True
+
+
+net_if_addrs_changed = NetIfChangesWatcher().changed
+
+
 class _Ipv6UnsupportedError(Exception):
     pass
 
@@ -951,10 +1109,36 @@ def net_connections(kind='inet'):
     return _net_connections.retrieve(kind)
 
 
-def net_io_counters():
+def net_io_counters(prefix=None, ifindex=None):
     """Return network I/O statistics for every network interface
-    installed on the system as a dict of raw tuples.
+    installed on the system as a dict of raw tuples. If *prefix* is
+    specified only include the interfaces whose name starts with it,
+    if *ifindex* is specified only include that interface.
     """
+    if get_procfs_path() == "/proc":
+        # rtnetlink reports the interfaces of the network namespace we
+        # live in, same as /proc/self/net/dev, in one binary round trip
+        # instead of a text file to parse. On a custom PROCFS_PATH we
+        # have to read the text file though (it may refer to another
+        # namespace or be a fake tree).
+        try:
+            rawlist = _psutil.net_io_counters_netlink(
+                prefix or "", ifindex or 0
+            )
+        except OSError as err:
+            # E.g. netlink sockets forbidden by a seccomp policy.
+            debug(err)
+        else:
+            return {x[0]: x[1:] for x in rawlist}
+
+    if ifindex:
+        try:
+            ifname = socket.if_indextoname(ifindex)
+        except OSError:
+            return {}
+    else:
+        ifname = None
+
     with open_text(f"{get_procfs_path()}/net/dev") as f:
         lines = f.readlines()
     retdict = {}
@@ -962,6 +1146,10 @@ def net_io_counters():
         colon = line.rfind(':')
         assert colon > 0, repr(line)
         name = line[:colon].strip()
+        if prefix and not name.startswith(prefix):
+            continue
+        if ifname is not None and name != ifname:
+            continue
         fields = line[colon + 1 :].strip().split()
 
         (
@@ -1005,6 +1193,25 @@ def net_if_stats():
         _psutil.DUPLEX_HALF: NicDuplex.NIC_DUPLEX_HALF,
         _psutil.DUPLEX_UNKNOWN: NicDuplex.NIC_DUPLEX_UNKNOWN,
     }
+    if get_procfs_path() == "/proc":
+        # All NICs at once, through a couple of netlink dumps.
+        try:
+            rawlist = _psutil.net_if_stats_netlink()
+        except OSError as err:
+            # E.g. netlink sockets forbidden by a seccomp policy.
+            debug(err)
+        else:
+            return {
+                name: ntp.snicstats(
+                    'running' in flags,
+                    duplex_map.get(duplex, NicDuplex.NIC_DUPLEX_UNKNOWN),
+                    speed,
+                    mtu,
+                    ','.join(flags),
+                )
+                for name, flags, mtu, duplex, speed in rawlist
+            }
+
     names = net_io_counters().keys()
     ret = {}
     for name in names:
@@ -1032,6 +1239,7 @@ def net_if_stats():
 
 
 disk_usage = _psposix.disk_usage
+disk_usage_many = _psposix.disk_usage_many
 
 
 def disk_io_counters(perdisk=False):
@@ -1040,50 +1248,15 @@ def disk_io_counters(perdisk=False):
     """
 
     def read_procfs():
-        # OK, this is a bit confusing. The format of /proc/diskstats can
-        # have 3 variations.
-        # On Linux 2.4 each line has always 15 fields, e.g.:
-        # "3     0   8 hda 8 8 8 8 8 8 8 8 8 8 8"
-        # On Linux 2.6+ each line *usually* has 14 fields, and the disk
-        # name is in another position, like this:
-        # "3    0   hda 8 8 8 8 8 8 8 8 8 8 8"
-        # ...unless (Linux 2.6) the line refers to a partition instead
-        # of a disk, in which case the line has less fields (7):
-        # "3    1   hda1 8 8 8 8"
-        # 4.18+ has 4 fields added:
-        # "3    0   hda 8 8 8 8 8 8 8 8 8 8 8 0 0 0 0"
-        # 5.5 has 2 more fields.
-        # See:
+        # See parse_diskstats_line() in arch/linux/disk.c for the
+        # format variations. Here we get all the numeric columns which
+        # come after the disk name, whose number depends on the kernel
+        # version. See:
         # https://www.kernel.org/doc/Documentation/iostats.txt
         # https://www.kernel.org/doc/Documentation/ABI/testing/procfs-diskstats
-        with open_text(f"{get_procfs_path()}/diskstats") as f:
-            lines = f.readlines()
-        for line in lines:
-            fields = line.split()
-            flen = len(fields)
-            # fmt: off
-            if flen == 15:
-                # Linux 2.4
-                name = fields[3]
-                reads = int(fields[2])
-                (reads_merged, rbytes, rtime, writes, writes_merged,
-                    wbytes, wtime, _, busy_time, _) = map(int, fields[4:14])
-            elif flen == 14 or flen >= 18:
-                # Linux 2.6+, line referring to a disk
-                name = fields[2]
-                (reads, reads_merged, rbytes, rtime, writes, writes_merged,
-                    wbytes, wtime, _, busy_time, _) = map(int, fields[3:14])
-            elif flen == 7:
-                # Linux 2.6+, line referring to a partition
-                name = fields[2]
-                reads, rbytes, writes, wbytes = map(int, fields[3:])
-                rtime = wtime = reads_merged = writes_merged = busy_time = 0
-            else:
-                msg = f"not sure how to interpret line {line!r}"
-                raise ValueError(msg)
-            yield (name, reads, writes, rbytes, wbytes, rtime, wtime,
-                   reads_merged, writes_merged, busy_time)
-            # fmt: on
+        return _psutil.disk_io_counters_procfs(
+            f"{get_procfs_path()}/diskstats"
+        )
 
     def read_sysfs():
         for block in os.listdir('/sys/block'):
@@ -1091,19 +1264,13 @@ def disk_io_counters(perdisk=False):
                 if 'stat' not in files:
                     continue
                 with open_text(os.path.join(root, 'stat')) as f:
-                    fields = f.read().strip().split()
-                name = os.path.basename(root)
-                # fmt: off
-                (reads, reads_merged, rbytes, rtime, writes, writes_merged,
-                    wbytes, wtime, _, busy_time) = map(int, fields[:10])
-                yield (name, reads, writes, rbytes, wbytes, rtime,
-                       wtime, reads_merged, writes_merged, busy_time)
-                # fmt: on
+                    fields = tuple(map(int, f.read().split()))
+                yield os.path.basename(root), fields
 
     if os.path.exists(f"{get_procfs_path()}/diskstats"):
-        gen = read_procfs()
+        entries = read_procfs()
     elif os.path.exists('/sys/block'):
-        gen = read_sysfs()
+        entries = list(read_sysfs())
     else:
         msg = (
             f"{get_procfs_path()}/diskstats nor /sys/block are available on"
@@ -1111,29 +1278,48 @@ def disk_io_counters(perdisk=False):
         )
         raise NotImplementedError(msg)
 
+    if not perdisk:
+        # perdisk=False means we want to calculate totals so we skip
+        # partitions (e.g. 'sda1', 'nvme0n1p1') and only include
+        # base disk devices (e.g. 'sda', 'nvme0n1'). Base disks
+        # include a total of all their partitions + some extra size
+        # of their own:
+        #     $ cat /proc/diskstats
+        #     259       0 sda 10485760 ...
+        #     259       1 sda1 5186039 ...
+        #     259       1 sda2 5082039 ...
+        # See:
+        # https://github.com/giampaolo/psutil/pull/1313
+        storage_devices = _storage_devices.get([x[0] for x in entries])
+
     retdict = {}
-    for entry in gen:
-        # fmt: off
-        (name, reads, writes, rbytes, wbytes, rtime, wtime, reads_merged,
-            writes_merged, busy_time) = entry
-        if not perdisk and not is_storage_device(name):
-            # perdisk=False means we want to calculate totals so we skip
-            # partitions (e.g. 'sda1', 'nvme0n1p1') and only include
-            # base disk devices (e.g. 'sda', 'nvme0n1'). Base disks
-            # include a total of all their partitions + some extra size
-            # of their own:
-            #     $ cat /proc/diskstats
-            #     259       0 sda 10485760 ...
-            #     259       1 sda1 5186039 ...
-            #     259       1 sda2 5082039 ...
-            # See:
-            # https://github.com/giampaolo/psutil/pull/1313
+    for name, fields in entries:
+        if not perdisk and name not in storage_devices:
             continue
-
-        rbytes *= DISK_SECTOR_SIZE
-        wbytes *= DISK_SECTOR_SIZE
-        retdict[name] = (reads, writes, rbytes, wbytes, rtime, wtime,
-                         reads_merged, writes_merged, busy_time)
+        if len(fields) == 4:
+            # Linux 2.6+, line referring to a partition
+            reads, rbytes, writes, wbytes = fields
+            fields = (reads, 0, rbytes, 0, writes, 0, wbytes, 0, 0, 0, 0)
+        elif len(fields) == 12:
+            # Linux 2.4
+            fields = fields[:11]
+        elif len(fields) < 11:
+            msg = f"not sure how to interpret {name!r} fields {fields!r}"
+            raise ValueError(msg)
+        # Missing columns (discard stats added in 4.18, flush stats in
+        # 5.5) are set to 0.
+        fields = tuple(fields[:17]) + (0,) * (17 - len(fields))
+        # fmt: off
+        (reads, reads_merged, rbytes, rtime, writes, writes_merged, wbytes,
+            wtime, _in_flight, busy_time, weighted_time, discards,
+            discards_merged, dbytes, dtime, flushes, ftime) = fields
+        retdict[name] = (
+            reads, writes, rbytes * DISK_SECTOR_SIZE,
+            wbytes * DISK_SECTOR_SIZE, rtime, wtime, reads_merged,
+            writes_merged, busy_time, weighted_time, discards,
+            discards_merged, dbytes * DISK_SECTOR_SIZE, dtime, flushes,
+            ftime,
+        )
         # fmt: on
 
     return retdict
@@ -1214,8 +1400,7 @@ class RootFsDeviceFinder:
             return path
 
 
-def disk_partitions(all=False):
-    """Return mounted disk partitions as a list of named tuples."""
+def _disk_partitions(all=False):
     fstypes = set()
     procfs_path = get_procfs_path()
 
@@ -1254,8 +1439,17 @@ def disk_partitions(all=False):
     else:
         mounts_path = os.path.realpath(f"{procfs_path}/self/mounts")
 
+    # If /etc/mtab is (a link to) /proc/<pid>/mounts read the sibling
+    # mountinfo file instead: it's what the kernel generates mounts
+    # from, and the C parser handles it without taking the GIL.
+    mountinfo = mounts_path.startswith(
+        procfs_path + "/"
+    ) and mounts_path.endswith("/mounts")
+    if mountinfo:
+        mounts_path = mounts_path[: -len("mounts")] + "mountinfo"
+
     retlist = []
-    partitions = _psutil.disk_partitions(mounts_path)
+    partitions = _psutil.disk_partitions(mounts_path, mountinfo)
     for partition in partitions:
         device, mountpoint, fstype, opts = partition
         if device == 'none':
@@ -1271,126 +1465,335 @@ def disk_partitions(all=False):
     return retlist
 
 
+class MountsCache:
+    """Cache disk_partitions() results until something gets mounted or
+    unmounted. /proc/self/mountinfo is kept open and polled for
+    POLLPRI, which the kernel raises on every change of the mount
+    namespace. A custom PROCFS_PATH disables caching.
+    """
+
+    __slots__ = ['_cache', '_fd', '_lock', '_pid']
+
+    def __init__(self):
+        self._cache = {}
+        self._fd = None
+        self._pid = None
+        self._lock = threading.Lock()
+
+    def _close(self):
+        if self._fd is not None:
+            with contextlib.suppress(OSError):
+                os.close(self._fd)
+            self._fd = None
+
+    def _changed(self):
+        if self._fd is not None and self._pid == os.getpid():
+            try:
+                return _psutil.mounts_changed(self._fd)
+            except OSError as err:
+                debug(err)
+        # First call, or a forked child (which may live in a different
+        # mount namespace). Open the file before the caller re-reads
+        # it, so that no change can go unnoticed.
+        self._close()
+        try:
+            self._fd = os.open(
+                "/proc/self/mountinfo", os.O_RDONLY | os.O_CLOEXEC
+            )
+        except OSError as err:
+            debug(err)
+        else:
+            self._pid = os.getpid()
+        return True
+
+    def get(self, all=False):
+        if get_procfs_path() != "/proc":
+            return _disk_partitions(all)
+        with self._lock:
+            if self._changed():
+                self._cache.clear()
+            elif all in self._cache:
+                return list(self._cache[all])
+            ret = _disk_partitions(all)
+            if self._fd is not None:
+                self._cache[all] = ret
+            return list(ret)
+
+    def cache_clear(self):
+        with self._lock:
+            self._cache.clear()
+            self._close()
+
+
+_mounts_cache = MountsCache()
+
+
+def disk_partitions(all=False):
+    """Return mounted disk partitions as a list of named tuples."""
+    return _mounts_cache.get(all)
+
+
+disk_partitions_cache_clear = _mounts_cache.cache_clear
+
+
 # =====================================================================
-# --- sensors
+# --- open files
 # =====================================================================
 
 
-def sensors_temperatures():
-    """Return hardware (CPU and others) temperatures as a dict
-    including hardware name, label, current, max and critical
-    temperatures.
+FD_KINDS = (
+    "file",
+    "dir",
+    "socket",
+    "pipe",
+    "char",
+    "block",
+    "eventfd",
+    "eventpoll",
+    "signalfd",
+    "timerfd",
+    "inotify",
+    "pidfd",
+    "anon_inode",
+    "other",
+)
 
-    Implementation notes:
-    - /sys/class/hwmon looks like the most recent interface to
-      retrieve this info, and this implementation relies on it
-      only (old distros will probably use something else)
-    - lm-sensors on Ubuntu 16.04 relies on /sys/class/hwmon
-    - /sys/class/thermal/thermal_zone* is another one but it's more
-      difficult to parse
+
+def open_files(kinds=None, prefix=None, inode=None):
+    """Return the file descriptors opened by all processes as a list
+    of named tuples. Filters are applied in C.
     """
-    ret = collections.defaultdict(list)
-    basenames = glob.glob('/sys/class/hwmon/hwmon*/temp*_*')
-    # CentOS has an intermediate /device directory:
-    # https://github.com/giampaolo/psutil/issues/971
-    # https://github.com/nicolargo/glances/issues/1060
-    basenames.extend(glob.glob('/sys/class/hwmon/hwmon*/device/temp*_*'))
-    basenames = sorted({x.split('_')[0] for x in basenames})
-
-    # Only add the coretemp hwmon entries if they're not already in
-    # /sys/class/hwmon/
-    # https://github.com/giampaolo/psutil/issues/1708
-    # https://github.com/giampaolo/psutil/pull/1648
-    basenames2 = glob.glob(
-        '/sys/devices/platform/coretemp.*/hwmon/hwmon*/temp*_*'
+    rawlist = _psutil.open_files_scan(
+        get_procfs_path(),
+        -1,
+        prefix,
+        -1 if inode is None else inode,
+        kinds,
     )
-    repl = re.compile(r"/sys/devices/platform/coretemp.*/hwmon/")
-    for name in basenames2:
-        altname = repl.sub('/sys/class/hwmon/', name)
-        if altname not in basenames:
-            basenames.append(name)
+    return [
+        ntp.sopenfile(
+            pid, fd, path, kind, ino, pos, file_flags_to_mode(flags), flags
+        )
+        for pid, fd, path, kind, ino, pos, flags in rawlist
+    ]
 
-    for base in basenames:
-        try:
-            path = base + '_input'
-            current = float(bcat(path)) / 1000.0
-            path = os.path.join(os.path.dirname(base), 'name')
-            unit_name = cat(path).strip()
-        except (OSError, ValueError):
-            # A lot of things can go wrong here, so let's just skip the
-            # whole entry. Sure thing is Linux's /sys/class/hwmon really
-            # is a stinky broken mess.
-            # https://github.com/giampaolo/psutil/issues/1009
-            # https://github.com/giampaolo/psutil/issues/1101
-            # https://github.com/giampaolo/psutil/issues/1129
-            # https://github.com/giampaolo/psutil/issues/1245
-            # https://github.com/giampaolo/psutil/issues/1323
-            continue
 
-        high = bcat(base + '_max', fallback=None)
-        critical = bcat(base + '_crit', fallback=None)
-        label = cat(base + '_label', fallback='').strip()
+# =====================================================================
+# --- sensors
+# =====================================================================
+
+
+class SensorsTopology:
+    """Cache the hwmon and thermal zone sensors found in /sys, and
+    their static attributes (name, label, max, crit, trip points).
+    Discovering them takes several glob() calls plus reading a bunch
+    of files which never change, so this is done only when the
+    devices listed in /sys/class/hwmon or /sys/class/thermal change.
+    The current values are then read from C in one go.
+    """
+
+    __slots__ = ['_fans', '_temps']
+
+    def __init__(self):
+        self._temps = None
+        self._fans = None
+
+    def clear(self):
+        self._temps = None
+        self._fans = None
 
-        if high is not None:
+    @staticmethod
+    def devices_key(root):
+        """Return something which changes when a hwmon or thermal
+        device is added or removed. hwmonN numbers are reused, so we
+        also look at the device each entry links to.
+        """
+        ret = [root]
+        for subdir in ("class/hwmon", "class/thermal"):
+            path = f"{root}/{subdir}"
             try:
-                high = float(high) / 1000.0
-            except ValueError:
-                high = None
-        if critical is not None:
+                names = sorted(os.listdir(path))
+            except OSError:
+                names = []
+            for name in names:
+                try:
+                    target = os.readlink(f"{path}/{name}")
+                except OSError:
+                    target = None
+                ret.append((name, target))
+        return tuple(ret)
+
+    @staticmethod
+    def _sensor_base(path):
+        # "/sys/class/hwmon/hwmon0/temp1_input" -> ".../hwmon0/temp1"
+        head, tail = os.path.split(path)
+        return os.path.join(head, tail.split('_')[0])
+
+    @staticmethod
+    def _read_temp(path):
+        value = bcat(path, fallback=None)
+        if value is not None:
             try:
-                critical = float(critical) / 1000.0
+                return float(value) / 1000.0
             except ValueError:
+                pass
+        return None
+
+    def scan_temperatures(self, root):
+        """Return a list of (unit_name, label, input_file, high,
+        critical) tuples, where input_file is relative to `root`.
+        """
+        ret = []
+        basenames = glob.glob(f"{root}/class/hwmon/hwmon*/temp*_*")
+        # CentOS has an intermediate /device directory:
+        # https://github.com/giampaolo/psutil/issues/971
+        # https://github.com/nicolargo/glances/issues/1060
+        basenames.extend(
+            glob.glob(f"{root}/class/hwmon/hwmon*/device/temp*_*")
+        )
+        basenames = sorted({self._sensor_base(x) for x in basenames})
+
+        # Only add the coretemp hwmon entries if they're not already in
+        # /sys/class/hwmon/
+        # https://github.com/giampaolo/psutil/issues/1708
+        # https://github.com/giampaolo/psutil/pull/1648
+        basenames2 = glob.glob(
+            f"{root}/devices/platform/coretemp.*/hwmon/hwmon*/temp*_*"
+        )
+        repl = re.compile(
+            re.escape(root) + r"/devices/platform/coretemp.*/hwmon/"
+        )
+        for name in basenames2:
+            altname = repl.sub(f"{root}/class/hwmon/", name)
+            if altname not in basenames:
+                basenames.append(name)
+
+        for base in basenames:
+            try:
+                path = os.path.join(os.path.dirname(base), 'name')
+                unit_name = cat(path).strip()
+            except (OSError, ValueError):
+                # A lot of things can go wrong here, so let's just skip
+                # the whole entry. Sure thing is Linux's /sys/class/hwmon
+                # really is a stinky broken mess.
+                # https://github.com/giampaolo/psutil/issues/1009
+                # https://github.com/giampaolo/psutil/issues/1101
+                # https://github.com/giampaolo/psutil/issues/1129
+                # https://github.com/giampaolo/psutil/issues/1245
+                # https://github.com/giampaolo/psutil/issues/1323
+                continue
+
+            high = self._read_temp(base + '_max')
+            critical = self._read_temp(base + '_crit')
+            label = cat(base + '_label', fallback='').strip()
+            input_file = os.path.relpath(base + '_input', root)
+            ret.append((unit_name, label, input_file, high, critical))
+
+        # Indication that no sensors were detected in /sys/class/hwmon/
+        if not basenames:
+            basenames = glob.glob(f"{root}/class/thermal/thermal_zone*")
+            basenames = sorted(set(basenames))
+
+            for base in basenames:
+                try:
+                    path = os.path.join(base, 'type')
+                    unit_name = cat(path).strip()
+                except (OSError, ValueError) as err:
+                    debug(err)
+                    continue
+
+                trip_paths = glob.glob(base + '/trip_point*')
+                trip_points = {
+                    '_'.join(os.path.basename(p).split('_')[0:3])
+                    for p in trip_paths
+                }
                 critical = None
+                high = None
+                for trip_point in trip_points:
+                    path = os.path.join(base, trip_point + "_type")
+                    trip_type = cat(path, fallback='').strip()
+                    path = os.path.join(base, trip_point + "_temp")
+                    if trip_type == 'critical':
+                        critical = self._read_temp(path)
+                    elif trip_type == 'high':
+                        high = self._read_temp(path)
+
+                input_file = os.path.relpath(f"{base}/temp", root)
+                ret.append((unit_name, '', input_file, high, critical))
 
-        ret[unit_name].append((label, current, high, critical))
+        return ret
 
-    # Indication that no sensors were detected in /sys/class/hwmon/
-    if not basenames:
-        basenames = glob.glob('/sys/class/thermal/thermal_zone*')
-        basenames = sorted(set(basenames))
+    def scan_fans(self, root):
+        """Return a list of (unit_name, label, input_file) tuples,
+        where input_file is relative to `root`.
+        """
+        ret = []
+        basenames = glob.glob(f"{root}/class/hwmon/hwmon*/fan*_*")
+        if not basenames:
+            # CentOS has an intermediate /device directory:
+            # https://github.com/giampaolo/psutil/issues/971
+            basenames = glob.glob(f"{root}/class/hwmon/hwmon*/device/fan*_*")
 
+        basenames = sorted({self._sensor_base(x) for x in basenames})
         for base in basenames:
+            path = os.path.join(os.path.dirname(base), 'name')
             try:
-                path = os.path.join(base, 'temp')
-                current = float(bcat(path)) / 1000.0
-                path = os.path.join(base, 'type')
                 unit_name = cat(path).strip()
-            except (OSError, ValueError) as err:
+            except OSError as err:
                 debug(err)
                 continue
+            label = cat(base + '_label', fallback='').strip()
+            input_file = os.path.relpath(base + '_input', root)
+            ret.append((unit_name, label, input_file))
+        return ret
 
-            trip_paths = glob.glob(base + '/trip_point*')
-            trip_points = {
-                '_'.join(os.path.basename(p).split('_')[0:3])
-                for p in trip_paths
-            }
-            critical = None
-            high = None
-            for trip_point in trip_points:
-                path = os.path.join(base, trip_point + "_type")
-                trip_type = cat(path, fallback='').strip()
-                if trip_type == 'critical':
-                    critical = bcat(
-                        os.path.join(base, trip_point + "_temp"), fallback=None
-                    )
-                elif trip_type == 'high':
-                    high = bcat(
-                        os.path.join(base, trip_point + "_temp"), fallback=None
-                    )
+    def temperatures(self):
+        root = SYSFS_PATH
+        key = self.devices_key(root)
+        cache = self._temps
+        if cache is None or cache[0] != key:
+            cache = (key, self.scan_temperatures(root))
+            self._temps = cache
+        return cache[1]
+
+    def fans(self):
+        root = SYSFS_PATH
+        key = self.devices_key(root)
+        cache = self._fans
+        if cache is None or cache[0] != key:
+            cache = (key, self.scan_fans(root))
+            self._fans = cache
+        return cache[1]
 
-                if high is not None:
-                    try:
-                        high = float(high) / 1000.0
-                    except ValueError:
-                        high = None
-                if critical is not None:
-                    try:
-                        critical = float(critical) / 1000.0
-                    except ValueError:
-                        critical = None
 
-            ret[unit_name].append(('', current, high, critical))
+_sensors_topology = SensorsTopology()
+sensors_cache_clear = _sensors_topology.clear
 
+
+def sensors_temperatures():
+    """Return hardware (CPU and others) temperatures as a dict
+    including hardware name, label, current, max and critical
+    temperatures.
+
+    Implementation notes:
+    - /sys/class/hwmon looks like the most recent interface to
+      retrieve this info, and this implementation relies on it
+      only (old distros will probably use something else)
+    - lm-sensors on Ubuntu 16.04 relies on /sys/class/hwmon
+    - /sys/class/thermal/thermal_zone* is another one but it's more
+      difficult to parse
+    - sensors and their static attributes are cached, see
+      SensorsTopology
+    """
+    ret = collections.defaultdict(list)
+    entries = _sensors_topology.temperatures()
+    currents = _psutil.sysfs_read_ints(SYSFS_PATH, [x[2] for x in entries])
+    for entry, current in zip(entries, currents):
+        unit_name, label, _, high, critical = entry
+        if current is None:
+            # can't read the value (EIO, sensor gone, etc.); skip it
+            continue
+        ret[unit_name].append((label, current / 1000.0, high, critical))
     return dict(ret)
 
 
@@ -1405,23 +1808,12 @@ def sensors_fans():
     - lm-sensors on Ubuntu 16.04 relies on /sys/class/hwmon
     """
     ret = collections.defaultdict(list)
-    basenames = glob.glob('/sys/class/hwmon/hwmon*/fan*_*')
-    if not basenames:
-        # CentOS has an intermediate /device directory:
-        # https://github.com/giampaolo/psutil/issues/971
-        basenames = glob.glob('/sys/class/hwmon/hwmon*/device/fan*_*')
-
-    basenames = sorted({x.split("_")[0] for x in basenames})
-    for base in basenames:
-        try:
-            current = int(bcat(base + '_input'))
-        except OSError as err:
-            debug(err)
+    entries = _sensors_topology.fans()
+    currents = _psutil.sysfs_read_ints(SYSFS_PATH, [x[2] for x in entries])
+    for (unit_name, label, _), current in zip(entries, currents):
+        if current is None:
             continue
-        unit_name = cat(os.path.join(os.path.dirname(base), 'name')).strip()
-        label = cat(base + '_label', fallback='').strip()
         ret[unit_name].append(ntp.sfan(label, current))
-
     return dict(ret)
 
 
@@ -1539,6 +1931,11 @@ def boot_time():
         raise RuntimeError(msg)
 
 
+# Used by Process.create_time(), so that /proc/stat is read only once
+# per process_iter() pass.
+_scan_boot_time = memoize_when_scanning(boot_time)
+
+
 # =====================================================================
 # --- processes
 # =====================================================================
@@ -1546,8 +1943,7 @@ def boot_time():
 
 def pids():
     """Returns a list of PIDs currently running on the system."""
-    path = get_procfs_path().encode(ENCODING)
-    return [int(x) for x in os.listdir(path) if x.isdigit()]
+    return _psutil.pids(get_procfs_path())
 
 
 def pid_exists(pid):
@@ -1587,22 +1983,104 @@ def ppid_map():
     """Obtain a {pid: ppid, ...} dict for all running processes in
     one shot. Used to speed up Process.children().
     """
-    ret = {}
-    procfs_path = get_procfs_path()
-    for pid in pids():
-        try:
-            with open_binary(f"{procfs_path}/{pid}/stat") as f:
-                data = f.read()
-        except (FileNotFoundError, ProcessLookupError):
-            pass
-        except PermissionError as err:
-            raise AccessDenied(pid) from err
-        else:
-            rpar = data.rfind(b')')
-            dset = data[rpar + 2 :].split()
-            ppid = int(dset[1])
-            ret[pid] = ppid
-    return ret
+    try:
+        return _psutil.ppid_map(get_procfs_path())
+    except PermissionError as err:
+        # err.filename is the /proc/<pid>/stat file which failed.
+        pid = os.path.basename(os.path.dirname(err.filename or ""))
+        pid = int(pid) if pid.isdigit() else None
+        raise AccessDenied(pid, msg=str(err)) from err
+
+
+def pid_idents():
+    """Return a {pid: monotonic_create_time} dict for all processes,
+    out of a single native scan. The values are the same ones which
+    Process(pid).create_time(monotonic=True) returns, hence they can
+    be used to identify processes (see psutil.Process._get_ident()).
+    Processes which disappeared are missing, the ones which can't be
+    inspected map to None.
+    """
+    rawlist = _psutil.proc_stat_scan(get_procfs_path())
+    return {
+        pid: None if status == _psutil.ROW_DENIED else ticks / CLOCK_TICKS
+        for pid, _, ticks, _, status in rawlist
+    }
+
+
+def proc_tree_scan():
+    """Return a list of (pid, ppid, create_time, name) tuples for all
+    processes, out of a single native scan. Used by ProcessTree.
+    """
+    btime = boot_time()
+    rawlist = _psutil.proc_stat_scan(get_procfs_path())
+    return [
+        (pid, ppid, btime + ticks / CLOCK_TICKS, name)
+        for pid, ppid, ticks, name, status in rawlist
+        if status != _psutil.ROW_DENIED
+    ]
+
+
+def filter_pids(uids=None, ppid=None, statuses=None, min_rss=0,
+                kernel_threads=True):
+    """Return a list of (pid, ppid, name) tuples for the processes
+    matching the given filters, which are evaluated natively on the
+    raw /proc/<pid>/stat and /proc/<pid>/status content. Used by
+    process_iter(filters=...).
+    """
+    if statuses is not None:
+        statuses = "".join(
+            k for k, v in PROC_STATUSES.items() if v in set(statuses)
+        )
+    return _psutil.proc_filter_scan(
+        get_procfs_path(),
+        None if uids is None else tuple(uids),
+        -1 if ppid is None else ppid,
+        statuses,
+        (min_rss + PAGESIZE - 1) // PAGESIZE,
+        not kernel_threads,
+    )
+
+
+def top_pids(key, n, interval=None):
+    """Return the *n* (pid, monotonic_create_time, value) tuples with
+    the highest *key* value, selected natively during the scan. Used
+    by psutil.top_processes().
+    """
+    procfs = get_procfs_path()
+    if interval:
+        _, state = _psutil.proc_top(procfs, key, 0, None, True)
+        time.sleep(interval)
+        ret = _psutil.proc_top(procfs, key, n, state, False)
+    else:
+        ret = _psutil.proc_top(procfs, key, n, None, False)
+    if key == "cpu":
+        return [
+            (pid, start / CLOCK_TICKS, ticks / CLOCK_TICKS)
+            for pid, ticks, start in ret
+        ]
+    return [(pid, start / CLOCK_TICKS, value) for pid, value, start in ret]
+
+
+def process_rollup(by, pss=False):
+    """Return process metrics summed by *by* ("uid", "cgroup" or
+    "name") out of a single native scan. Used by
+    psutil.process_rollup().
+    """
+    rawdict = _psutil.proc_rollup(get_procfs_path(), by, pss)
+    return {
+        key: ntp.sprocgroup(
+            count,
+            rss,
+            pss_ if pss else None,
+            ticks / CLOCK_TICKS,
+            io_bytes,
+            threads,
+            fds,
+        )
+        for key, (count, rss, pss_, ticks, io_bytes, threads, fds) in (
+            rawdict.items()
+        )
+    }
 
 
 def wrap_exceptions(fun):
@@ -1632,6 +2110,27 @@ def wrap_exceptions(fun):
     return wrapper
 
 
+# The /proc/<pid>/* entries which, when read by one Process method
+# within oneshot(), spare another method from reading a cheaper entry
+# of its own. E.g. with memory_maps() + memory_footprint() the rollup
+# is computed from smaps, and with open_files() + num_fds() the fds
+# are counted from the fd dir listing.
+ONESHOT_SOURCES = {
+    "memory_maps": "smaps",
+    "open_files": "fd",
+}
+
+
+@functools.lru_cache(maxsize=64)
+def oneshot_plan(attrs):
+    """Given a frozenset of Process attribute names, return the
+    frozenset of ONESHOT_SOURCES entries which are going to be read in
+    order to fill them. Computed once per set of attributes, so that
+    it costs nothing to process_iter() after the first process.
+    """
+    return frozenset(ONESHOT_SOURCES[x] for x in attrs if x in ONESHOT_SOURCES)
+
+
 class Process:
     """Linux process implementation."""
 
@@ -1750,15 +2249,55 @@ class Process:
         with open_binary(f"{self._procfs_path}/{self.pid}/smaps") as f:
             return f.read().strip()
 
+    @wrap_exceptions
+    @memoize_when_activated
+    def _read_statm_file(self):
+        with open_binary(f"{self._procfs_path}/{self.pid}/statm") as f:
+            return f.readline()
+
+    @wrap_exceptions
+    @memoize_when_activated
+    def _read_io_file(self):
+        with open_binary(f"{self._procfs_path}/{self.pid}/io") as f:
+            return f.read()
+
+    @wrap_exceptions
+    @memoize_when_activated
+    def _list_fds(self):
+        return os.listdir(f"{self._procfs_path}/{self.pid}/fd")
+
+    def _planned(self, source):
+        """Return True if *source* is going to be read anyway as part
+        of the current oneshot_plan().
+        """
+        try:
+            return source in self._cache["plan"]
+        except (AttributeError, KeyError):
+            return False
+
     def oneshot_enter(self):
         self._parse_stat_file.cache_activate(self)
         self._read_status_file.cache_activate(self)
         self._read_smaps_file.cache_activate(self)
+        self._read_statm_file.cache_activate(self)
+        self._read_io_file.cache_activate(self)
+        self._list_fds.cache_activate(self)
+
+    def oneshot_plan(self, attrs):
+        # Must be called after oneshot_enter(); stored in the oneshot
+        # cache so that it goes away with oneshot_exit().
+        try:
+            self._cache["plan"] = oneshot_plan(frozenset(attrs))
+        except AttributeError:
+            pass
 
     def oneshot_exit(self):
         self._parse_stat_file.cache_deactivate(self)
         self._read_status_file.cache_deactivate(self)
         self._read_smaps_file.cache_deactivate(self)
+        self._read_statm_file.cache_deactivate(self)
+        self._read_io_file.cache_deactivate(self)
+        self._list_fds.cache_deactivate(self)
 
     @wrap_exceptions
     def name(self):
@@ -1817,18 +2356,17 @@ class Process:
         def io_counters(self):
             fname = f"{self._procfs_path}/{self.pid}/io"
             fields = {}
-            with open_binary(fname) as f:
-                for line in f:
-                    # https://github.com/giampaolo/psutil/issues/1004
-                    line = line.strip()
-                    if line:
-                        try:
-                            name, value = line.split(b': ')
-                        except ValueError:
-                            # https://github.com/giampaolo/psutil/issues/1004
-                            continue
-                        else:
-                            fields[name] = int(value)
+            for line in self._read_io_file().splitlines():
+                # https://github.com/giampaolo/psutil/issues/1004
+                line = line.strip()
+                if line:
+                    try:
+                        name, value = line.split(b': ')
+                    except ValueError:
+                        # https://github.com/giampaolo/psutil/issues/1004
+                        continue
+                    else:
+                        fields[name] = int(value)
             if not fields:
                 msg = f"{fname} file was empty"
                 raise RuntimeError(msg)
@@ -1884,7 +2422,7 @@ class Process:
             return self._ctime
         # Add the boot time, returning time expressed in seconds since
         # the epoch. This is subject to system clock updates.
-        return self._ctime + boot_time()
+        return self._ctime + _scan_boot_time()
 
     @wrap_exceptions
     def memory_info(self):
@@ -1899,10 +2437,9 @@ class Process:
         # | data   | data + stack                        | drs  | DATA |
         # | dirty  | dirty pages (unused in Linux 2.6)   | dt   |      |
         #  ============================================================
-        with open_binary(f"{self._procfs_path}/{self.pid}/statm") as f:
-            vms, rss, shared, text, _lib, data, _dirty = (
-                int(x) * PAGESIZE for x in f.readline().split()[:7]
-            )
+        vms, rss, shared, text, _lib, data, _dirty = (
+            int(x) * PAGESIZE for x in self._read_statm_file().split()[:7]
+        )
         return ntp.pmem(rss, vms, shared, text, data)
 
     @wrap_exceptions
@@ -1993,7 +2530,8 @@ class Process:
         @wrap_exceptions
         def memory_footprint(self):
             def fetch():
-                if HAS_PROC_SMAPS_ROLLUP:  # faster
+                # smaps is going to be read anyway (memory_maps())
+                if HAS_PROC_SMAPS_ROLLUP and not self._planned("smaps"):
                     try:
                         return self._parse_smaps_rollup()
                     except (ProcessLookupError, FileNotFoundError):
@@ -2112,29 +2650,50 @@ class Process:
 
     @wrap_exceptions
     def threads(self):
-        thread_ids = os.listdir(f"{self._procfs_path}/{self.pid}/task")
-        thread_ids.sort()
-        retlist = []
-        hit_enoent = False
-        for thread_id in thread_ids:
-            fname = f"{self._procfs_path}/{self.pid}/task/{thread_id}/stat"
-            try:
-                with open_binary(fname) as f:
-                    st = f.read().strip()
-            except (FileNotFoundError, ProcessLookupError):
-                # no such file or directory or no such process;
-                # it means thread disappeared on us
-                hit_enoent = True
-                continue
-            # ignore the first two values ("pid (exe)")
-            st = st[st.find(b')') + 2 :]
-            values = st.split(b' ')
-            utime = float(values[11]) / CLOCK_TICKS
-            stime = float(values[12]) / CLOCK_TICKS
-            ntuple = ntp.pthread(int(thread_id), utime, stime)
-            retlist.append(ntuple)
+        # Threads which disappear while being read are skipped.
+        rawlist, hit_enoent = _psutil.proc_threads(
+            self._procfs_path, self.pid, False
+        )
+        if hit_enoent:
+            self._raise_if_not_alive()
+        return [
+            ntp.pthread(tid, utime / CLOCK_TICKS, stime / CLOCK_TICKS)
+            for tid, utime, stime in rawlist
+        ]
+
+    @wrap_exceptions
+    def children_pids(self, recursive=False):
+        # None if the kernel lacks CONFIG_PROC_CHILDREN.
+        pids = _psutil.proc_children(self._procfs_path, self.pid, recursive)
+        if pids is None:
+            return None
+        # A process reparented in the meantime may be listed twice.
+        return list(dict.fromkeys(pids))
+
+    @wrap_exceptions
+    def threads_info(self):
+        rawlist, hit_enoent = _psutil.proc_threads(
+            self._procfs_path, self.pid, True
+        )
         if hit_enoent:
             self._raise_if_not_alive()
+        retlist = []
+        for item in rawlist:
+            tid, name, status, cpu_num, utime, stime = item[:6]
+            vol_ctxsw, invol_ctxsw, run_ns, wait_ns = item[6:]
+            ntuple = ntp.pthreadinfo(
+                tid,
+                name,
+                PROC_STATUSES.get(status, '?'),
+                cpu_num,
+                utime / CLOCK_TICKS,
+                stime / CLOCK_TICKS,
+                vol_ctxsw,
+                invol_ctxsw,
+                run_ns / 1e9,
+                wait_ns / 1e9,
+            )
+            retlist.append(ntuple)
         return retlist
 
     @wrap_exceptions
@@ -2268,7 +2827,7 @@ class Process:
     @wrap_exceptions
     def open_files(self):
         retlist = []
-        files = os.listdir(f"{self._procfs_path}/{self.pid}/fd")
+        files = self._list_fds()
         hit_enoent = False
         for fd in files:
             file = f"{self._procfs_path}/{self.pid}/fd/{fd}"
@@ -2321,7 +2880,15 @@ class Process:
 
     @wrap_exceptions
     def num_fds(self):
-        return len(os.listdir(f"{self._procfs_path}/{self.pid}/fd"))
+        if self._planned("fd"):
+            # open_files() lists the fd dir anyway
+            return len(self._list_fds())
+        return _psutil.proc_num_fds(self._procfs_path, self.pid)
+
+    @wrap_exceptions
+    def num_fds_by_kind(self):
+        counts = _psutil.proc_fd_counts(self._procfs_path, self.pid)
+        return dict(zip(FD_KINDS, counts))
 
     @wrap_exceptions
     def ppid(self):
@@ -145,6 +145,7 @@ def cpu_freq():
 
 
 disk_usage = _psposix.disk_usage
+disk_usage_many = _psposix.disk_usage_many
 disk_io_counters = _psutil.disk_io_counters
 
 
@@ -11,19 +11,29 @@ import glob
 import os
 import select
 import signal
+import threading
 import time
 
+try:
+    import pwd
+except ImportError:
+    pwd = None
+
 from . import _ntuples as ntp
+from . import _psutil
 from ._common import MACOS
 from ._common import TimeoutExpired
 from ._common import debug
 from ._common import usage_percent
 
-if MACOS:
-    from . import _psutil
-
-
-__all__ = ['pid_exists', 'wait_pid', 'disk_usage', 'get_terminal']
+__all__ = [
+    'pid_exists',
+    'wait_pid',
+    'disk_usage',
+    'disk_usage_many',
+    'get_terminal',
+    'username',
+]
 
 
 def pid_exists(pid):
@@ -312,13 +322,19 @@ def disk_usage(path):
     the "free" and "used percent" user disk space.
     """
     st = os.statvfs(path)
+    return _disk_usage(
+        path, st.f_frsize, st.f_blocks, st.f_bfree, st.f_bavail
+    )
+
+
+def _disk_usage(path, frsize, blocks, bfree, bavail):
     # Total space which is only available to root (unless changed
     # at system level).
-    total = st.f_blocks * st.f_frsize
+    total = blocks * frsize
     # Remaining free space usable by root.
-    avail_to_root = st.f_bfree * st.f_frsize
+    avail_to_root = bfree * frsize
     # Remaining free space usable by user.
-    avail_to_user = st.f_bavail * st.f_frsize
+    avail_to_user = bavail * frsize
     # Total space being used in general.
     used = total - avail_to_root
     if MACOS:
@@ -340,6 +356,38 @@ def disk_usage(path):
     )
 
 
+def disk_usage_many(paths, timeout=None):
+    """Return disk and inode usage of many paths as a dict, calling
+    statvfs() for all of them concurrently from C threads. The values
+    are either a named tuple, an OSError if statvfs() failed, or
+    TimeoutExpired if it didn't return within *timeout* seconds (e.g.
+    on a hung NFS mount).
+    """
+    paths = list(paths)
+    ret = {}
+    for path, st in zip(paths, _psutil.disk_usage_many(paths, timeout)):
+        if st is None:
+            ret[path] = TimeoutExpired(timeout)
+        elif isinstance(st, int):
+            ret[path] = OSError(st, os.strerror(st), path)
+        else:
+            frsize, blocks, bfree, bavail, files, ffree, favail = st
+            usage = _disk_usage(path, frsize, blocks, bfree, bavail)
+            # Same as above: "free" and "percent" refer to the inodes
+            # available to unprivileged users.
+            inodes_used = files - ffree
+            ret[path] = ntp.sdiskusagefull(
+                *usage,
+                inodes_total=files,
+                inodes_used=inodes_used,
+                inodes_free=favail,
+                inodes_percent=usage_percent(
+                    inodes_used, inodes_used + favail, round_=1
+                ),
+            )
+    return ret
+
+
 @functools.lru_cache
 def _get_terminal_map():
     """Get a map of device-id -> path as a dict.
@@ -367,3 +415,116 @@ def get_terminal(tty_nr):
         return tmap[tty_nr]
     _get_terminal_map.cache_clear()
     return _get_terminal_map().get(tty_nr)
+
+
+class UsernameCache:
+    """Cache uid -> username (and username -> uid) lookups.
+    getpwuid() goes through NSS, which on LDAP / SSSD hosts can take
+    milliseconds per call, and process scans typically ask for the
+    same few uids over and over.
+
+    Entries (unresolved uids included) expire after `ttl` seconds, and
+    at most `maxsize` of them are kept (the oldest one is evicted).
+    The whole cache is dropped if /etc/passwd is modified, which is
+    checked at most once per second.
+    """
+
+    __slots__ = [
+        '_cache',
+        '_checked',
+        '_lock',
+        '_mtime',
+        'maxsize',
+        'passwd_path',
+        'ttl',
+    ]
+
+    def __init__(self, maxsize=4096, ttl=300.0, passwd_path="/etc/passwd"):
+        self.maxsize = maxsize
+        self.ttl = ttl
+        self.passwd_path = passwd_path
+        self._cache = {}  # {uid: (name, expires)}
+        self._checked = 0.0
+        self._mtime = None
+        self._lock = threading.Lock()
+
+    def _check_passwd(self, now, force=False):
+        # Must be called with the lock held.
+        if not force and now - self._checked < 1:
+            return
+        self._checked = now
+        try:
+            mtime = os.stat(self.passwd_path).st_mtime_ns
+        except OSError:
+            mtime = None
+        if mtime != self._mtime:
+            self._mtime = mtime
+            self._cache.clear()
+
+    @staticmethod
+    def _lookup(uid):
+        try:
+            return pwd.getpwuid(uid).pw_name
+        except KeyError:
+            # the uid can't be resolved by the system
+            return str(uid)
+
+    @staticmethod
+    def _lookup_uid(name):
+        try:
+            return pwd.getpwnam(name).pw_uid
+        except KeyError:
+            return None
+
+    def _get(self, key, lookup):
+        # uids (int) and names (str) share the same dict: keys can't
+        # clash.
+        now = time.monotonic()
+        with self._lock:
+            self._check_passwd(now)
+            entry = self._cache.get(key)
+            if entry is not None and entry[1] > now:
+                return entry[0]
+            mtime = self._mtime
+        # Don't hold the lock while NSS is being queried.
+        value = lookup(key)
+        with self._lock:
+            # If /etc/passwd changed in the meantime the value may be
+            # stale: return it, but don't cache it.
+            self._check_passwd(now, force=True)
+            if self._mtime != mtime:
+                return value
+            self._cache.pop(key, None)
+            while self._cache and len(self._cache) >= self.maxsize:
+                del self._cache[next(iter(self._cache))]
+            if self.maxsize > 0:
+                self._cache[key] = (value, now + self.ttl)
+        return value
+
+    def get(self, uid):
+        """Return the name of *uid*, or str(uid) if it can't be
+        resolved.
+        """
+        return self._get(uid, self._lookup)
+
+    def uid(self, name):
+        """Return the uid of user *name*. Raise KeyError if there's no
+        such user.
+        """
+        uid = self._get(name, self._lookup_uid)
+        if uid is None:
+            msg = f"getpwnam(): name not found: {name!r}"
+            raise KeyError(msg)
+        return uid
+
+    def cache_clear(self):
+        with self._lock:
+            self._cache.clear()
+            self._checked = 0.0
+            self._mtime = None
+
+
+_username_cache = UsernameCache()
+username = _username_cache.get
+username_uid = _username_cache.uid
+username_cache_clear = _username_cache.cache_clear
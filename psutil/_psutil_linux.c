@@ -22,15 +22,33 @@
 
 static PyMethodDef mod_methods[] = {
     // --- per-process functions
+    {"proc_children", psutil_proc_children, METH_VARARGS},
+    {"proc_fd_counts", psutil_proc_fd_counts, METH_VARARGS},
     {"proc_ioprio_get", psutil_proc_ioprio_get, METH_VARARGS},
     {"proc_ioprio_set", psutil_proc_ioprio_set, METH_VARARGS},
+    {"proc_num_fds", psutil_proc_num_fds, METH_VARARGS},
+    {"proc_threads", psutil_proc_threads, METH_VARARGS},
 #ifdef PSUTIL_HAS_CPU_AFFINITY
     {"proc_cpu_affinity_get", psutil_proc_cpu_affinity_get, METH_VARARGS},
     {"proc_cpu_affinity_set", psutil_proc_cpu_affinity_set, METH_VARARGS},
 #endif
     // --- system related functions
+    {"cpufreq_time_in_state", psutil_cpufreq_time_in_state, METH_VARARGS},
+    {"cpuinfo_freqs", psutil_cpuinfo_freqs, METH_VARARGS},
+    {"disk_io_counters_procfs", psutil_disk_io_counters_procfs, METH_VARARGS},
     {"disk_partitions", psutil_disk_partitions, METH_VARARGS},
     {"net_if_duplex_speed", psutil_net_if_duplex_speed, METH_VARARGS},
+    {"net_if_notify_drain", psutil_net_if_notify_drain, METH_VARARGS},
+    {"net_if_notify_open", psutil_net_if_notify_open, METH_VARARGS},
+    {"net_if_stats_netlink", psutil_net_if_stats_netlink, METH_VARARGS},
+    {"net_io_counters_netlink", psutil_net_io_counters_netlink, METH_VARARGS},
+    {"open_files_scan", psutil_open_files_scan, METH_VARARGS},
+    {"pids", psutil_pids, METH_VARARGS},
+    {"ppid_map", psutil_ppid_map, METH_VARARGS},
+    {"proc_filter_scan", psutil_proc_filter_scan, METH_VARARGS},
+    {"proc_rollup", psutil_proc_rollup, METH_VARARGS},
+    {"proc_stat_scan", psutil_proc_stat_scan, METH_VARARGS},
+    {"proc_top", psutil_proc_top, METH_VARARGS},
 #ifdef PSUTIL_HAS_HEAP_INFO
     {"heap_info", psutil_heap_info, METH_VARARGS},
 #endif
@@ -40,6 +58,8 @@ static PyMethodDef mod_methods[] = {
 
     // --- linux specific
     {"linux_sysinfo", psutil_linux_sysinfo, METH_VARARGS},
+    {"mounts_changed", psutil_mounts_changed, METH_VARARGS},
+    {"sysfs_read_ints", psutil_sysfs_read_ints, METH_VARARGS},
     // --- others
     {"check_pid_range", psutil_check_pid_range, METH_VARARGS},
     {"set_debug", psutil_set_debug, METH_VARARGS},
@@ -53,6 +73,10 @@ psutil_add_constants(PyObject *mod) {
     PSUTIL_ADD_INT(mod, "DUPLEX_HALF", DUPLEX_HALF);
     PSUTIL_ADD_INT(mod, "DUPLEX_FULL", DUPLEX_FULL);
     PSUTIL_ADD_INT(mod, "DUPLEX_UNKNOWN", DUPLEX_UNKNOWN);
+    PSUTIL_ADD_INT(mod, "ROW_OK", PSUTIL_ROW_OK);
+    PSUTIL_ADD_INT(mod, "ROW_GONE", PSUTIL_ROW_GONE);
+    PSUTIL_ADD_INT(mod, "ROW_ZOMBIE", PSUTIL_ROW_ZOMBIE);
+    PSUTIL_ADD_INT(mod, "ROW_DENIED", PSUTIL_ROW_DENIED);
     return 0;
 }
 
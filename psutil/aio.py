@@ -0,0 +1,162 @@
+# Copyright (c) 2009, Giampaolo Rodola'. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""asyncio counterparts of the psutil APIs which block, meant to be
+used from async applications without stalling the event loop or
+resorting to executor threads.
+
+  >>> import psutil.aio
+  >>> await psutil.aio.cpu_percent(interval=1)
+  2.0
+  >>> proc = psutil.Process(pid)
+  >>> await psutil.aio.wait(proc, timeout=3)
+  0
+"""
+
+import asyncio
+import os
+
+import psutil
+
+from ._common import POSIX
+from ._common import TimeoutExpired
+
+if POSIX:
+    from . import _psposix
+
+__all__ = ["cpu_percent", "process_cpu_percent", "process_iter", "wait"]
+
+
+def _check_interval(interval):
+    if interval < 0:
+        msg = f"interval is not positive (got {interval!r})"
+        raise ValueError(msg)
+
+
+async def cpu_percent(interval=None, percpu=False):
+    """Same as `psutil.cpu_percent()`, except that if *interval* is
+    > 0.0 it awaits `asyncio.sleep()` instead of blocking.
+    """
+    if not interval:
+        return psutil.cpu_percent(interval, percpu)
+    _check_interval(interval)
+    t1 = psutil.cpu_times(percpu=percpu)
+    await asyncio.sleep(interval)
+    t2 = psutil.cpu_times(percpu=percpu)
+    if percpu:
+        return [psutil._cpu_busy_percent(a, b) for a, b in zip(t1, t2)]
+    return psutil._cpu_busy_percent(t1, t2)
+
+
+async def process_cpu_percent(proc, interval=None):
+    """Same as `psutil.Process.cpu_percent()` for *proc*, except that
+    if *interval* is > 0.0 it awaits `asyncio.sleep()` instead of
+    blocking.
+    """
+    if not interval:
+        return proc.cpu_percent(interval)
+    _check_interval(interval)
+    # A separate instance, so that concurrent calls for the same
+    # process don't mix up their samples.
+    other = psutil.Process._from_ident(proc.pid, proc._ident[1])
+    other.cpu_percent(None)
+    await asyncio.sleep(interval)
+    return other.cpu_percent(None)
+
+
+def _poll(proc):
+    # Return (True, exit code) if the process terminated, else
+    # (False, None).
+    try:
+        return True, proc.wait(0)
+    except TimeoutExpired:
+        return False, None
+
+
+async def _wait_pidfd(pidfd, stop_at):
+    # Wait for the pidfd to become readable, meaning the process
+    # terminated.
+    loop = asyncio.get_running_loop()
+    fut = loop.create_future()
+
+    def on_readable():
+        if not fut.done():
+            fut.set_result(None)
+
+    loop.add_reader(pidfd, on_readable)
+    try:
+        if stop_at is None:
+            await fut
+        else:
+            await asyncio.wait_for(fut, max(stop_at - loop.time(), 0))
+    finally:
+        loop.remove_reader(pidfd)
+
+
+async def _wait_poll(proc, stop_at):
+    loop = asyncio.get_running_loop()
+    interval = 0.0001
+    while True:
+        done, exitcode = _poll(proc)
+        if done:
+            return exitcode
+        if stop_at is not None and loop.time() >= stop_at:
+            raise asyncio.TimeoutError
+        await asyncio.sleep(interval)
+        interval = min(interval * 2, 0.04)
+
+
+async def wait(proc, timeout=None):
+    """Same as `psutil.Process.wait()` for *proc*, except that it
+    awaits the process termination instead of blocking. On Linux the
+    process is watched via a pidfd registered with the event loop,
+    else its status is polled with exponentially increasing sleeps
+    (up to 40 ms).
+    """
+    stop_at = None
+    if timeout is not None:
+        # Same checks as Process.wait().
+        if not isinstance(timeout, (int, float)):
+            msg = f"timeout must be an int or float (got {type(timeout)})"
+            raise TypeError(msg)
+        if timeout < 0:
+            msg = f"timeout must be positive or zero (got {timeout})"
+            raise ValueError(msg)
+        stop_at = asyncio.get_running_loop().time() + timeout
+
+    pidfd = None
+    if POSIX and timeout != 0 and _psposix.can_use_pidfd_open():
+        try:
+            pidfd = os.pidfd_open(proc.pid, 0)
+        except OSError:
+            pass  # gone, or too many open files; poll
+    try:
+        if pidfd is not None and not _poll(proc)[0]:
+            await _wait_pidfd(pidfd, stop_at)
+        # Get the exit code (and reap the process if it's our child).
+        # A terminated process which is not our child may still be
+        # around as a zombie, in which case we keep polling.
+        return await _wait_poll(proc, stop_at)
+    except asyncio.TimeoutError:
+        exc = TimeoutExpired(timeout, pid=proc.pid, name=proc._name)
+        raise exc from None
+    finally:
+        if pidfd is not None:
+            os.close(pidfd)
+
+
+async def process_iter(*args, chunksize=64, **kwargs):
+    """Same as `psutil.process_iter()` (and accepting the same
+    arguments), but as an async generator which gives control back to
+    the event loop every *chunksize* processes, so that scanning many
+    processes (or pre-fetching their attributes) does not stall it.
+    Consider using *timeout* as well when *attrs* are pre-fetched.
+    """
+    if chunksize < 1:
+        msg = f"chunksize must be >= 1 (got {chunksize!r})"
+        raise ValueError(msg)
+    for i, proc in enumerate(psutil.process_iter(*args, **kwargs), 1):
+        yield proc
+        if i % chunksize == 0:
+            await asyncio.sleep(0)
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2009, Giampaolo Rodola'. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <Python.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "../../arch/all/init.h"
+
+
+// Return 1 if the "key" part of a /proc/cpuinfo line (what comes
+// before ':') is one of the keys carrying the current CPU frequency.
+// x86 says "cpu MHz", ppc "clock" (with a MHz suffix), s390x
+// "cpu MHz dynamic" plus a "static" one we skip.
+// https://github.com/torvalds/linux/blob/master/arch/powerpc/kernel/setup-common.c
+// https://github.com/torvalds/linux/blob/master/arch/s390/kernel/processor.c
+static int
+is_cpuinfo_freq_key(const char *key, size_t len) {
+    while (len > 0 && isspace((unsigned char)key[len - 1]))
+        len--;
+    if (len == 7 && strncasecmp(key, "cpu MHz", len) == 0)
+        return 1;
+    if (len == 5 && strncasecmp(key, "clock", len) == 0)
+        return 1;
+    if (len == 15 && strncasecmp(key, "cpu MHz dynamic", len) == 0)
+        return 1;
+    return 0;
+}
+
+
+// Parse /proc/cpuinfo and return the current frequency (in MHz) of
+// each CPU as a list of floats. The list is empty if the kernel
+// doesn't report it. /proc/cpuinfo can be big (hundreds of KB on
+// machines with many CPUs), so it's read and parsed with the GIL
+// released.
+PyObject *
+psutil_cpuinfo_freqs(PyObject *self, PyObject *args) {
+    char *path;
+    char *line = NULL;
+    char *colon;
+    char *end;
+    size_t linesize = 0;
+    size_t count = 0;
+    size_t capacity = 0;
+    double value;
+    double *freqs = NULL;
+    double *tmp;
+    FILE *file = NULL;
+    int nomem = 0;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &path))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    file = fopen(path, "re");
+    if (file != NULL) {
+        while (getline(&line, &linesize, file) != -1) {
+            colon = strchr(line, ':');
+            if (colon == NULL || !is_cpuinfo_freq_key(line, colon - line))
+                continue;
+            value = strtod(colon + 1, &end);
+            if (end == colon + 1)
+                continue;
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                tmp = realloc(freqs, capacity * sizeof(*freqs));
+                if (tmp == NULL) {
+                    nomem = 1;
+                    break;
+                }
+                freqs = tmp;
+            }
+            freqs[count++] = value;
+        }
+        fclose(file);
+    }
+    free(line);
+    Py_END_ALLOW_THREADS
+
+    if (file == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+        goto error;
+    }
+    if (nomem) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < count; i++) {
+        if (!pylist_append_fmt(py_retlist, "d", freqs[i]))
+            goto error;
+    }
+    free(freqs);
+    return py_retlist;
+
+error:
+    free(freqs);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// Read cpufreq/stats/time_in_state files. `names` are paths relative
+// to `root`, one per CPU. Each file has one "<freq-KHz> <time>" line
+// per frequency, where time is expressed in clock ticks (USER_HZ).
+// Return a list including, for every name, a list of (freq, time)
+// tuples, or None if the file is not available (CONFIG_CPU_FREQ_STAT
+// not set or CPU gone offline).
+PyObject *
+psutil_cpufreq_time_in_state(PyObject *self, PyObject *args) {
+    char *root;
+    const char **names = NULL;
+    // sysfs attributes are capped at PAGE_SIZE.
+    char buf[4096 + 1];
+    char *ptr;
+    char *end;
+    int dirfd;
+    ssize_t nbytes;
+    Py_ssize_t i;
+    Py_ssize_t nnames = 0;
+    unsigned long long freq;
+    unsigned long long ticks;
+    PyObject *py_names;
+    PyObject *py_encoded = NULL;
+    PyObject *py_item = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "sO", &root, &py_names))
+        return NULL;
+    py_encoded = psutil_encode_names(py_names, &names, &nnames);
+    if (py_encoded == NULL)
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    dirfd = psutil_open_dir(root);
+    Py_END_ALLOW_THREADS
+    if (dirfd == -1) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, root);
+        free(names);
+        Py_DECREF(py_encoded);
+        return NULL;
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+
+    for (i = 0; i < nnames; i++) {
+        Py_BEGIN_ALLOW_THREADS
+        nbytes = psutil_read_at(dirfd, names[i], buf, sizeof(buf));
+        Py_END_ALLOW_THREADS
+        if (nbytes == -1) {
+            Py_INCREF(Py_None);
+            if (!pylist_append_obj(py_retlist, Py_None))
+                goto error;
+            continue;
+        }
+
+        py_item = PyList_New(0);
+        if (py_item == NULL)
+            goto error;
+        ptr = buf;
+        while (*ptr != '\0') {
+            freq = strtoull(ptr, &end, 10);
+            if (end == ptr)
+                break;
+            ptr = end;
+            ticks = strtoull(ptr, &end, 10);
+            if (end == ptr)
+                break;
+            ptr = end;
+            if (!pylist_append_fmt(py_item, "(KK)", freq, ticks))
+                goto error;
+        }
+        if (!pylist_append_obj(py_retlist, py_item)) {
+            py_item = NULL;
+            goto error;
+        }
+        py_item = NULL;
+    }
+
+    close(dirfd);
+    free(names);
+    Py_DECREF(py_encoded);
+    return py_retlist;
+
+error:
+    close(dirfd);
+    free(names);
+    Py_DECREF(py_encoded);
+    Py_XDECREF(py_item);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
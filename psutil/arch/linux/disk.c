@@ -7,43 +7,315 @@
 #include "../../arch/all/init.h"
 
 #include <Python.h>
+#include <errno.h>
 #include <mntent.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+// Max number of columns we expect after the disk name in
+// /proc/diskstats. Linux 5.5 has 17; leave room for future additions.
+#define DISKSTATS_MAX_FIELDS 32
+#define DISKSTATS_NAME_LEN 128
 
-// Return disk mounted partitions as a list of tuples including device,
-// mount point and filesystem type.
+typedef struct {
+    char name[DISKSTATS_NAME_LEN];
+    int nfields;
+    unsigned long long fields[DISKSTATS_MAX_FIELDS];
+} diskstats_entry;
+
+
+// A mounted filesystem. Strings are malloc()ed.
+typedef struct {
+    char *device;
+    char *mountpoint;
+    char *fstype;
+    char *opts;
+} mount_entry;
+
+typedef struct {
+    mount_entry *items;
+    size_t count;
+    size_t capacity;
+} mount_list;
+
+
+static void
+mount_list_free(mount_list *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i].device);
+        free(list->items[i].mountpoint);
+        free(list->items[i].fstype);
+        free(list->items[i].opts);
+    }
+    free(list->items);
+}
+
+
+// Append a copy of the given strings to `list`. Return -1 on ENOMEM.
+static int
+mount_list_append(
+    mount_list *list,
+    const char *device,
+    const char *mountpoint,
+    const char *fstype,
+    const char *opts
+) {
+    mount_entry *tmp;
+    mount_entry *entry;
+
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        tmp = realloc(list->items, list->capacity * sizeof(*tmp));
+        if (tmp == NULL)
+            return -1;
+        list->items = tmp;
+    }
+    entry = &list->items[list->count];
+    entry->device = strdup(device);
+    entry->mountpoint = strdup(mountpoint);
+    entry->fstype = strdup(fstype);
+    entry->opts = strdup(opts);
+    list->count++;
+    if (!entry->device || !entry->mountpoint || !entry->fstype
+        || !entry->opts)
+        return -1;
+    return 0;
+}
+
+
+// Decode in place the \ooo octal escapes the kernel uses for spaces,
+// tabs, newlines and backslashes in mount points and devices (see
+// mangle() in fs/proc_namespace.c).
+static void
+unescape_octal(char *str) {
+    char *src = str;
+    char *dst = str;
+
+    while (*src) {
+        if (src[0] == '\\' && src[1] >= '0' && src[1] <= '3'
+            && src[2] >= '0' && src[2] <= '7' && src[3] >= '0'
+            && src[3] <= '7')
+        {
+            *dst++ = (char)(((src[1] - '0') << 6) | ((src[2] - '0') << 3)
+                            | (src[3] - '0'));
+            src += 4;
+        }
+        else {
+            *dst++ = *src++;
+        }
+    }
+    *dst = '\0';
+}
+
+
+static int
+is_sb_flag(const char *opt, size_t len) {
+    static const char *flags[] = {"sync", "dirsync", "mand", "lazytime"};
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        if (strlen(flags[i]) == len && strncmp(opt, flags[i], len) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+
+// Rebuild the options string as shown by /proc/self/mounts out of the
+// per-mount and per-superblock options of a mountinfo line: "ro" if
+// either of them is read-only, then the superblock flags, the
+// per-mount ones and finally the filesystem specific ones (see
+// show_vfsmnt() in fs/proc_namespace.c). Return NULL on ENOMEM.
+static char *
+merge_mount_opts(const char *mnt_opts, const char *sb_opts) {
+    size_t size = strlen(mnt_opts) + strlen(sb_opts) + 2;
+    char *ret;
+    char *out;
+    const char *mnt_rest;
+    const char *sb_rest;
+    const char *opt;
+    const char *end;
+    size_t len;
+    int pass;
+    int ro;
+
+    ret = malloc(size);
+    if (ret == NULL)
+        return NULL;
+
+    ro = strncmp(mnt_opts, "ro", 2) == 0 || strncmp(sb_opts, "ro", 2) == 0;
+    // skip the leading "rw" / "ro"
+    mnt_rest = strchr(mnt_opts, ',');
+    sb_rest = strchr(sb_opts, ',');
+    out = ret;
+    out += sprintf(out, "%s", ro ? "ro" : "rw");
+
+    // superblock flags first, then the other superblock options
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1 && mnt_rest != NULL) {
+            out += sprintf(out, "%s", mnt_rest);
+        }
+        for (opt = sb_rest; opt != NULL; opt = end) {
+            opt++;  // skip ','
+            end = strchr(opt, ',');
+            len = end ? (size_t)(end - opt) : strlen(opt);
+            if (len == 0 || is_sb_flag(opt, len) != (pass == 0))
+                continue;
+            *out++ = ',';
+            memcpy(out, opt, len);
+            out += len;
+        }
+    }
+    *out = '\0';
+    return ret;
+}
+
+
+// Parse a /proc/<pid>/mountinfo line, which looks like:
+// "36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw"
+// (mount ID, parent ID, major:minor, root, mount point, mount options,
+// zero or more optional fields, "-", fs type, source, super options).
+// https://www.kernel.org/doc/Documentation/filesystems/proc.txt
+// Return 0 on success, 1 if the line is malformed, -1 on ENOMEM.
+static int
+parse_mountinfo_line(char *line, mount_list *list) {
+    char *saveptr = NULL;
+    char *tok;
+    char *mountpoint = NULL;
+    char *mnt_opts = NULL;
+    char *fstype = NULL;
+    char *device = NULL;
+    char *sb_opts = NULL;
+    char *opts;
+    int i = 0;
+    int sep = 0;
+    int ret;
+
+    for (tok = strtok_r(line, " \n", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, " \n", &saveptr), i++)
+    {
+        if (!sep) {
+            if (i == 4)
+                mountpoint = tok;
+            else if (i == 5)
+                mnt_opts = tok;
+            else if (i > 5 && strcmp(tok, "-") == 0)
+                sep = i;
+        }
+        else if (i == sep + 1) {
+            fstype = tok;
+        }
+        else if (i == sep + 2) {
+            device = tok;
+        }
+        else if (i == sep + 3) {
+            sb_opts = tok;
+        }
+    }
+    if (!mountpoint || !mnt_opts || !fstype || !device)
+        return 1;
+
+    unescape_octal(mountpoint);
+    unescape_octal(device);
+    opts = merge_mount_opts(mnt_opts, sb_opts ? sb_opts : "rw");
+    if (opts == NULL)
+        return -1;
+    ret = mount_list_append(list, device, mountpoint, fstype, opts);
+    free(opts);
+    return ret;
+}
+
+
+// Read mounted filesystems from `path` into `list`. If `mountinfo` is
+// true the file is in /proc/<pid>/mountinfo format, else it's an
+// /etc/mtab-like file read via getmntent_r(). Does not touch the
+// Python C-API, so it can be called with the GIL released. Return -1
+// with errno set on error.
+static int
+read_mounts(const char *path, int mountinfo, mount_list *list) {
+    FILE *file;
+    struct mntent ent;
+    char buf[8192];
+    char *line = NULL;
+    size_t linesize = 0;
+    int ret = 0;
+
+    if (mountinfo) {
+        file = fopen(path, "re");
+        if (file == NULL)
+            return -1;
+        while (getline(&line, &linesize, file) != -1) {
+            if (parse_mountinfo_line(line, list) == -1) {
+                ret = -1;
+                break;
+            }
+        }
+        free(line);
+        fclose(file);
+    }
+    else {
+        file = setmntent(path, "re");
+        if (file == NULL)
+            return -1;
+        while (getmntent_r(file, &ent, buf, sizeof(buf)) != NULL) {
+            if (mount_list_append(
+                    list, ent.mnt_fsname, ent.mnt_dir, ent.mnt_type,
+                    ent.mnt_opts
+                )
+                == -1)
+            {
+                ret = -1;
+                break;
+            }
+        }
+        endmntent(file);
+    }
+    if (ret == -1)
+        errno = ENOMEM;
+    return ret;
+}
+
+
+// Return mounted filesystems as a list of (device, mount point, fs
+// type, options) tuples. `path` is read with the GIL released, either
+// as a mountinfo file (if `mountinfo` is true) or as an /etc/mtab-like
+// one.
 PyObject *
 psutil_disk_partitions(PyObject *self, PyObject *args) {
-    FILE *file = NULL;
-    struct mntent *entry;
-    char *mtab_path;
+    char *path;
+    int mountinfo = 0;
+    int ret;
+    mount_entry *entry;
+    mount_list list;
     PyObject *py_dev = NULL;
     PyObject *py_mountp = NULL;
-    PyObject *py_retlist;
-
-    if (!PyArg_ParseTuple(args, "s", &mtab_path))
-        return NULL;
+    PyObject *py_retlist = NULL;
 
-    py_retlist = PyList_New(0);
-    if (py_retlist == NULL)
+    if (!PyArg_ParseTuple(args, "s|p", &path, &mountinfo))
         return NULL;
 
+    memset(&list, 0, sizeof(list));
     Py_BEGIN_ALLOW_THREADS
-    file = setmntent(mtab_path, "r");
+    ret = read_mounts(path, mountinfo, &list);
     Py_END_ALLOW_THREADS
-    if ((file == 0) || (file == NULL)) {
-        psutil_debug("setmntent() failed");
-        PyErr_SetFromErrnoWithFilename(PyExc_OSError, mtab_path);
+    if (ret == -1) {
+        if (errno == ENOMEM)
+            PyErr_NoMemory();
+        else
+            PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
         goto error;
     }
 
-    // NOTE: getmntent() is MT-Unsafe (it returns a pointer to a static
-    // buffer), so we can't release the GIL around it.
-    while ((entry = getmntent(file)) != NULL) {
-        py_dev = PyUnicode_DecodeFSDefault(entry->mnt_fsname);
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < list.count; i++) {
+        entry = &list.items[i];
+        py_dev = PyUnicode_DecodeFSDefault(entry->device);
         if (!py_dev)
             goto error;
-        py_mountp = PyUnicode_DecodeFSDefault(entry->mnt_dir);
+        py_mountp = PyUnicode_DecodeFSDefault(entry->mountpoint);
         if (!py_mountp)
             goto error;
         if (!pylist_append_fmt(
@@ -51,8 +323,8 @@ psutil_disk_partitions(PyObject *self, PyObject *args) {
                 "(OOss)",
                 py_dev,  // device
                 py_mountp,  // mount point
-                entry->mnt_type,  // fs type
-                entry->mnt_opts  // options
+                entry->fstype,  // fs type
+                entry->opts  // options
             ))
         {
             goto error;
@@ -60,14 +332,189 @@ psutil_disk_partitions(PyObject *self, PyObject *args) {
         Py_CLEAR(py_dev);
         Py_CLEAR(py_mountp);
     }
-    endmntent(file);
+
+    mount_list_free(&list);
     return py_retlist;
 
 error:
-    if (file != NULL)
-        endmntent(file);
+    mount_list_free(&list);
     Py_XDECREF(py_dev);
     Py_XDECREF(py_mountp);
-    Py_DECREF(py_retlist);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// Return True if something was mounted or unmounted since the last
+// call, given an open /proc/<pid>/mountinfo (or mounts) fd. The kernel
+// flags POLLPRI | POLLERR once per change (see mounts_poll() in
+// fs/proc_namespace.c).
+PyObject *
+psutil_mounts_changed(PyObject *self, PyObject *args) {
+    int fd;
+    int ret;
+    struct pollfd pfd;
+
+    if (!PyArg_ParseTuple(args, "i", &fd))
+        return NULL;
+
+    pfd.fd = fd;
+    pfd.events = POLLPRI;
+    pfd.revents = 0;
+    do {
+        ret = poll(&pfd, 1, 0);
+    } while (ret == -1 && errno == EINTR);
+    if (ret == -1)
+        return psutil_oserror_wsyscall("poll()");
+    if (pfd.revents & POLLNVAL) {
+        errno = EBADF;
+        return psutil_oserror_wsyscall("poll()");
+    }
+    return PyBool_FromLong((pfd.revents & (POLLPRI | POLLERR)) != 0);
+}
+
+
+// Parse one /proc/diskstats line into `entry`. Return 0 on success,
+// -1 if the line is malformed. The format has a few variations:
+// * Linux 2.4: "major minor #blocks name <11 fields>" (15 tokens)
+// * Linux 2.6+: "major minor name <fields>", where fields are 11 for
+//   disks, 4 for partitions (until 2.6.25), 15 since 4.18, 17 since 5.5.
+// The name is not included in `entry->fields`. On Linux 2.4 #blocks
+// takes its place, matching the "reads" column position on 2.6.
+// https://www.kernel.org/doc/Documentation/ABI/testing/procfs-diskstats
+static int
+parse_diskstats_line(char *line, diskstats_entry *entry) {
+    char *tokens[DISKSTATS_MAX_FIELDS + 4];
+    char *saveptr = NULL;
+    char *tok;
+    char *end;
+    int ntokens = 0;
+    int name_idx = 2;
+    size_t len;
+
+    tok = strtok_r(line, " \t\n", &saveptr);
+    while (tok != NULL && ntokens < DISKSTATS_MAX_FIELDS + 4) {
+        tokens[ntokens++] = tok;
+        tok = strtok_r(NULL, " \t\n", &saveptr);
+    }
+    if (ntokens < 3)
+        return -1;
+    if (ntokens == 15) {
+        strtoull(tokens[2], &end, 10);
+        if (*end == '\0')
+            name_idx = 3;  // Linux 2.4
+    }
+
+    len = strlen(tokens[name_idx]);
+    if (len >= sizeof(entry->name))
+        return -1;
+    memcpy(entry->name, tokens[name_idx], len + 1);
+
+    entry->nfields = 0;
+    for (int i = 2; i < ntokens; i++) {
+        if (i == name_idx)
+            continue;
+        entry->fields[entry->nfields] = strtoull(tokens[i], &end, 10);
+        if (*end != '\0')
+            return -1;
+        entry->nfields++;
+    }
+    return 0;
+}
+
+
+// Read /proc/diskstats (path passed as argument) and return a list of
+// (name, (field, ...)) tuples including all the numeric columns the
+// running kernel provides. The file is read and parsed with the GIL
+// released.
+PyObject *
+psutil_disk_io_counters_procfs(PyObject *self, PyObject *args) {
+    char *path;
+    char *line = NULL;
+    size_t linesize = 0;
+    size_t count = 0;
+    size_t capacity = 0;
+    int nomem = 0;
+    int badline = 0;
+    FILE *file = NULL;
+    diskstats_entry *entries = NULL;
+    diskstats_entry *tmp;
+    PyObject *py_fields = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &path))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    file = fopen(path, "re");
+    if (file != NULL) {
+        while (getline(&line, &linesize, file) != -1) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                tmp = realloc(entries, capacity * sizeof(*entries));
+                if (tmp == NULL) {
+                    nomem = 1;
+                    break;
+                }
+                entries = tmp;
+            }
+            if (parse_diskstats_line(line, &entries[count]) != 0) {
+                badline = 1;
+                break;
+            }
+            count++;
+        }
+        fclose(file);
+    }
+    free(line);
+    Py_END_ALLOW_THREADS
+
+    if (file == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+        goto error;
+    }
+    if (nomem) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    if (badline) {
+        PyErr_Format(
+            PyExc_ValueError, "not sure how to interpret line %zu of %s",
+            count + 1, path
+        );
+        goto error;
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < count; i++) {
+        py_fields = PyTuple_New(entries[i].nfields);
+        if (py_fields == NULL)
+            goto error;
+        for (int j = 0; j < entries[i].nfields; j++) {
+            PyObject *py_value = PyLong_FromUnsignedLongLong(
+                entries[i].fields[j]
+            );
+            if (py_value == NULL)
+                goto error;
+            PyTuple_SetItem(py_fields, j, py_value);  // steals ref
+        }
+        if (!pylist_append_fmt(
+                py_retlist, "(NO)", PyUnicode_DecodeFSDefault(entries[i].name),
+                py_fields
+            ))
+        {
+            goto error;
+        }
+        Py_CLEAR(py_fields);
+    }
+    free(entries);
+    return py_retlist;
+
+error:
+    free(entries);
+    Py_XDECREF(py_fields);
+    Py_XDECREF(py_retlist);
     return NULL;
 }
@@ -0,0 +1,618 @@
+/*
+ * Copyright (c) 2009, Giampaolo Rodola'. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// Walk /proc/<pid>/fd of all processes (like "lsof") and classify
+// every file descriptor. Links are read and stat()ed relative to the
+// fd directory via readlinkat() / fstatat(), so that the kernel
+// resolves "/proc/<pid>/fd" only once per process.
+
+#include <Python.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#ifndef PROC_SUPER_MAGIC
+#define PROC_SUPER_MAGIC 0x9fa0
+#endif
+
+#include "../../arch/all/init.h"
+
+enum {
+    FD_KIND_FILE,
+    FD_KIND_DIR,
+    FD_KIND_SOCKET,
+    FD_KIND_PIPE,
+    FD_KIND_CHAR,
+    FD_KIND_BLOCK,
+    FD_KIND_EVENTFD,
+    FD_KIND_EVENTPOLL,
+    FD_KIND_SIGNALFD,
+    FD_KIND_TIMERFD,
+    FD_KIND_INOTIFY,
+    FD_KIND_PIDFD,
+    FD_KIND_ANON_INODE,
+    FD_KIND_OTHER,
+    FD_KIND_COUNT,
+};
+
+// Indexed by FD_KIND_* (which is also the bit used in kind masks).
+static const char *fd_kinds[] = {
+    "file",
+    "dir",
+    "socket",
+    "pipe",
+    "char",
+    "block",
+    "eventfd",
+    "eventpoll",
+    "signalfd",
+    "timerfd",
+    "inotify",
+    "pidfd",
+    "anon_inode",
+    "other",
+};
+
+struct fd_entry {
+    pid_t pid;
+    int fd;
+    int kind;
+    int flags;
+    unsigned long long inode;
+    unsigned long long pos;
+    char *path;
+};
+
+struct fd_list {
+    struct fd_entry *items;
+    size_t count;
+    size_t capacity;
+};
+
+struct fd_filter {
+    const char *prefix;
+    size_t prefix_len;
+    long long inode;  // -1 = any
+    unsigned int kinds;  // bitmask of fd_kinds indexes
+};
+
+
+// Return the index of `name` in `fd_kinds`, or -1.
+static int
+fd_kind_index(const char *name) {
+    for (size_t i = 0; i < FD_KIND_COUNT; i++) {
+        if (strcmp(fd_kinds[i], name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+
+// Return the kind of a fd given its st_mode and, for anonymous inodes
+// (which have no file type bits), what readlink() returned for it
+// (e.g. "anon_inode:[eventfd]", "anon_inode:inotify").
+static int
+fd_kind(mode_t mode, const char *link) {
+    static const struct {
+        const char *name;
+        int kind;
+    } anon[] = {
+        {"[eventfd]", FD_KIND_EVENTFD},
+        {"[eventpoll]", FD_KIND_EVENTPOLL},
+        {"[signalfd]", FD_KIND_SIGNALFD},
+        {"[timerfd]", FD_KIND_TIMERFD},
+        {"inotify", FD_KIND_INOTIFY},
+        {"[pidfd]", FD_KIND_PIDFD},
+    };
+    const char *name;
+
+    switch (mode & S_IFMT) {
+        case S_IFREG:
+            return FD_KIND_FILE;
+        case S_IFDIR:
+            return FD_KIND_DIR;
+        case S_IFSOCK:
+            return FD_KIND_SOCKET;
+        case S_IFIFO:
+            return FD_KIND_PIPE;
+        case S_IFCHR:
+            return FD_KIND_CHAR;
+        case S_IFBLK:
+            return FD_KIND_BLOCK;
+    }
+    if (link == NULL)
+        return FD_KIND_OTHER;
+    // pidfs, Linux 6.9+
+    if (strncmp(link, "pidfd:", 6) == 0)
+        return FD_KIND_PIDFD;
+    if (strncmp(link, "anon_inode:", 11) != 0)
+        return FD_KIND_OTHER;
+    name = link + 11;
+    for (size_t i = 0; i < sizeof(anon) / sizeof(anon[0]); i++) {
+        if (strcmp(anon[i].name, name) == 0)
+            return anon[i].kind;
+    }
+    return FD_KIND_ANON_INODE;
+}
+
+
+// readlink() fd `name` relative to the fd directory into `buf`.
+// Return the path length, or -1 on error.
+static ssize_t
+read_fd_link(int dirfd, const char *name, char *buf, size_t size) {
+    ssize_t len;
+
+    len = readlinkat(dirfd, name, buf, size - 1);
+    if (len == -1)
+        return -1;
+    buf[len] = '\0';
+    // Paths may contain a NUL followed by garbage, see:
+    // https://github.com/giampaolo/psutil/issues/717
+    return (ssize_t)strlen(buf);
+}
+
+
+// Read "pos" and "flags" out of /proc/<pid>/fdinfo/<fd>.
+static int
+read_fdinfo(
+    int dirfd, const char *name, unsigned long long *pos, int *flags
+) {
+    char buf[256];
+    char *ptr;
+
+    if (psutil_read_at(dirfd, name, buf, sizeof(buf)) <= 0)
+        return -1;
+    ptr = strstr(buf, "pos:");
+    if (ptr == NULL)
+        return -1;
+    *pos = strtoull(ptr + 4, NULL, 10);
+    ptr = strstr(buf, "flags:");
+    if (ptr == NULL)
+        return -1;
+    *flags = (int)strtol(ptr + 6, NULL, 8);
+    return 0;
+}
+
+
+static int
+fd_list_append(struct fd_list *list, struct fd_entry *entry) {
+    struct fd_entry *tmp;
+
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        tmp = realloc(list->items, list->capacity * sizeof(*tmp));
+        if (tmp == NULL)
+            return -1;
+        list->items = tmp;
+    }
+    list->items[list->count++] = *entry;
+    return 0;
+}
+
+
+static void
+fd_list_free(struct fd_list *list) {
+    for (size_t i = 0; i < list->count; i++)
+        free(list->items[i].path);
+    free(list->items);
+}
+
+
+// Collect the fds of `pid` matching `filter` into `list`. Processes
+// which went away or can't be inspected (EACCES) are skipped. Return
+// -1 on ENOMEM.
+static int
+scan_pid_fds(
+    int procfd, pid_t pid, struct fd_filter *filter, struct fd_list *list
+) {
+    char name[64];
+    char link[PATH_MAX + 1];
+    struct stat st;
+    struct dirent *de;
+    struct fd_entry entry;
+    DIR *dir;
+    int fddir;
+    int infodir = -1;
+    int have_link;
+    int ret = 0;
+    ssize_t len;
+    size_t suffix_len = strlen(" (deleted)");
+
+    snprintf(name, sizeof(name), "%d/fd", (int)pid);
+    fddir = openat(procfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fddir == -1)
+        return 0;
+    dir = fdopendir(fddir);
+    if (dir == NULL) {
+        close(fddir);
+        return 0;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] < '0' || de->d_name[0] > '9')
+            continue;
+        have_link = 0;
+        link[0] = '\0';
+        // Cheapest filter first: a prefix only needs readlink(), an
+        // inode only needs stat().
+        if (filter->prefix != NULL) {
+            if (read_fd_link(fddir, de->d_name, link, sizeof(link)) == -1) {
+                if (errno == EACCES || errno == EPERM)
+                    break;  // we can list fds but not inspect them
+                continue;
+            }
+            if (strncmp(link, filter->prefix, filter->prefix_len) != 0)
+                continue;
+            have_link = 1;
+        }
+        if (fstatat(fddir, de->d_name, &st, 0) == -1) {
+            if (errno == EACCES || errno == EPERM)
+                break;
+            continue;  // closed in the meantime
+        }
+        if (filter->inode != -1
+            && (unsigned long long)st.st_ino
+                   != (unsigned long long)filter->inode)
+            continue;
+
+        memset(&entry, 0, sizeof(entry));
+        entry.kind = fd_kind(st.st_mode, NULL);
+        if (entry.kind == FD_KIND_OTHER) {
+            if (!have_link) {
+                if (read_fd_link(fddir, de->d_name, link, sizeof(link))
+                    == -1)
+                    continue;
+                have_link = 1;
+            }
+            entry.kind = fd_kind(st.st_mode, link);
+        }
+        if (!(filter->kinds & (1u << entry.kind)))
+            continue;
+        if (!have_link
+            && read_fd_link(fddir, de->d_name, link, sizeof(link)) == -1)
+            continue;
+        len = (ssize_t)strlen(link);
+        // Deleted files have a " (deleted)" suffix.
+        if (entry.kind == FD_KIND_FILE && st.st_nlink == 0
+            && (size_t)len > suffix_len
+            && strcmp(link + len - suffix_len, " (deleted)") == 0)
+        {
+            link[len - suffix_len] = '\0';
+        }
+
+        if (infodir == -1) {
+            snprintf(name, sizeof(name), "%d/fdinfo", (int)pid);
+            infodir = openat(
+                procfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC
+            );
+            if (infodir == -1)
+                break;  // process gone
+        }
+        if (read_fdinfo(infodir, de->d_name, &entry.pos, &entry.flags) != 0)
+            continue;  // closed in the meantime
+
+        entry.pid = pid;
+        entry.fd = atoi(de->d_name);
+        entry.inode = (unsigned long long)st.st_ino;
+        entry.path = strdup(link);
+        if (entry.path == NULL || fd_list_append(list, &entry) != 0) {
+            free(entry.path);
+            ret = -1;
+            break;
+        }
+    }
+
+    if (infodir != -1)
+        close(infodir);
+    closedir(dir);
+    return ret;
+}
+
+
+// Return the file descriptors opened by all processes (or by `pid`
+// only, if != -1) as a list of
+// (pid, fd, path, kind, inode, position, flags) tuples. `prefix`
+// (a path prefix), `inode` (-1 = any) and `kinds` (a sequence of
+// kind names, or None for all) are applied in C, before any Python
+// object gets created. Processes which can't be inspected are
+// skipped. The whole walk happens with the GIL released.
+PyObject *
+psutil_open_files_scan(PyObject *self, PyObject *args) {
+    char *procfs;
+    char *endptr;
+    int procfd;
+    int saved_errno = 0;
+    int kind;
+    int ret = 0;
+    int pid = -1;
+    long long inode = -1;
+    long value;
+    struct dirent *de;
+    struct fd_entry *entry;
+    struct fd_filter filter;
+    struct fd_list list;
+    DIR *dir = NULL;
+    PyObject *py_prefix;
+    PyObject *py_kinds;
+    PyObject *py_kind;
+    PyObject *py_prefix_bytes = NULL;
+    PyObject *py_path = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(
+            args, "siOLO", &procfs, &pid, &py_prefix, &inode, &py_kinds
+        ))
+    {
+        return NULL;
+    }
+
+    memset(&filter, 0, sizeof(filter));
+    memset(&list, 0, sizeof(list));
+    filter.inode = inode;
+    if (py_prefix != Py_None) {
+        if (!PyUnicode_FSConverter(py_prefix, &py_prefix_bytes))
+            return NULL;
+        filter.prefix = PyBytes_AsString(py_prefix_bytes);
+        if (filter.prefix == NULL)
+            goto error;
+        filter.prefix_len = strlen(filter.prefix);
+    }
+    if (py_kinds == Py_None) {
+        filter.kinds = (1u << FD_KIND_COUNT) - 1;
+    }
+    else {
+        Py_ssize_t n = PySequence_Size(py_kinds);
+        if (n == -1)
+            goto error;
+        for (Py_ssize_t i = 0; i < n; i++) {
+            py_kind = PySequence_GetItem(py_kinds, i);
+            if (py_kind == NULL)
+                goto error;
+            kind = -1;
+            if (PyUnicode_Check(py_kind)) {
+                PyObject *py_ascii = PyUnicode_AsASCIIString(py_kind);
+                if (py_ascii != NULL) {
+                    kind = fd_kind_index(PyBytes_AsString(py_ascii));
+                    Py_DECREF(py_ascii);
+                }
+                PyErr_Clear();
+            }
+            if (kind == -1) {
+                PyErr_Format(PyExc_ValueError, "invalid kind %R", py_kind);
+                Py_DECREF(py_kind);
+                goto error;
+            }
+            Py_DECREF(py_kind);
+            filter.kinds |= 1u << kind;
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    procfd = psutil_open_dir(procfs);
+    if (procfd == -1)
+        saved_errno = errno;
+    else {
+        if (pid != -1) {
+            ret = scan_pid_fds(procfd, pid, &filter, &list);
+        }
+        else {
+            dir = fdopendir(dup(procfd));
+            if (dir == NULL)
+                saved_errno = errno;
+            else {
+                while ((de = readdir(dir)) != NULL) {
+                    value = strtol(de->d_name, &endptr, 10);
+                    if (*endptr != '\0' || endptr == de->d_name)
+                        continue;
+                    ret = scan_pid_fds(procfd, (pid_t)value, &filter, &list);
+                    if (ret != 0)
+                        break;
+                }
+                closedir(dir);
+            }
+        }
+        close(procfd);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (saved_errno != 0) {
+        errno = saved_errno;
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, procfs);
+        goto error;
+    }
+    if (ret != 0) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < list.count; i++) {
+        entry = &list.items[i];
+        py_path = PyUnicode_DecodeFSDefault(entry->path);
+        if (py_path == NULL)
+            goto error;
+        if (!pylist_append_fmt(
+                py_retlist,
+                "(iiOsKKi)",
+                (int)entry->pid,
+                entry->fd,
+                py_path,
+                fd_kinds[entry->kind],
+                entry->inode,
+                entry->pos,
+                entry->flags
+            ))
+        {
+            goto error;
+        }
+        Py_CLEAR(py_path);
+    }
+
+    fd_list_free(&list);
+    Py_XDECREF(py_prefix_bytes);
+    return py_retlist;
+
+error:
+    fd_list_free(&list);
+    Py_XDECREF(py_path);
+    Py_XDECREF(py_prefix_bytes);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// Return 1 if `name` is the fd used by this process to read its own
+// /proc/<pid>/fd directory, which must not be counted.
+static int
+is_own_dirfd(pid_t pid, DIR *dir, const char *name) {
+    return pid == getpid() && atoi(name) == dirfd(dir);
+}
+
+
+// Count the entries of a /proc/<pid>/fd directory, without creating a
+// Python string per fd like len(os.listdir()) would. Return -1 on
+// error with errno set.
+static long
+count_fds(const char *path, pid_t pid) {
+    DIR *dir;
+    struct dirent *de;
+    long count = 0;
+
+    dir = opendir(path);
+    if (dir == NULL)
+        return -1;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] != '.' && !is_own_dirfd(pid, dir, de->d_name))
+            count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+
+// Return the number of fds in the /proc/<pid>/fd directory `path`,
+// or -1 on error with errno set. Since Linux 6.2 stat() on it reports
+// the count in st_size (0 on older kernels), so the directory doesn't
+// even have to be read. That's only true for procfs though, not for
+// e.g. a fake PROCFS_PATH tree. Does not touch the Python C-API.
+long
+psutil_count_fds(const char *path, pid_t pid) {
+    struct stat st;
+    struct statfs stfs;
+
+    if (stat(path, &st) == -1)
+        return -1;
+    if (st.st_size > 0 && statfs(path, &stfs) == 0
+        && stfs.f_type == PROC_SUPER_MAGIC)
+        return (long)st.st_size;
+    return count_fds(path, pid);
+}
+
+
+// Return the number of fds opened by a process.
+PyObject *
+psutil_proc_num_fds(PyObject *self, PyObject *args) {
+    char *procfs;
+    char path[PATH_MAX];
+    int pid;
+    long count;
+
+    if (!PyArg_ParseTuple(args, "si", &procfs, &pid))
+        return NULL;
+    snprintf(path, sizeof(path), "%s/%d/fd", procfs, pid);
+
+    Py_BEGIN_ALLOW_THREADS
+    count = psutil_count_fds(path, (pid_t)pid);
+    Py_END_ALLOW_THREADS
+
+    if (count == -1)
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    return PyLong_FromLong(count);
+}
+
+
+// Return a tuple with the number of fds of each kind opened by a
+// process, in fd_kinds order. Fds closed in the meantime are not
+// counted.
+PyObject *
+psutil_proc_fd_counts(PyObject *self, PyObject *args) {
+    char *procfs;
+    char path[PATH_MAX];
+    char link[PATH_MAX + 1];
+    int pid;
+    struct stat st;
+    struct dirent *de;
+    DIR *dir;
+    int fddir;
+    int kind;
+    int saved_errno = 0;
+    unsigned long counts[FD_KIND_COUNT];
+    PyObject *py_tuple;
+
+    if (!PyArg_ParseTuple(args, "si", &procfs, &pid))
+        return NULL;
+    snprintf(path, sizeof(path), "%s/%d/fd", procfs, pid);
+
+    memset(counts, 0, sizeof(counts));
+    Py_BEGIN_ALLOW_THREADS
+    dir = opendir(path);
+    if (dir != NULL) {
+        fddir = dirfd(dir);
+        while ((de = readdir(dir)) != NULL) {
+            if (de->d_name[0] == '.' || is_own_dirfd(pid, dir, de->d_name))
+                continue;
+            // Fds closed in the meantime are skipped. EACCES means
+            // we can list fds but not inspect them (e.g. PID 1).
+            if (fstatat(fddir, de->d_name, &st, 0) == -1) {
+                if (errno == EACCES || errno == EPERM) {
+                    saved_errno = errno;
+                    break;
+                }
+                continue;
+            }
+            kind = fd_kind(st.st_mode, NULL);
+            if (kind == FD_KIND_OTHER) {
+                if (read_fd_link(fddir, de->d_name, link, sizeof(link)) == -1)
+                    continue;
+                kind = fd_kind(st.st_mode, link);
+            }
+            counts[kind]++;
+        }
+        closedir(dir);
+    }
+    else {
+        saved_errno = errno;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (saved_errno != 0) {
+        errno = saved_errno;
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    }
+
+    py_tuple = PyTuple_New(FD_KIND_COUNT);
+    if (py_tuple == NULL)
+        return NULL;
+    for (size_t i = 0; i < FD_KIND_COUNT; i++) {
+        // PyTuple_SetItem steals the reference, also on error
+        if (PyTuple_SetItem(py_tuple, i, PyLong_FromUnsignedLong(counts[i]))
+            != 0)
+        {
+            Py_DECREF(py_tuple);
+            return NULL;
+        }
+    }
+    return py_tuple;
+}
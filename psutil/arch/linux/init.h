@@ -8,11 +8,50 @@
 #include <sys/syscall.h>  // __NR_*
 #include <sched.h>  // CPU_ALLOC
 
+// Per-row status of the bulk /proc scans (pids.c), exposed to Python
+// as the ROW_* constants.
+enum psutil_row_status {
+    PSUTIL_ROW_OK = 0,
+    PSUTIL_ROW_GONE,
+    PSUTIL_ROW_ZOMBIE,
+    PSUTIL_ROW_DENIED,
+};
+
+// fds.c
+long psutil_count_fds(const char *path, pid_t pid);
+
+// sysfs.c
+ssize_t psutil_read_at(int dirfd, const char *path, char *buf, size_t size);
+int psutil_open_dir(const char *path);
+PyObject *psutil_encode_names(
+    PyObject *py_names, const char ***names, Py_ssize_t *count
+);
+
+PyObject *psutil_cpufreq_time_in_state(PyObject *self, PyObject *args);
+PyObject *psutil_cpuinfo_freqs(PyObject *self, PyObject *args);
+PyObject *psutil_disk_io_counters_procfs(PyObject *self, PyObject *args);
 PyObject *psutil_disk_partitions(PyObject *self, PyObject *args);
 PyObject *psutil_linux_sysinfo(PyObject *self, PyObject *args);
+PyObject *psutil_mounts_changed(PyObject *self, PyObject *args);
 PyObject *psutil_net_if_duplex_speed(PyObject *self, PyObject *args);
+PyObject *psutil_net_if_notify_drain(PyObject *self, PyObject *args);
+PyObject *psutil_net_if_notify_open(PyObject *self, PyObject *args);
+PyObject *psutil_net_if_stats_netlink(PyObject *self, PyObject *args);
+PyObject *psutil_net_io_counters_netlink(PyObject *self, PyObject *args);
+PyObject *psutil_open_files_scan(PyObject *self, PyObject *args);
+PyObject *psutil_pids(PyObject *self, PyObject *args);
+PyObject *psutil_ppid_map(PyObject *self, PyObject *args);
+PyObject *psutil_proc_children(PyObject *self, PyObject *args);
+PyObject *psutil_proc_fd_counts(PyObject *self, PyObject *args);
+PyObject *psutil_proc_filter_scan(PyObject *self, PyObject *args);
 PyObject *psutil_proc_ioprio_get(PyObject *self, PyObject *args);
 PyObject *psutil_proc_ioprio_set(PyObject *self, PyObject *args);
+PyObject *psutil_proc_num_fds(PyObject *self, PyObject *args);
+PyObject *psutil_proc_rollup(PyObject *self, PyObject *args);
+PyObject *psutil_proc_stat_scan(PyObject *self, PyObject *args);
+PyObject *psutil_proc_threads(PyObject *self, PyObject *args);
+PyObject *psutil_proc_top(PyObject *self, PyObject *args);
+PyObject *psutil_sysfs_read_ints(PyObject *self, PyObject *args);
 
 // Should exist starting from CentOS 6 (year 2011).
 #ifdef CPU_ALLOC
@@ -5,10 +5,16 @@
  */
 
 #include <Python.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <linux/sockios.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <linux/if.h>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <linux/version.h>
 #include <unistd.h>
 
@@ -27,6 +33,15 @@ typedef __u8 u8;
 #define _LINUX_SYSINFO_H
 #include <linux/ethtool.h>
 
+// ethtool netlink interface, Linux 5.6+.
+#if defined(__has_include)
+#if __has_include(<linux/ethtool_netlink.h>)
+#include <linux/genetlink.h>
+#include <linux/ethtool_netlink.h>
+#define PSUTIL_HAS_ETHTOOL_NETLINK
+#endif
+#endif
+
 // * defined in linux/ethtool.h but not always available (e.g. Android)
 // * #ifdef check needed for old kernels, see:
 //   https://github.com/giampaolo/psutil/issues/2164
@@ -50,20 +65,59 @@ psutil_ethtool_cmd_speed(const struct ethtool_cmd *ecmd) {
 #define SPEED_UNKNOWN -1
 #endif
 
+// Get duplex and speed of `nic_name` via the SIOCETHTOOL ioctl, using
+// the already open socket `sock`. If the NIC doesn't support it they
+// are set to DUPLEX_UNKNOWN and 0. Return -1 on error with errno set.
 // References:
 // * https://github.com/dpaleino/wicd/blob/master/wicd/backends/be-ioctl.py
 // * http://www.i-scream.org/libstatgrab/
+static int
+ethtool_ioctl_duplex_speed(
+    int sock, const char *nic_name, int *duplex, int *speed
+) {
+    struct ifreq ifr;
+    struct ethtool_cmd ethcmd;
+    __u32 uint_speed;
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, nic_name, sizeof(ifr.ifr_name) - 1);
+    memset(&ethcmd, 0, sizeof ethcmd);
+    ethcmd.cmd = ETHTOOL_GSET;
+    ifr.ifr_data = (void *)&ethcmd;
+
+    if (ioctl(sock, SIOCETHTOOL, &ifr) == -1) {
+        if ((errno == EOPNOTSUPP) || (errno == EINVAL) || (errno == EBUSY)) {
+            // EOPNOTSUPP may occur in case of wi-fi cards.
+            // For EINVAL see:
+            // https://github.com/giampaolo/psutil/issues/797
+            //     #issuecomment-202999532
+            // EBUSY may occur with broken drivers or busy devices.
+            *duplex = DUPLEX_UNKNOWN;
+            *speed = 0;
+            return 0;
+        }
+        return -1;
+    }
+
+    *duplex = ethcmd.duplex;
+    // speed is returned from ethtool as a __u32 ranging from 0 to INT_MAX
+    // or SPEED_UNKNOWN (-1)
+    uint_speed = psutil_ethtool_cmd_speed(&ethcmd);
+    if (uint_speed == (__u32)SPEED_UNKNOWN || uint_speed > INT_MAX)
+        *speed = 0;
+    else
+        *speed = (int)uint_speed;
+    return 0;
+}
+
+
 PyObject *
 psutil_net_if_duplex_speed(PyObject *self, PyObject *args) {
     char *nic_name;
-    int sock = 0;
+    int sock;
     int ret;
     int duplex;
-    __u32 uint_speed;
     int speed;
-    struct ifreq ifr;
-    struct ethtool_cmd ethcmd;
-    PyObject *py_retlist = NULL;
 
     if (!PyArg_ParseTuple(args, "s", &nic_name))
         return NULL;
@@ -71,55 +125,682 @@ psutil_net_if_duplex_speed(PyObject *self, PyObject *args) {
     sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock == -1)
         return psutil_oserror_wsyscall("socket()");
-    str_copy(ifr.ifr_name, sizeof(ifr.ifr_name), nic_name);
 
-
-    // duplex and speed
-    memset(&ethcmd, 0, sizeof ethcmd);
-    ethcmd.cmd = ETHTOOL_GSET;
-    ifr.ifr_data = (void *)&ethcmd;
     // The driver may read the PHY / EEPROM to answer this, and it
     // takes rtnl_lock() meanwhile.
     Py_BEGIN_ALLOW_THREADS
-    ret = ioctl(sock, SIOCETHTOOL, &ifr);
+    ret = ethtool_ioctl_duplex_speed(sock, nic_name, &duplex, &speed);
     Py_END_ALLOW_THREADS
+    close(sock);
+    if (ret == -1)
+        return psutil_oserror_wsyscall("ioctl(SIOCETHTOOL)");
+    return Py_BuildValue("[ii]", duplex, speed);
+}
 
-    if (ret != -1) {
-        duplex = ethcmd.duplex;
-        // speed is returned from ethtool as a __u32 ranging from 0 to INT_MAX
-        // or SPEED_UNKNOWN (-1)
-        uint_speed = psutil_ethtool_cmd_speed(&ethcmd);
-        if (uint_speed == (__u32)SPEED_UNKNOWN || uint_speed > INT_MAX) {
-            speed = 0;
-        }
-        else {
-            speed = (int)uint_speed;
+
+// --- netlink
+
+// Invoked for every netlink reply message. Return -1 with errno set to
+// abort the request.
+typedef int (*nl_callback)(struct nlmsghdr *nlh, void *arg);
+
+// Send `req` over the netlink socket `sock` and invoke `cb` for every
+// reply message, until the end of the dump (or after the first reply
+// if `req` is not a dump request). Return -1 on error with errno set,
+// including errors reported by the kernel. Does not touch the Python
+// C-API, so it can be called with the GIL released.
+static int
+nl_request(int sock, struct nlmsghdr *req, nl_callback cb, void *arg) {
+    // Large enough for a whole dump message; the kernel uses at most
+    // max(PAGE_SIZE, 8192) bytes per datagram.
+    char buf[32768];
+    ssize_t nbytes;
+    struct sockaddr_nl sa;
+    struct nlmsghdr *nlh;
+    struct nlmsgerr *nlerr;
+    int dump = req->nlmsg_flags & NLM_F_DUMP;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    if (sendto(
+            sock, req, req->nlmsg_len, 0, (struct sockaddr *)&sa, sizeof(sa)
+        )
+        == -1)
+        return -1;
+
+    for (;;) {
+        do {
+            nbytes = recv(sock, buf, sizeof(buf), 0);
+        } while (nbytes == -1 && errno == EINTR);
+        if (nbytes == -1)
+            return -1;
+        if (nbytes == 0)
+            return 0;
+
+        for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, nbytes);
+             nlh = NLMSG_NEXT(nlh, nbytes))
+        {
+            if (nlh->nlmsg_seq != req->nlmsg_seq)
+                continue;
+            if (nlh->nlmsg_type == NLMSG_DONE)
+                return 0;
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                nlerr = NLMSG_DATA(nlh);
+                if (nlerr->error == 0)  // ACK
+                    return 0;
+                errno = -nlerr->error;
+                return -1;
+            }
+            if (cb(nlh, arg) == -1)
+                return -1;
+            if (!dump)
+                return 0;
         }
     }
-    else {
-        if ((errno == EOPNOTSUPP) || (errno == EINVAL) || (errno == EBUSY)) {
-            // EOPNOTSUPP may occur in case of wi-fi cards.
-            // For EINVAL see:
-            // https://github.com/giampaolo/psutil/issues/797
-            //     #issuecomment-202999532
-            // EBUSY may occur with broken drivers or busy devices.
-            duplex = DUPLEX_UNKNOWN;
-            speed = 0;
+}
+
+
+// Make room for one more item in a malloc()ed array. Return -1 on
+// error with errno set.
+static int
+array_reserve(void **items, size_t *capacity, size_t count, size_t size) {
+    void *tmp;
+
+    if (count < *capacity)
+        return 0;
+    *capacity = *capacity ? *capacity * 2 : 64;
+    tmp = realloc(*items, *capacity * size);
+    if (tmp == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    *items = tmp;
+    return 0;
+}
+
+
+// The attributes of a RTM_NEWLINK message we care about.
+struct link_info {
+    int ifindex;
+    unsigned int flags;
+    const char *name;
+    unsigned int mtu;
+    int has_stats;
+    struct rtnl_link_stats64 stats;
+};
+
+
+// Parse a RTM_NEWLINK message. Return 0 if it doesn't carry a name.
+static int
+parse_link(struct nlmsghdr *nlh, struct link_info *info) {
+    struct ifinfomsg *ifm = NLMSG_DATA(nlh);
+    struct rtattr *rta;
+    struct rtnl_link_stats st32;
+    int len;
+    int has_st32 = 0;
+
+    memset(info, 0, sizeof(*info));
+    len = nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*ifm));
+    if (nlh->nlmsg_type != RTM_NEWLINK || len < 0)
+        return 0;
+    info->ifindex = ifm->ifi_index;
+    info->flags = ifm->ifi_flags;
+
+    for (rta = IFLA_RTA(ifm); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        switch (rta->rta_type) {
+            case IFLA_IFNAME:
+                info->name = RTA_DATA(rta);
+                break;
+            case IFLA_MTU:
+                if (RTA_PAYLOAD(rta) >= sizeof(info->mtu))
+                    memcpy(&info->mtu, RTA_DATA(rta), sizeof(info->mtu));
+                break;
+            case IFLA_STATS64:
+                // May be unaligned, hence memcpy().
+                if (RTA_PAYLOAD(rta) >= sizeof(info->stats)) {
+                    memcpy(&info->stats, RTA_DATA(rta), sizeof(info->stats));
+                    info->has_stats = 1;
+                }
+                break;
+            case IFLA_STATS:
+                if (RTA_PAYLOAD(rta) >= sizeof(st32)) {
+                    memcpy(&st32, RTA_DATA(rta), sizeof(st32));
+                    has_st32 = 1;
+                }
+                break;
         }
-        else {
-            psutil_oserror_wsyscall("ioctl(SIOCETHTOOL)");
+    }
+
+    if (!info->has_stats && has_st32) {
+        // Kernels < 2.6.35 only provide 32-bit counters.
+        info->stats.tx_bytes = st32.tx_bytes;
+        info->stats.rx_bytes = st32.rx_bytes;
+        info->stats.tx_packets = st32.tx_packets;
+        info->stats.rx_packets = st32.rx_packets;
+        info->stats.rx_errors = st32.rx_errors;
+        info->stats.tx_errors = st32.tx_errors;
+        info->stats.rx_dropped = st32.rx_dropped;
+        info->stats.rx_missed_errors = st32.rx_missed_errors;
+        info->stats.tx_dropped = st32.tx_dropped;
+        info->has_stats = 1;
+    }
+    return info->name != NULL;
+}
+
+
+// Send a RTM_GETLINK request: a dump of all interfaces if `ifindex` is
+// 0, else a query for that interface only.
+static int
+rtnl_getlink(int sock, int ifindex, nl_callback cb, void *arg) {
+    struct {
+        struct nlmsghdr nlh;
+        struct ifinfomsg ifm;
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifm));
+    req.nlh.nlmsg_type = RTM_GETLINK;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST;
+    if (ifindex <= 0)
+        req.nlh.nlmsg_flags |= NLM_F_DUMP;
+    req.nlh.nlmsg_seq = 1;
+    req.ifm.ifi_family = AF_UNSPEC;
+    req.ifm.ifi_index = ifindex > 0 ? ifindex : 0;
+    return nl_request(sock, &req.nlh, cb, arg);
+}
+
+
+struct nic_io {
+    char name[IFNAMSIZ];
+    unsigned long long counters[8];
+};
+
+struct nic_io_list {
+    const char *prefix;
+    size_t prefix_len;
+    struct nic_io *items;
+    size_t count;
+    size_t capacity;
+};
+
+
+// Collect the counters of one interface. They are combined the same
+// way /proc/net/dev does (see dev_seq_printf_stats() in
+// net/core/net-procfs.c).
+static int
+collect_nic_io(struct nlmsghdr *nlh, void *arg) {
+    struct nic_io_list *list = arg;
+    struct nic_io *item;
+    struct link_info info;
+
+    if (!parse_link(nlh, &info) || !info.has_stats)
+        return 0;
+    if (strncmp(info.name, list->prefix, list->prefix_len) != 0)
+        return 0;
+    if (array_reserve(
+            (void **)&list->items,
+            &list->capacity,
+            list->count,
+            sizeof(*list->items)
+        )
+        == -1)
+        return -1;
+
+    item = &list->items[list->count++];
+    strncpy(item->name, info.name, sizeof(item->name) - 1);
+    item->name[sizeof(item->name) - 1] = '\0';
+    item->counters[0] = info.stats.tx_bytes;
+    item->counters[1] = info.stats.rx_bytes;
+    item->counters[2] = info.stats.tx_packets;
+    item->counters[3] = info.stats.rx_packets;
+    item->counters[4] = info.stats.rx_errors;
+    item->counters[5] = info.stats.tx_errors;
+    item->counters[6] = info.stats.rx_dropped + info.stats.rx_missed_errors;
+    item->counters[7] = info.stats.tx_dropped;
+    return 0;
+}
+
+
+// Return I/O counters of all network interfaces whose name starts with
+// `prefix` (an empty string matches all of them) via a single
+// rtnetlink RTM_GETLINK dump, reading IFLA_STATS64 binary stats
+// instead of parsing /proc/net/dev. If `ifindex` is > 0 only that
+// interface is queried (an empty list is returned if it doesn't
+// exist). The list items are (name, bytes_sent, bytes_recv,
+// packets_sent, packets_recv, errin, errout, dropin, dropout) tuples.
+PyObject *
+psutil_net_io_counters_netlink(PyObject *self, PyObject *args) {
+    const char *prefix;
+    int ifindex;
+    int sock;
+    int ret = 0;
+    struct nic_io *item;
+    struct nic_io_list list;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "si", &prefix, &ifindex))
+        return NULL;
+    memset(&list, 0, sizeof(list));
+    list.prefix = prefix;
+    list.prefix_len = strlen(prefix);
+
+    Py_BEGIN_ALLOW_THREADS
+    sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (sock != -1) {
+        ret = rtnl_getlink(sock, ifindex, collect_nic_io, &list);
+        if (ret == -1 && ifindex > 0 && errno == ENODEV)
+            ret = 0;
+        close(sock);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (sock == -1) {
+        psutil_oserror_wsyscall("socket(AF_NETLINK)");
+        goto error;
+    }
+    if (ret == -1) {
+        psutil_oserror_wsyscall("RTM_GETLINK");
+        goto error;
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < list.count; i++) {
+        item = &list.items[i];
+        if (!pylist_append_fmt(
+                py_retlist,
+                "(sKKKKKKKK)",
+                item->name,
+                item->counters[0],
+                item->counters[1],
+                item->counters[2],
+                item->counters[3],
+                item->counters[4],
+                item->counters[5],
+                item->counters[6],
+                item->counters[7]
+            ))
             goto error;
+    }
+
+    free(list.items);
+    return py_retlist;
+
+error:
+    free(list.items);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+struct nic_stats {
+    int ifindex;
+    char name[IFNAMSIZ];
+    unsigned int flags;
+    unsigned int mtu;
+    int duplex;
+    int speed;
+};
+
+struct nic_stats_list {
+    struct nic_stats *items;
+    size_t count;
+    size_t capacity;
+};
+
+
+static int
+collect_nic_stats(struct nlmsghdr *nlh, void *arg) {
+    struct nic_stats_list *list = arg;
+    struct nic_stats *item;
+    struct link_info info;
+
+    if (!parse_link(nlh, &info))
+        return 0;
+    if (array_reserve(
+            (void **)&list->items,
+            &list->capacity,
+            list->count,
+            sizeof(*list->items)
+        )
+        == -1)
+        return -1;
+
+    item = &list->items[list->count++];
+    item->ifindex = info.ifindex;
+    strncpy(item->name, info.name, sizeof(item->name) - 1);
+    item->name[sizeof(item->name) - 1] = '\0';
+    // Same as what SIOCGIFFLAGS returns (dev_get_flags()), which only
+    // has room for 16 bits.
+    item->flags = info.flags & 0xFFFF;
+    item->mtu = info.mtu;
+    item->duplex = DUPLEX_UNKNOWN;
+    item->speed = 0;
+    return 0;
+}
+
+
+static int
+cmp_nic_stats(const void *a, const void *b) {
+    int x = ((const struct nic_stats *)a)->ifindex;
+    int y = ((const struct nic_stats *)b)->ifindex;
+    return (x > y) - (x < y);
+}
+
+
+#ifdef PSUTIL_HAS_ETHTOOL_NETLINK
+
+// Generic netlink attributes follow the genlmsghdr.
+#define GENL_RTA(nlh) \
+    ((struct rtattr *)((char *)NLMSG_DATA(nlh) + GENL_HDRLEN))
+#define GENL_RTA_LEN(nlh) ((int)(nlh)->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN))
+
+
+static int
+collect_genl_family_id(struct nlmsghdr *nlh, void *arg) {
+    struct rtattr *rta;
+    int len = GENL_RTA_LEN(nlh);
+
+    for (rta = GENL_RTA(nlh); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if ((rta->rta_type & NLA_TYPE_MASK) == CTRL_ATTR_FAMILY_ID
+            && RTA_PAYLOAD(rta) >= sizeof(__u16))
+        {
+            memcpy(arg, RTA_DATA(rta), sizeof(__u16));
         }
     }
+    return 0;
+}
 
-    py_retlist = Py_BuildValue("[ii]", duplex, speed);
-    if (!py_retlist)
-        goto error;
+
+// Resolve the id of the "ethtool" generic netlink family. Return 0 if
+// it doesn't exist (kernel < 5.6 or CONFIG_ETHTOOL_NETLINK not set).
+static int
+ethtool_genl_family_id(int sock) {
+    __u16 family_id = 0;
+    struct rtattr *rta;
+    struct {
+        struct nlmsghdr nlh;
+        struct genlmsghdr genl;
+        char attrbuf[RTA_SPACE(sizeof(ETHTOOL_GENL_NAME))];
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_type = GENL_ID_CTRL;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST;
+    req.nlh.nlmsg_seq = 2;
+    req.genl.cmd = CTRL_CMD_GETFAMILY;
+    req.genl.version = 1;
+    rta = (struct rtattr *)req.attrbuf;
+    rta->rta_type = CTRL_ATTR_FAMILY_NAME;
+    rta->rta_len = RTA_LENGTH(sizeof(ETHTOOL_GENL_NAME));
+    memcpy(RTA_DATA(rta), ETHTOOL_GENL_NAME, sizeof(ETHTOOL_GENL_NAME));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN) + RTA_ALIGN(rta->rta_len);
+
+    if (nl_request(sock, &req.nlh, collect_genl_family_id, &family_id)
+        == -1)
+        return 0;
+    return family_id;
+}
+
+
+static int
+collect_linkmodes(struct nlmsghdr *nlh, void *arg) {
+    struct nic_stats_list *list = arg;
+    struct nic_stats key;
+    struct nic_stats *item;
+    struct rtattr *rta;
+    struct rtattr *nested;
+    int len = GENL_RTA_LEN(nlh);
+    int nlen;
+    int has_ifindex = 0;
+    __u32 speed = 0;
+    __u8 duplex = DUPLEX_UNKNOWN;
+
+    for (rta = GENL_RTA(nlh); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        switch (rta->rta_type & NLA_TYPE_MASK) {
+            case ETHTOOL_A_LINKMODES_HEADER:
+                nlen = RTA_PAYLOAD(rta);
+                for (nested = RTA_DATA(rta); RTA_OK(nested, nlen);
+                     nested = RTA_NEXT(nested, nlen))
+                {
+                    if ((nested->rta_type & NLA_TYPE_MASK)
+                            == ETHTOOL_A_HEADER_DEV_INDEX
+                        && RTA_PAYLOAD(nested) >= sizeof(__u32))
+                    {
+                        memcpy(&key.ifindex, RTA_DATA(nested), sizeof(__u32));
+                        has_ifindex = 1;
+                    }
+                }
+                break;
+            case ETHTOOL_A_LINKMODES_SPEED:
+                if (RTA_PAYLOAD(rta) >= sizeof(speed))
+                    memcpy(&speed, RTA_DATA(rta), sizeof(speed));
+                break;
+            case ETHTOOL_A_LINKMODES_DUPLEX:
+                if (RTA_PAYLOAD(rta) >= sizeof(duplex))
+                    memcpy(&duplex, RTA_DATA(rta), sizeof(duplex));
+                break;
+        }
+    }
+
+    if (!has_ifindex)
+        return 0;
+    item = bsearch(
+        &key, list->items, list->count, sizeof(*list->items), cmp_nic_stats
+    );
+    if (item == NULL)  // appeared after the RTM_GETLINK dump
+        return 0;
+    item->duplex = duplex;
+    // SPEED_UNKNOWN is (u32)-1
+    item->speed = speed > INT_MAX ? 0 : (int)speed;
+    return 0;
+}
+
+
+// Get duplex and speed of all NICs with a single ethtool netlink
+// ETHTOOL_MSG_LINKMODES_GET dump. NICs which don't support it are
+// skipped by the kernel, and keep DUPLEX_UNKNOWN and speed 0. Return
+// -1 if ethtool netlink is not available.
+static int
+ethtool_nl_duplex_speed(struct nic_stats_list *list) {
+    int sock;
+    int ret = -1;
+    int family_id;
+    struct rtattr *hdr;
+    struct rtattr *rta;
+    __u32 flags = ETHTOOL_FLAG_COMPACT_BITSETS;
+    struct {
+        struct nlmsghdr nlh;
+        struct genlmsghdr genl;
+        char attrbuf[RTA_SPACE(RTA_SPACE(sizeof(__u32)))];
+    } req;
+
+    sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (sock == -1)
+        return -1;
+    family_id = ethtool_genl_family_id(sock);
+    if (family_id == 0)
+        goto out;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_type = family_id;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = 3;
+    req.genl.cmd = ETHTOOL_MSG_LINKMODES_GET;
+    req.genl.version = ETHTOOL_GENL_VERSION;
+    // Compact bitsets make the (unused) link modes part of the reply
+    // a lot smaller.
+    hdr = (struct rtattr *)req.attrbuf;
+    hdr->rta_type = ETHTOOL_A_LINKMODES_HEADER | NLA_F_NESTED;
+    hdr->rta_len = RTA_LENGTH(RTA_SPACE(sizeof(flags)));
+    rta = RTA_DATA(hdr);
+    rta->rta_type = ETHTOOL_A_HEADER_FLAGS;
+    rta->rta_len = RTA_LENGTH(sizeof(flags));
+    memcpy(RTA_DATA(rta), &flags, sizeof(flags));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN) + RTA_ALIGN(hdr->rta_len);
+
+    ret = nl_request(sock, &req.nlh, collect_linkmodes, list);
+
+out:
     close(sock);
+    return ret;
+}
+
+#endif  // PSUTIL_HAS_ETHTOOL_NETLINK
+
+
+// Return (name, flags, mtu, duplex, speed) of all NICs at once. Names,
+// flags and MTU come from a single rtnetlink RTM_GETLINK dump, duplex
+// and speed from a single ethtool netlink ETHTOOL_MSG_LINKMODES_GET
+// dump. On kernels < 5.6 the latter falls back on one SIOCETHTOOL
+// ioctl per NIC, all through the same socket.
+PyObject *
+psutil_net_if_stats_netlink(PyObject *self, PyObject *args) {
+    int sock;
+    int ret = 0;
+    int ethtool_ret = -1;
+    const char *syscall = "RTM_GETLINK";
+    struct nic_stats *item;
+    struct nic_stats_list list;
+    PyObject *py_flags = NULL;
+    PyObject *py_retlist = NULL;
+
+    memset(&list, 0, sizeof(list));
+
+    Py_BEGIN_ALLOW_THREADS
+    sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (sock != -1) {
+        ret = rtnl_getlink(sock, 0, collect_nic_stats, &list);
+        close(sock);
+    }
+    if (sock != -1 && ret == 0) {
+        qsort(list.items, list.count, sizeof(*list.items), cmp_nic_stats);
+#ifdef PSUTIL_HAS_ETHTOOL_NETLINK
+        ethtool_ret = ethtool_nl_duplex_speed(&list);
+#endif
+        if (ethtool_ret == -1) {
+            syscall = "ioctl(SIOCETHTOOL)";
+            sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            for (size_t i = 0; sock != -1 && i < list.count; i++) {
+                item = &list.items[i];
+                ret = ethtool_ioctl_duplex_speed(
+                    sock, item->name, &item->duplex, &item->speed
+                );
+                // The NIC went away in the meantime.
+                if (ret == -1 && errno == ENODEV)
+                    ret = 0;
+                if (ret == -1)
+                    break;
+            }
+            if (sock != -1)
+                close(sock);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (sock == -1) {
+        psutil_oserror_wsyscall("socket()");
+        goto error;
+    }
+    if (ret == -1) {
+        psutil_oserror_wsyscall(syscall);
+        goto error;
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < list.count; i++) {
+        item = &list.items[i];
+        py_flags = PyList_New(0);
+        if (py_flags == NULL)
+            goto error;
+        if (!psutil_net_if_flags_append(py_flags, item->flags))
+            goto error;
+        if (!pylist_append_fmt(
+                py_retlist,
+                "(sOIii)",
+                item->name,
+                py_flags,
+                item->mtu,
+                item->duplex,
+                item->speed
+            ))
+            goto error;
+        Py_CLEAR(py_flags);
+    }
+
+    free(list.items);
     return py_retlist;
 
 error:
-    if (sock != -1)
-        close(sock);
+    free(list.items);
+    Py_XDECREF(py_flags);
+    Py_XDECREF(py_retlist);
     return NULL;
 }
+
+
+// Open a non-blocking rtnetlink socket subscribed to the notifications
+// the kernel sends when a NIC or one of its IPv4 / IPv6 addresses is
+// added, removed or changed. Return its fd, to be passed to
+// psutil_net_if_notify_drain().
+PyObject *
+psutil_net_if_notify_open(PyObject *self, PyObject *args) {
+    int sock;
+    struct sockaddr_nl sa;
+
+    sock = socket(
+        AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE
+    );
+    if (sock == -1)
+        return psutil_oserror_wsyscall("socket(AF_NETLINK)");
+
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(sock, (struct sockaddr *)&sa, sizeof(sa)) == -1) {
+        psutil_oserror_wsyscall("bind(AF_NETLINK)");
+        close(sock);
+        return NULL;
+    }
+    return Py_BuildValue("i", sock);
+}
+
+
+// Read all the notifications queued on a socket returned by
+// psutil_net_if_notify_open(), without blocking. Return True if there
+// was at least one (something changed), False otherwise. If the
+// socket buffer overflowed some notifications were lost, which also
+// counts as a change.
+PyObject *
+psutil_net_if_notify_drain(PyObject *self, PyObject *args) {
+    int sock;
+    int changed = 0;
+    ssize_t nbytes;
+    char buf[8192];
+
+    if (!PyArg_ParseTuple(args, "i", &sock))
+        return NULL;
+
+    for (;;) {
+        nbytes = recv(sock, buf, sizeof(buf), MSG_DONTWAIT);
+        if (nbytes > 0) {
+            changed = 1;
+            continue;
+        }
+        if (nbytes == 0)
+            break;
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        if (errno == ENOBUFS) {
+            changed = 1;
+            continue;
+        }
+        return psutil_oserror_wsyscall("recv(NETLINK_ROUTE)");
+    }
+    return PyBool_FromLong(changed);
+}
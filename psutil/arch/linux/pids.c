@@ -0,0 +1,1320 @@
+/*
+ * Copyright (c) 2009, Giampaolo Rodola'. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// Functions scanning all the PIDs in /proc in one go. /proc is read
+// with getdents64() into a buffer reused for the whole scan, and
+// per-PID files are opened relative to the /proc directory fd, so
+// that the kernel resolves the procfs path only once.
+
+#include <Python.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../../arch/all/init.h"
+
+#define GETDENTS_BUFSIZE (32 * 1024)
+
+// glibc only exposes getdents64() since 2.30, and musl with a
+// different struct name.
+struct linux_dirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct pid_array {
+    pid_t *items;
+    size_t count;
+    size_t capacity;
+};
+
+struct proc_entry {
+    int pid;
+    int ppid;
+    unsigned long long starttime;  // clock ticks since boot
+    char state;
+    int status;  // PSUTIL_ROW_*
+    char name[64];
+};
+
+struct proc_list {
+    struct proc_entry *items;
+    size_t count;
+    size_t capacity;
+};
+
+
+// Parse a decimal PID out of a /proc entry name. Return 0 if the name
+// is not a PID (".", "self", "sys", ...).
+static pid_t
+parse_pid(const char *name) {
+    long pid = 0;
+
+    if (*name == '\0')
+        return 0;
+    for (; *name != '\0'; name++) {
+        if (*name < '0' || *name > '9')
+            return 0;
+        pid = pid * 10 + (*name - '0');
+        if (pid > INT_MAX)
+            return 0;
+    }
+    return (pid_t)pid;
+}
+
+
+// List the PIDs in the procfs directory `procfd` into `pids`. Return
+// 0 on success, -1 on error with errno set.
+static int
+list_pids(int procfd, struct pid_array *pids) {
+    char *buf;
+    pid_t *tmp;
+    pid_t pid;
+    long nread;
+    long pos;
+    struct linux_dirent64 *de;
+
+    buf = malloc(GETDENTS_BUFSIZE);
+    if (buf == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (;;) {
+        nread = syscall(SYS_getdents64, procfd, buf, GETDENTS_BUFSIZE);
+        if (nread == -1) {
+            free(buf);
+            return -1;
+        }
+        if (nread == 0)
+            break;
+        for (pos = 0; pos < nread; pos += de->d_reclen) {
+            de = (struct linux_dirent64 *)(buf + pos);
+            pid = parse_pid(de->d_name);
+            if (pid == 0)
+                continue;
+            if (pids->count == pids->capacity) {
+                pids->capacity = pids->capacity ? pids->capacity * 2 : 512;
+                tmp = realloc(pids->items, pids->capacity * sizeof(*tmp));
+                if (tmp == NULL) {
+                    free(buf);
+                    errno = ENOMEM;
+                    return -1;
+                }
+                pids->items = tmp;
+            }
+            pids->items[pids->count++] = pid;
+        }
+    }
+    free(buf);
+    return 0;
+}
+
+
+// Open `procfs` and list its PIDs. Return the directory fd, or -1 on
+// error with errno set.
+static int
+open_and_list_pids(const char *procfs, struct pid_array *pids) {
+    int procfd;
+    int saved_errno;
+
+    procfd = psutil_open_dir(procfs);
+    if (procfd == -1)
+        return -1;
+    if (list_pids(procfd, pids) == -1) {
+        saved_errno = errno;
+        close(procfd);
+        errno = saved_errno;
+        return -1;
+    }
+    return procfd;
+}
+
+
+// Raise the exception matching a failure to read `procfs`.
+static PyObject *
+raise_procfs_error(int err, const char *procfs) {
+    if (err == ENOMEM)
+        return PyErr_NoMemory();
+    errno = err;
+    return PyErr_SetFromErrnoWithFilename(PyExc_OSError, procfs);
+}
+
+
+// Map the errno of a failed per-PID read to a PSUTIL_ROW_* status.
+// Anything but a permission error means the process is gone (or is
+// going away), as the PID was listed in /proc just before.
+static int
+row_status(int err) {
+    if (err == EACCES || err == EPERM)
+        return PSUTIL_ROW_DENIED;
+    return PSUTIL_ROW_GONE;
+}
+
+
+// Return the next free slot of `list`, or NULL on ENOMEM.
+static struct proc_entry *
+proc_list_next(struct proc_list *list) {
+    struct proc_entry *tmp;
+
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 512;
+        tmp = realloc(list->items, list->capacity * sizeof(*tmp));
+        if (tmp == NULL)
+            return NULL;
+        list->items = tmp;
+    }
+    return &list->items[list->count];
+}
+
+
+// Parse the name, state, ppid and starttime out of a /proc/<pid>/stat
+// line.
+// The name is between parentheses and can contain spaces and
+// parentheses itself, hence the last ")" is what ends it.
+static int
+parse_stat(char *buf, struct proc_entry *entry) {
+    char *lpar;
+    char *rpar;
+    char *field;
+    char *saveptr;
+    size_t len;
+    int i;
+
+    lpar = strchr(buf, '(');
+    rpar = strrchr(buf, ')');
+    if (lpar == NULL || rpar == NULL || rpar < lpar)
+        return -1;
+    len = (size_t)(rpar - lpar - 1);
+    if (len >= sizeof(entry->name))
+        len = sizeof(entry->name) - 1;
+    memcpy(entry->name, lpar + 1, len);
+    entry->name[len] = '\0';
+
+    // Same indexes as in _pslinux.Process._parse_stat_file().
+    field = strtok_r(rpar + 1, " ", &saveptr);
+    for (i = 0; field != NULL && i <= 19; i++) {
+        if (i == 0)
+            entry->state = field[0];
+        else if (i == 1)
+            entry->ppid = atoi(field);
+        else if (i == 19)
+            entry->starttime = strtoull(field, NULL, 10);
+        field = strtok_r(NULL, " ", &saveptr);
+    }
+    return i > 19 ? 0 : -1;
+}
+
+
+// Parse the ppid out of a /proc/<pid>/stat line, which comes right
+// after the ") <state> " part. Return -1 if the line is malformed.
+static int
+parse_ppid(const char *buf) {
+    const char *ptr;
+    int ppid = 0;
+
+    ptr = strrchr(buf, ')');
+    if (ptr == NULL || ptr[1] != ' ' || ptr[2] == '\0' || ptr[3] != ' ')
+        return -1;
+    ptr += 4;
+    if (*ptr < '0' || *ptr > '9')
+        return -1;
+    for (; *ptr >= '0' && *ptr <= '9'; ptr++)
+        ppid = ppid * 10 + (*ptr - '0');
+    return ppid;
+}
+
+
+// Return the list of PIDs in /proc.
+PyObject *
+psutil_pids(PyObject *self, PyObject *args) {
+    char *procfs;
+    int procfd;
+    int saved_errno = 0;
+    struct pid_array pids = {NULL, 0, 0};
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &procfs))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    procfd = open_and_list_pids(procfs, &pids);
+    if (procfd == -1)
+        saved_errno = errno;
+    else
+        close(procfd);
+    Py_END_ALLOW_THREADS
+
+    if (saved_errno != 0) {
+        free(pids.items);
+        return raise_procfs_error(saved_errno, procfs);
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < pids.count; i++) {
+        if (!pylist_append_fmt(py_retlist, _Py_PARSE_PID, pids.items[i]))
+            goto error;
+    }
+    free(pids.items);
+    return py_retlist;
+
+error:
+    free(pids.items);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// Return a {pid: ppid} dict for all processes, reading
+// /proc/<pid>/stat of each one of them with the GIL released.
+// Processes which disappear in the meantime are skipped. If a stat
+// file can't be read because of permissions raise PermissionError.
+PyObject *
+psutil_ppid_map(PyObject *self, PyObject *args) {
+    char *procfs;
+    char path[PATH_MAX];
+    char buf[1024];
+    int procfd;
+    int saved_errno = 0;
+    int *ppids = NULL;
+    struct pid_array pids = {NULL, 0, 0};
+    PyObject *py_pid = NULL;
+    PyObject *py_ppid = NULL;
+    PyObject *py_retdict = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &procfs))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    procfd = open_and_list_pids(procfs, &pids);
+    if (procfd == -1) {
+        saved_errno = errno;
+    }
+    else {
+        ppids = malloc((pids.count + 1) * sizeof(*ppids));
+        if (ppids == NULL)
+            saved_errno = ENOMEM;
+        for (size_t i = 0; ppids != NULL && i < pids.count; i++) {
+            snprintf(path, sizeof(path), "%d/stat", (int)pids.items[i]);
+            ppids[i] = -1;
+            if (psutil_read_at(procfd, path, buf, sizeof(buf)) > 0) {
+                ppids[i] = parse_ppid(buf);
+            }
+            else if (errno == EACCES || errno == EPERM) {
+                saved_errno = errno;
+                snprintf(path, sizeof(path), "%s/%d/stat", procfs,
+                         (int)pids.items[i]);
+                break;
+            }
+        }
+        close(procfd);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (saved_errno != 0) {
+        free(pids.items);
+        free(ppids);
+        if (saved_errno == EACCES || saved_errno == EPERM)
+            return raise_procfs_error(saved_errno, path);
+        return raise_procfs_error(saved_errno, procfs);
+    }
+
+    py_retdict = PyDict_New();
+    if (py_retdict == NULL)
+        goto error;
+    for (size_t i = 0; i < pids.count; i++) {
+        if (ppids[i] == -1)
+            continue;  // gone
+        py_pid = PyLong_FromLong((long)pids.items[i]);
+        if (py_pid == NULL)
+            goto error;
+        py_ppid = PyLong_FromLong((long)ppids[i]);
+        if (py_ppid == NULL)
+            goto error;
+        if (PyDict_SetItem(py_retdict, py_pid, py_ppid))
+            goto error;
+        Py_CLEAR(py_pid);
+        Py_CLEAR(py_ppid);
+    }
+    free(pids.items);
+    free(ppids);
+    return py_retdict;
+
+error:
+    free(pids.items);
+    free(ppids);
+    Py_XDECREF(py_pid);
+    Py_XDECREF(py_ppid);
+    Py_XDECREF(py_retdict);
+    return NULL;
+}
+
+
+// Return a list of (pid, ppid, starttime, name, status) tuples for
+// all processes, reading /proc/<pid>/stat of each one of them with the
+// GIL released. `starttime` is in clock ticks since boot. `status` is
+// one of the ROW_* constants: processes which disappear in the
+// meantime are skipped, the ones whose stat file can't be read are
+// reported as ROW_DENIED (with ppid -1, starttime 0 and no name), so
+// that none of this costs a Python exception.
+PyObject *
+psutil_proc_stat_scan(PyObject *self, PyObject *args) {
+    char *procfs;
+    char path[64];
+    char buf[1024];
+    int procfd;
+    int saved_errno = 0;
+    ssize_t nbytes;
+    struct proc_entry *entry;
+    struct proc_list list = {NULL, 0, 0};
+    struct pid_array pids = {NULL, 0, 0};
+    PyObject *py_name = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &procfs))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    procfd = open_and_list_pids(procfs, &pids);
+    if (procfd == -1) {
+        saved_errno = errno;
+    }
+    else {
+        for (size_t i = 0; i < pids.count; i++) {
+            entry = proc_list_next(&list);
+            if (entry == NULL) {
+                saved_errno = ENOMEM;
+                break;
+            }
+            snprintf(path, sizeof(path), "%d/stat", (int)pids.items[i]);
+            entry->pid = (int)pids.items[i];
+            nbytes = psutil_read_at(procfd, path, buf, sizeof(buf));
+            if (nbytes <= 0) {
+                entry->status = nbytes == 0 ? PSUTIL_ROW_GONE
+                                            : row_status(errno);
+                if (entry->status == PSUTIL_ROW_GONE)
+                    continue;
+                entry->ppid = -1;
+                entry->starttime = 0;
+                entry->name[0] = '\0';
+                list.count++;
+                continue;
+            }
+            if (parse_stat(buf, entry) != 0)
+                continue;  // malformed
+            if (entry->state == 'Z')
+                entry->status = PSUTIL_ROW_ZOMBIE;
+            else
+                entry->status = PSUTIL_ROW_OK;
+            list.count++;
+        }
+        close(procfd);
+    }
+    Py_END_ALLOW_THREADS
+
+    free(pids.items);
+    if (saved_errno != 0) {
+        free(list.items);
+        return raise_procfs_error(saved_errno, procfs);
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < list.count; i++) {
+        entry = &list.items[i];
+        py_name = PyUnicode_DecodeFSDefault(entry->name);
+        if (py_name == NULL)
+            goto error;
+        if (!pylist_append_fmt(
+                py_retlist,
+                "(iiKOi)",
+                entry->pid,
+                entry->ppid,
+                entry->starttime,
+                py_name,
+                entry->status
+            ))
+            goto error;
+        Py_CLEAR(py_name);
+    }
+    free(list.items);
+    return py_retlist;
+
+error:
+    free(list.items);
+    Py_XDECREF(py_name);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// Filters evaluated by psutil_proc_filter_scan(). Unset ones are -1 /
+// NULL / 0.
+struct proc_filter {
+    long *uids;  // real UIDs
+    size_t nuids;
+    int ppid;
+    const char *states;  // /proc/<pid>/stat state letters
+    unsigned long long min_rss;  // pages
+    int no_kthreads;
+};
+
+#define PF_KTHREAD 0x00200000
+
+
+// Return 1 if the /proc/<pid>/stat line in `buf` matches `flt`, 0 if
+// it does not and -1 if the line is malformed. The name and ppid are
+// stored in `entry`.
+static int
+match_stat(
+    char *buf, const struct proc_filter *flt, struct proc_entry *entry
+) {
+    char *lpar;
+    char *rpar;
+    char *field;
+    char *saveptr;
+    char state = '\0';
+    unsigned long flags = 0;
+    unsigned long long rss = 0;
+    size_t len;
+    int i;
+
+    lpar = strchr(buf, '(');
+    rpar = strrchr(buf, ')');
+    if (lpar == NULL || rpar == NULL || rpar < lpar)
+        return -1;
+    len = (size_t)(rpar - lpar - 1);
+    if (len >= sizeof(entry->name))
+        len = sizeof(entry->name) - 1;
+    memcpy(entry->name, lpar + 1, len);
+    entry->name[len] = '\0';
+
+    // Same indexes as in _pslinux.Process._parse_stat_file().
+    field = strtok_r(rpar + 1, " ", &saveptr);
+    for (i = 0; field != NULL && i <= 21; i++) {
+        if (i == 0)
+            state = field[0];
+        else if (i == 1)
+            entry->ppid = atoi(field);
+        else if (i == 6)
+            flags = strtoul(field, NULL, 10);
+        else if (i == 21)
+            rss = strtoull(field, NULL, 10);
+        field = strtok_r(NULL, " ", &saveptr);
+    }
+    if (i <= 21)
+        return -1;
+
+    if (flt->ppid != -1 && entry->ppid != flt->ppid)
+        return 0;
+    if (flt->states != NULL && strchr(flt->states, state) == NULL)
+        return 0;
+    if (flt->no_kthreads && (flags & PF_KTHREAD))
+        return 0;
+    if (rss < flt->min_rss)
+        return 0;
+    return 1;
+}
+
+
+// Return 1 if the real UID in the /proc/<pid>/status content in `buf`
+// is one of `flt->uids`, else 0.
+static int
+match_status(const char *buf, const struct proc_filter *flt) {
+    const char *ptr;
+    long uid;
+
+    ptr = strstr(buf, "\nUid:");
+    if (ptr == NULL)
+        return 0;
+    uid = strtol(ptr + 5, NULL, 10);
+    for (size_t i = 0; i < flt->nuids; i++) {
+        if (flt->uids[i] == uid)
+            return 1;
+    }
+    return 0;
+}
+
+
+// Return a list of (pid, ppid, name) tuples for the processes matching
+// the given filters, evaluated on the raw /proc/<pid>/stat (and, if
+// `uids` is given, /proc/<pid>/status) content with the GIL released.
+// Arguments are: procfs path, sequence of real UIDs or None, ppid or
+// -1, string of stat state letters or None, min RSS in pages, whether
+// to exclude kernel threads. Processes which disappear in the
+// meantime or can't be read are skipped.
+PyObject *
+psutil_proc_filter_scan(PyObject *self, PyObject *args) {
+    char *procfs;
+    char path[64];
+    char buf[1024];
+    int procfd;
+    int saved_errno = 0;
+    int ret;
+    Py_ssize_t nuids;
+    struct proc_filter flt = {NULL, 0, -1, NULL, 0, 0};
+    struct proc_entry *entry;
+    struct proc_list list = {NULL, 0, 0};
+    struct pid_array pids = {NULL, 0, 0};
+    PyObject *py_uids;
+    PyObject *py_item = NULL;
+    PyObject *py_name = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(
+            args,
+            "sOizKp",
+            &procfs,
+            &py_uids,
+            &flt.ppid,
+            &flt.states,
+            &flt.min_rss,
+            &flt.no_kthreads
+        ))
+        return NULL;
+
+    if (py_uids != Py_None) {
+        nuids = PySequence_Size(py_uids);
+        if (nuids == -1)
+            return NULL;
+        flt.uids = malloc((nuids + 1) * sizeof(*flt.uids));
+        if (flt.uids == NULL)
+            return PyErr_NoMemory();
+        for (Py_ssize_t i = 0; i < nuids; i++) {
+            py_item = PySequence_GetItem(py_uids, i);
+            if (py_item == NULL)
+                goto error;
+            flt.uids[i] = PyLong_AsLong(py_item);
+            Py_CLEAR(py_item);
+            if (flt.uids[i] == -1 && PyErr_Occurred())
+                goto error;
+        }
+        flt.nuids = (size_t)nuids;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    procfd = open_and_list_pids(procfs, &pids);
+    if (procfd == -1) {
+        saved_errno = errno;
+    }
+    else {
+        for (size_t i = 0; i < pids.count; i++) {
+            entry = proc_list_next(&list);
+            if (entry == NULL) {
+                saved_errno = ENOMEM;
+                break;
+            }
+            snprintf(path, sizeof(path), "%d/stat", (int)pids.items[i]);
+            if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+                continue;  // gone
+            ret = match_stat(buf, &flt, entry);
+            if (ret != 1)
+                continue;
+            if (flt.uids != NULL) {
+                snprintf(
+                    path, sizeof(path), "%d/status", (int)pids.items[i]
+                );
+                if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+                    continue;  // gone
+                if (!match_status(buf, &flt))
+                    continue;
+            }
+            entry->pid = (int)pids.items[i];
+            list.count++;
+        }
+        close(procfd);
+    }
+    Py_END_ALLOW_THREADS
+
+    free(pids.items);
+    free(flt.uids);
+    flt.uids = NULL;
+    if (saved_errno != 0) {
+        free(list.items);
+        return raise_procfs_error(saved_errno, procfs);
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < list.count; i++) {
+        entry = &list.items[i];
+        py_name = PyUnicode_DecodeFSDefault(entry->name);
+        if (py_name == NULL)
+            goto error;
+        if (!pylist_append_fmt(
+                py_retlist, "(iiO)", entry->pid, entry->ppid, py_name
+            ))
+            goto error;
+        Py_CLEAR(py_name);
+    }
+    free(list.items);
+    return py_retlist;
+
+error:
+    free(flt.uids);
+    free(list.items);
+    Py_XDECREF(py_item);
+    Py_XDECREF(py_name);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// --- top-N
+
+// Metrics supported by psutil_proc_top(), in the unit returned to
+// Python.
+enum {
+    TOP_RSS,  // bytes
+    TOP_CPU,  // utime + stime, in clock ticks
+    TOP_IO,  // read_bytes + write_bytes
+    TOP_NUM_FDS,
+    TOP_SWAP,  // bytes
+};
+
+static const char *top_metrics[] = {"rss", "cpu", "io", "num_fds", "swap"};
+
+struct top_sample {
+    int pid;
+    unsigned long long starttime;  // tells reused PIDs apart
+    unsigned long long value;
+};
+
+
+// Parse starttime, utime + stime and rss out of a /proc/<pid>/stat
+// line. Return -1 if the line is malformed.
+static int
+parse_stat_top(
+    char *buf,
+    unsigned long long *starttime,
+    unsigned long long *cpu,
+    unsigned long long *rss
+) {
+    char *rpar;
+    char *field;
+    char *saveptr;
+    int i;
+
+    rpar = strrchr(buf, ')');
+    if (rpar == NULL)
+        return -1;
+    *cpu = 0;
+    *rss = 0;
+    // Same indexes as in _pslinux.Process._parse_stat_file().
+    field = strtok_r(rpar + 1, " ", &saveptr);
+    for (i = 0; field != NULL && i <= 21; i++) {
+        if (i == 11 || i == 12)
+            *cpu += strtoull(field, NULL, 10);
+        else if (i == 19)
+            *starttime = strtoull(field, NULL, 10);
+        else if (i == 21)
+            *rss = strtoull(field, NULL, 10);
+        field = strtok_r(NULL, " ", &saveptr);
+    }
+    return i > 21 ? 0 : -1;
+}
+
+
+// Return the value of "<key> <number>" in `buf`, or 0 if not found.
+static unsigned long long
+parse_key(const char *buf, const char *key) {
+    const char *ptr;
+
+    ptr = strstr(buf, key);
+    if (ptr == NULL)
+        return 0;
+    return strtoull(ptr + strlen(key), NULL, 10);
+}
+
+
+// Compute the `metric` value of `pid` into `sample`. Return -1 if the
+// process is gone or can't be inspected.
+static int
+sample_pid(
+    int procfd,
+    const char *procfs,
+    pid_t pid,
+    int metric,
+    long pagesize,
+    struct top_sample *sample
+) {
+    char path[PATH_MAX];
+    char buf[4096];
+    unsigned long long cpu;
+    unsigned long long rss;
+    long nfds;
+
+    snprintf(path, sizeof(path), "%d/stat", (int)pid);
+    if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+        return -1;
+    if (parse_stat_top(buf, &sample->starttime, &cpu, &rss) != 0)
+        return -1;
+    sample->pid = (int)pid;
+
+    if (metric == TOP_RSS) {
+        sample->value = rss * (unsigned long long)pagesize;
+    }
+    else if (metric == TOP_CPU) {
+        sample->value = cpu;
+    }
+    else if (metric == TOP_IO) {
+        snprintf(path, sizeof(path), "%d/io", (int)pid);
+        if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+            return -1;
+        sample->value = parse_key(buf, "\nread_bytes:")
+                        + parse_key(buf, "\nwrite_bytes:");
+    }
+    else if (metric == TOP_NUM_FDS) {
+        snprintf(path, sizeof(path), "%s/%d/fd", procfs, (int)pid);
+        nfds = psutil_count_fds(path, pid);
+        if (nfds == -1)
+            return -1;
+        sample->value = (unsigned long long)nfds;
+    }
+    else {  // TOP_SWAP
+        snprintf(path, sizeof(path), "%d/status", (int)pid);
+        if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+            return -1;
+        sample->value = parse_key(buf, "\nVmSwap:") * 1024;
+    }
+    return 0;
+}
+
+
+static int
+cmp_sample_pid(const void *a, const void *b) {
+    const struct top_sample *x = a;
+    const struct top_sample *y = b;
+
+    return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+
+// Restore the min-heap property of `heap` (ordered by value) from
+// index `i` downwards.
+static void
+heap_sift_down(struct top_sample *heap, size_t count, size_t i) {
+    size_t child;
+    struct top_sample tmp;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= count)
+            return;
+        if (child + 1 < count && heap[child + 1].value < heap[child].value)
+            child++;
+        if (heap[i].value <= heap[child].value)
+            return;
+        tmp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = tmp;
+        i = child;
+    }
+}
+
+
+// Push `sample` into the min-heap `heap` holding at most `n` items,
+// keeping the largest values seen so far.
+static void
+heap_push(
+    struct top_sample *heap,
+    size_t *count,
+    size_t n,
+    const struct top_sample *sample
+) {
+    size_t i;
+    size_t parent;
+    struct top_sample tmp;
+
+    if (*count < n) {
+        i = (*count)++;
+        heap[i] = *sample;
+        while (i > 0) {
+            parent = (i - 1) / 2;
+            if (heap[parent].value <= heap[i].value)
+                break;
+            tmp = heap[i];
+            heap[i] = heap[parent];
+            heap[parent] = tmp;
+            i = parent;
+        }
+    }
+    else if (n > 0 && sample->value > heap[0].value) {
+        heap[0] = *sample;
+        heap_sift_down(heap, *count, 0);
+    }
+}
+
+
+// Return the `n` processes with the highest `metric` value (one of
+// top_metrics) as a list of (pid, value, starttime) tuples sorted by
+// value in descending order. starttime (in clock ticks) lets the
+// caller tell whether the PID got reused after the scan. The selection
+// is done with a bounded heap during the scan, with the GIL released,
+// so no Python object is created for the other processes. Processes
+// which are gone or can't be inspected are skipped.
+//
+// If `prev` is not None it's the state returned by a previous call,
+// and values are the difference from it (for cumulative metrics such
+// as "cpu" and "io"). If `keep_state` is true, the return value is a
+// (list, state) tuple, where state is an opaque bytes object holding
+// the value of every process, to be passed as `prev` later on.
+PyObject *
+psutil_proc_top(PyObject *self, PyObject *args) {
+    char *procfs;
+    char *metric_name;
+    int n;
+    int metric = -1;
+    int keep_state;
+    int procfd;
+    int saved_errno = 0;
+    long pagesize;
+    char *prev_buf = NULL;
+    Py_ssize_t prev_size = 0;
+    size_t prev_count = 0;
+    size_t nsamples = 0;
+    size_t nheap = 0;
+    struct top_sample *prev = NULL;
+    struct top_sample *found;
+    struct top_sample *samples = NULL;
+    struct top_sample *heap = NULL;
+    struct top_sample sample;
+    struct pid_array pids = {NULL, 0, 0};
+    PyObject *py_prev;
+    PyObject *py_tuple;
+    PyObject *py_retlist = NULL;
+    PyObject *py_state = NULL;
+
+    if (!PyArg_ParseTuple(
+            args, "ssiOp", &procfs, &metric_name, &n, &py_prev, &keep_state
+        ))
+        return NULL;
+    for (size_t i = 0; i < sizeof(top_metrics) / sizeof(*top_metrics); i++) {
+        if (strcmp(metric_name, top_metrics[i]) == 0)
+            metric = (int)i;
+    }
+    if (metric == -1) {
+        PyErr_Format(PyExc_ValueError, "invalid metric %s", metric_name);
+        return NULL;
+    }
+    if (n < 0)
+        n = 0;
+    if (py_prev != Py_None) {
+        if (PyBytes_AsStringAndSize(py_prev, &prev_buf, &prev_size) == -1)
+            return NULL;
+        if (prev_size % sizeof(*prev) != 0) {
+            PyErr_SetString(PyExc_ValueError, "invalid state");
+            return NULL;
+        }
+        // `prev` points into a bytes object referenced by `args`,
+        // hence it stays alive while the GIL is released.
+        prev = (struct top_sample *)prev_buf;
+        prev_count = (size_t)prev_size / sizeof(*prev);
+    }
+    pagesize = sysconf(_SC_PAGESIZE);
+
+    Py_BEGIN_ALLOW_THREADS
+    procfd = open_and_list_pids(procfs, &pids);
+    if (procfd == -1) {
+        saved_errno = errno;
+    }
+    else {
+        if ((size_t)n > pids.count)
+            n = (int)pids.count;
+        heap = malloc(((size_t)n + 1) * sizeof(*heap));
+        if (keep_state)
+            samples = malloc((pids.count + 1) * sizeof(*samples));
+        if (heap == NULL || (keep_state && samples == NULL))
+            saved_errno = ENOMEM;
+        for (size_t i = 0; saved_errno == 0 && i < pids.count; i++) {
+            if (sample_pid(
+                    procfd, procfs, pids.items[i], metric, pagesize, &sample
+                )
+                != 0)
+                continue;  // gone or denied
+            if (keep_state)
+                samples[nsamples++] = sample;
+            if (prev != NULL) {
+                found = bsearch(
+                    &sample, prev, prev_count, sizeof(*prev), cmp_sample_pid
+                );
+                if (found != NULL && found->starttime == sample.starttime)
+                    sample.value = sample.value > found->value
+                                       ? sample.value - found->value
+                                       : 0;
+            }
+            heap_push(heap, &nheap, (size_t)n, &sample);
+        }
+        close(procfd);
+    }
+    Py_END_ALLOW_THREADS
+
+    free(pids.items);
+    if (saved_errno != 0) {
+        free(heap);
+        free(samples);
+        return raise_procfs_error(saved_errno, procfs);
+    }
+
+    // Pop the heap from the smallest value, filling the list from its
+    // end, so that it's sorted in descending order.
+    py_retlist = PyList_New((Py_ssize_t)nheap);
+    if (py_retlist == NULL)
+        goto error;
+    while (nheap > 0) {
+        sample = heap[0];
+        heap[0] = heap[--nheap];
+        heap_sift_down(heap, nheap, 0);
+        py_tuple = Py_BuildValue(
+            "(iKK)", sample.pid, sample.value, sample.starttime
+        );
+        if (py_tuple == NULL)
+            goto error;
+        if (PyList_SetItem(py_retlist, (Py_ssize_t)nheap, py_tuple))
+            goto error;
+    }
+    free(heap);
+    heap = NULL;
+
+    if (!keep_state)
+        return py_retlist;
+    qsort(samples, nsamples, sizeof(*samples), cmp_sample_pid);
+    py_state = PyBytes_FromStringAndSize(
+        (const char *)samples, (Py_ssize_t)(nsamples * sizeof(*samples))
+    );
+    free(samples);
+    samples = NULL;
+    if (py_state == NULL)
+        goto error;
+    return Py_BuildValue("(NN)", py_retlist, py_state);
+
+error:
+    free(heap);
+    free(samples);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// --- rollups
+
+enum {
+    GROUP_UID,
+    GROUP_CGROUP,
+    GROUP_NAME,
+};
+
+static const char *group_names[] = {"uid", "cgroup", "name"};
+
+struct rollup_entry {
+    char *key;  // cgroup path or name (malloc()ed), NULL for GROUP_UID
+    long uid;
+    unsigned long long count;
+    unsigned long long rss;  // bytes
+    unsigned long long pss;  // bytes
+    unsigned long long cpu;  // clock ticks
+    unsigned long long io;  // bytes
+    unsigned long long threads;
+    unsigned long long fds;
+};
+
+struct rollup_list {
+    struct rollup_entry *items;
+    size_t count;
+    size_t capacity;
+};
+
+
+// Return the path of the unified (v2) hierarchy out of a
+// /proc/<pid>/cgroup content, or of the first v1 hierarchy if there's
+// no unified one. The trailing newline is stripped in place.
+static char *
+parse_cgroup(char *buf) {
+    char *line;
+    char *path;
+    char *saveptr;
+    char *first = NULL;
+
+    for (line = strtok_r(buf, "\n", &saveptr); line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr))
+    {
+        // "<id>:<controllers>:<path>"
+        path = strchr(line, ':');
+        if (path == NULL || (path = strchr(path + 1, ':')) == NULL)
+            continue;
+        if (strncmp(line, "0::", 3) == 0)
+            return path + 1;
+        if (first == NULL)
+            first = path + 1;
+    }
+    return first;
+}
+
+
+// Fill `entry` with the metrics of `pid` and the key it is grouped
+// by. Return -1 if the process is gone, 0 on success or ENOMEM (with
+// `entry->key` NULL for a non GROUP_UID grouping).
+static int
+rollup_pid(
+    int procfd,
+    const char *procfs,
+    pid_t pid,
+    int group_by,
+    int want_pss,
+    long pagesize,
+    struct rollup_entry *entry
+) {
+    char path[PATH_MAX];
+    char buf[4096];
+    char *rpar;
+    char *field;
+    char *saveptr;
+    const char *key = NULL;
+    long nfds;
+    int i;
+
+    memset(entry, 0, sizeof(*entry));
+    entry->count = 1;
+    snprintf(path, sizeof(path), "%d/stat", (int)pid);
+    if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+        return -1;
+    rpar = strrchr(buf, ')');
+    if (rpar == NULL)
+        return -1;
+    if (group_by == GROUP_NAME) {
+        *rpar = '\0';
+        key = strchr(buf, '(');
+        if (key == NULL)
+            return -1;
+        entry->key = strdup(key + 1);
+    }
+    // Same indexes as in _pslinux.Process._parse_stat_file().
+    field = strtok_r(rpar + 1, " ", &saveptr);
+    for (i = 0; field != NULL && i <= 21; i++) {
+        if (i == 11 || i == 12)
+            entry->cpu += strtoull(field, NULL, 10);
+        else if (i == 17)
+            entry->threads = strtoull(field, NULL, 10);
+        else if (i == 21)
+            entry->rss = strtoull(field, NULL, 10) * pagesize;
+        field = strtok_r(NULL, " ", &saveptr);
+    }
+    if (i <= 21) {
+        free(entry->key);
+        entry->key = NULL;
+        return -1;
+    }
+
+    if (group_by == GROUP_UID) {
+        snprintf(path, sizeof(path), "%d/status", (int)pid);
+        if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+            return -1;
+        field = strstr(buf, "\nUid:");
+        if (field == NULL)
+            return -1;
+        entry->uid = strtol(field + 5, NULL, 10);
+    }
+    else if (group_by == GROUP_CGROUP) {
+        snprintf(path, sizeof(path), "%d/cgroup", (int)pid);
+        if (psutil_read_at(procfd, path, buf, sizeof(buf)) <= 0)
+            return -1;
+        key = parse_cgroup(buf);
+        entry->key = strdup(key != NULL ? key : "");
+    }
+
+    // Processes which can't be inspected (EACCES) still count, they
+    // just don't contribute these.
+    snprintf(path, sizeof(path), "%d/io", (int)pid);
+    if (psutil_read_at(procfd, path, buf, sizeof(buf)) > 0) {
+        entry->io = parse_key(buf, "\nread_bytes:")
+                    + parse_key(buf, "\nwrite_bytes:");
+    }
+    snprintf(path, sizeof(path), "%s/%d/fd", procfs, (int)pid);
+    nfds = psutil_count_fds(path, pid);
+    if (nfds > 0)
+        entry->fds = (unsigned long long)nfds;
+    if (want_pss) {
+        snprintf(path, sizeof(path), "%d/smaps_rollup", (int)pid);
+        if (psutil_read_at(procfd, path, buf, sizeof(buf)) > 0)
+            entry->pss = parse_key(buf, "\nPss:") * 1024;
+    }
+    return 0;
+}
+
+
+static int
+cmp_rollup_key(const void *a, const void *b) {
+    const struct rollup_entry *x = a;
+    const struct rollup_entry *y = b;
+
+    if (x->key == NULL)
+        return (x->uid > y->uid) - (x->uid < y->uid);
+    return strcmp(x->key, y->key);
+}
+
+
+// Sum process metrics grouped by real UID, cgroup (v2 path) or name,
+// in one scan with the GIL released. Return a
+// {key: (count, rss, pss, cpu_ticks, io_bytes, threads, fds)} dict.
+// pss is only collected if `want_pss` is true (reading smaps_rollup
+// is expensive). Processes which disappear in the meantime are
+// skipped. Per process records are sorted by key and then folded, so
+// that no Python object is created per process.
+PyObject *
+psutil_proc_rollup(PyObject *self, PyObject *args) {
+    char *procfs;
+    char *group_name;
+    int group_by = -1;
+    int want_pss;
+    int procfd;
+    int saved_errno = 0;
+    long pagesize;
+    size_t ngroups = 0;
+    struct rollup_entry *entry;
+    struct rollup_entry *group;
+    struct rollup_entry *tmp;
+    struct rollup_list list = {NULL, 0, 0};  // capacity: pids.count
+    struct pid_array pids = {NULL, 0, 0};
+    PyObject *py_key = NULL;
+    PyObject *py_value = NULL;
+    PyObject *py_retdict = NULL;
+
+    if (!PyArg_ParseTuple(args, "ssp", &procfs, &group_name, &want_pss))
+        return NULL;
+    for (size_t i = 0; i < sizeof(group_names) / sizeof(*group_names); i++) {
+        if (strcmp(group_name, group_names[i]) == 0)
+            group_by = (int)i;
+    }
+    if (group_by == -1) {
+        PyErr_Format(PyExc_ValueError, "invalid group %s", group_name);
+        return NULL;
+    }
+    pagesize = sysconf(_SC_PAGESIZE);
+
+    Py_BEGIN_ALLOW_THREADS
+    procfd = open_and_list_pids(procfs, &pids);
+    if (procfd == -1) {
+        saved_errno = errno;
+    }
+    else {
+        list.capacity = pids.count + 1;
+        list.items = malloc(list.capacity * sizeof(*list.items));
+        if (list.items == NULL)
+            saved_errno = ENOMEM;
+        for (size_t i = 0; saved_errno == 0 && i < pids.count; i++) {
+            entry = &list.items[list.count];
+            if (rollup_pid(
+                    procfd,
+                    procfs,
+                    pids.items[i],
+                    group_by,
+                    want_pss,
+                    pagesize,
+                    entry
+                )
+                != 0)
+                continue;  // gone
+            list.count++;
+            if (group_by != GROUP_UID && entry->key == NULL)
+                saved_errno = ENOMEM;
+        }
+        close(procfd);
+
+        // Sort by key and fold the records of each group into the
+        // first one.
+        if (saved_errno == 0) {
+            qsort(
+                list.items, list.count, sizeof(*list.items), cmp_rollup_key
+            );
+            for (size_t i = 0; i < list.count; i++) {
+                tmp = &list.items[i];
+                group = ngroups > 0 ? &list.items[ngroups - 1] : NULL;
+                if (group != NULL && cmp_rollup_key(group, tmp) == 0) {
+                    group->count += tmp->count;
+                    group->rss += tmp->rss;
+                    group->pss += tmp->pss;
+                    group->cpu += tmp->cpu;
+                    group->io += tmp->io;
+                    group->threads += tmp->threads;
+                    group->fds += tmp->fds;
+                    free(tmp->key);
+                    tmp->key = NULL;
+                }
+                else {
+                    if (ngroups != i) {
+                        list.items[ngroups] = *tmp;
+                        tmp->key = NULL;
+                    }
+                    ngroups++;
+                }
+            }
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    free(pids.items);
+    if (saved_errno != 0)
+        goto error_errno;
+
+    py_retdict = PyDict_New();
+    if (py_retdict == NULL)
+        goto error;
+    for (size_t i = 0; i < ngroups; i++) {
+        group = &list.items[i];
+        if (group_by == GROUP_UID)
+            py_key = PyLong_FromLong(group->uid);
+        else
+            py_key = PyUnicode_DecodeFSDefault(group->key);
+        if (py_key == NULL)
+            goto error;
+        py_value = Py_BuildValue(
+            "(KKKKKKK)",
+            group->count,
+            group->rss,
+            group->pss,
+            group->cpu,
+            group->io,
+            group->threads,
+            group->fds
+        );
+        if (py_value == NULL)
+            goto error;
+        if (PyDict_SetItem(py_retdict, py_key, py_value))
+            goto error;
+        Py_CLEAR(py_key);
+        Py_CLEAR(py_value);
+    }
+    for (size_t i = 0; i < ngroups; i++)
+        free(list.items[i].key);
+    free(list.items);
+    return py_retdict;
+
+error_errno:
+    for (size_t i = 0; i < list.count; i++)
+        free(list.items[i].key);
+    free(list.items);
+    return raise_procfs_error(saved_errno, procfs);
+
+error:
+    for (size_t i = 0; i < ngroups; i++)
+        free(list.items[i].key);
+    free(list.items);
+    Py_XDECREF(py_key);
+    Py_XDECREF(py_value);
+    Py_XDECREF(py_retdict);
+    return NULL;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2009, Giampaolo Rodola'. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// Helpers to read many small /sys and /proc files relative to an open
+// directory fd, so that the kernel resolves the directory path only
+// once instead of once per file.
+
+#include <Python.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../arch/all/init.h"
+
+
+// Read up to `size - 1` bytes of `path` (relative to `dirfd`) into
+// `buf` and NUL-terminate it. Return the number of bytes read, or -1
+// on error with errno set. Does not touch the Python C-API, so it can
+// be called with the GIL released.
+ssize_t
+psutil_read_at(int dirfd, const char *path, char *buf, size_t size) {
+    int fd;
+    ssize_t nbytes;
+    int saved_errno;
+
+    fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    nbytes = read(fd, buf, size - 1);
+    saved_errno = errno;
+    close(fd);
+    if (nbytes == -1) {
+        errno = saved_errno;
+        return -1;
+    }
+    buf[nbytes] = '\0';
+    return nbytes;
+}
+
+
+// Open `path` as a directory fd to be passed to psutil_read_at().
+// Return -1 on error with errno set.
+int
+psutil_open_dir(const char *path) {
+    return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+
+// Encode a sequence of str with the filesystem encoding, so that the
+// names can be used by C code running with the GIL released. Return a
+// new list of bytes objects owning the strings, and set `*names` to a
+// malloc()ed array of `*count` pointers into it, which the caller must
+// free(). Return NULL on error.
+PyObject *
+psutil_encode_names(
+    PyObject *py_names, const char ***names, Py_ssize_t *count
+) {
+    Py_ssize_t i;
+    Py_ssize_t n;
+    PyObject *py_name;
+    PyObject *py_bytes;
+    PyObject *py_list = NULL;
+
+    *names = NULL;
+    n = PySequence_Size(py_names);
+    if (n == -1)
+        return NULL;
+    py_list = PyList_New(n);
+    if (py_list == NULL)
+        return NULL;
+    *names = calloc(n + 1, sizeof(**names));
+    if (*names == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    for (i = 0; i < n; i++) {
+        py_name = PySequence_GetItem(py_names, i);
+        if (py_name == NULL)
+            goto error;
+        py_bytes = PyUnicode_EncodeFSDefault(py_name);
+        Py_DECREF(py_name);
+        if (py_bytes == NULL)
+            goto error;
+        PyList_SetItem(py_list, i, py_bytes);  // steals the reference
+        (*names)[i] = PyBytes_AsString(py_bytes);
+        if ((*names)[i] == NULL)
+            goto error;
+    }
+    *count = n;
+    return py_list;
+
+error:
+    free(*names);
+    *names = NULL;
+    Py_DECREF(py_list);
+    return NULL;
+}
+
+
+// Given a root directory and a sequence of file names relative to it,
+// read each file and parse its content as an integer. Return a list
+// with one item per name, which is None if the file doesn't exist,
+// can't be read or doesn't contain a number (e.g. a CPU or a sensor
+// which went away in the meantime). All reads happen with the GIL
+// released.
+PyObject *
+psutil_sysfs_read_ints(PyObject *self, PyObject *args) {
+    char *root;
+    char buf[128];
+    char *end;
+    int dirfd = -1;
+    Py_ssize_t i;
+    Py_ssize_t nnames = 0;
+    const char **names = NULL;
+    long long *values = NULL;
+    char *valid = NULL;
+    PyObject *py_names;
+    PyObject *py_value;
+    PyObject *py_encoded = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "sO", &root, &py_names))
+        return NULL;
+    py_encoded = psutil_encode_names(py_names, &names, &nnames);
+    if (py_encoded == NULL)
+        return NULL;
+
+    values = calloc(nnames + 1, sizeof(*values));
+    valid = calloc(nnames + 1, sizeof(*valid));
+    if (values == NULL || valid == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    dirfd = psutil_open_dir(root);
+    if (dirfd != -1) {
+        for (i = 0; i < nnames; i++) {
+            if (psutil_read_at(dirfd, names[i], buf, sizeof(buf)) <= 0)
+                continue;
+            errno = 0;
+            values[i] = strtoll(buf, &end, 10);
+            if (errno == 0 && end != buf)
+                valid[i] = 1;
+        }
+        close(dirfd);
+    }
+    Py_END_ALLOW_THREADS
+    if (dirfd == -1) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, root);
+        goto error;
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (i = 0; i < nnames; i++) {
+        if (valid[i]) {
+            py_value = PyLong_FromLongLong(values[i]);
+        }
+        else {
+            Py_INCREF(Py_None);
+            py_value = Py_None;
+        }
+        if (!pylist_append_obj(py_retlist, py_value))
+            goto error;
+    }
+
+    free(names);
+    free(values);
+    free(valid);
+    Py_DECREF(py_encoded);
+    return py_retlist;
+
+error:
+    free(names);
+    free(values);
+    free(valid);
+    Py_DECREF(py_encoded);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
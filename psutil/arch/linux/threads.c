@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2009, Giampaolo Rodola'. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// Functions walking /proc/<pid>/task: per-thread stats, and child
+// processes via task/<tid>/children. Files are opened relative to the
+// task directory, so that the kernel resolves "/proc/<pid>/task" only
+// once.
+
+#include <Python.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../arch/all/init.h"
+
+struct thread_entry {
+    int tid;
+    char name[64];
+    char status;
+    int cpu_num;
+    unsigned long long utime;  // clock ticks
+    unsigned long long stime;  // clock ticks
+    unsigned long long vol_ctxsw;
+    unsigned long long invol_ctxsw;
+    unsigned long long run_ns;
+    unsigned long long wait_ns;
+};
+
+
+static int
+thread_cmp(const void *a, const void *b) {
+    const struct thread_entry *x = a;
+    const struct thread_entry *y = b;
+
+    return (x->tid > y->tid) - (x->tid < y->tid);
+}
+
+
+// Parse a /proc/<pid>/task/<tid>/stat line. The name is between
+// parentheses and can contain spaces and parentheses itself, hence
+// the last ")" is what ends it.
+static int
+parse_thread_stat(char *buf, struct thread_entry *t) {
+    char *lpar;
+    char *rpar;
+    char *field;
+    char *saveptr;
+    size_t len;
+    int i;
+
+    lpar = strchr(buf, '(');
+    rpar = strrchr(buf, ')');
+    if (lpar == NULL || rpar == NULL || rpar < lpar)
+        return -1;
+    len = (size_t)(rpar - lpar - 1);
+    if (len >= sizeof(t->name))
+        len = sizeof(t->name) - 1;
+    memcpy(t->name, lpar + 1, len);
+    t->name[len] = '\0';
+
+    // Same indexes as in _pslinux.Process._parse_stat_file().
+    field = strtok_r(rpar + 1, " ", &saveptr);
+    for (i = 0; field != NULL && i <= 36; i++) {
+        if (i == 0)
+            t->status = field[0];
+        else if (i == 11)
+            t->utime = strtoull(field, NULL, 10);
+        else if (i == 12)
+            t->stime = strtoull(field, NULL, 10);
+        else if (i == 36)
+            t->cpu_num = atoi(field);
+        field = strtok_r(NULL, " ", &saveptr);
+    }
+    return i > 12 ? 0 : -1;
+}
+
+
+// Read the context switches out of /proc/<pid>/task/<tid>/status.
+static void
+parse_thread_status(const char *buf, struct thread_entry *t) {
+    const char *ptr;
+
+    ptr = strstr(buf, "\nvoluntary_ctxt_switches:");
+    if (ptr != NULL)
+        t->vol_ctxsw = strtoull(ptr + 25, NULL, 10);
+    ptr = strstr(buf, "\nnonvoluntary_ctxt_switches:");
+    if (ptr != NULL)
+        t->invol_ctxsw = strtoull(ptr + 28, NULL, 10);
+}
+
+
+// Read one thread. If `full` is 0 only the stat file is read. Return
+// 0 on success, 1 if the thread went away, -1 on any other error with
+// errno set.
+static int
+read_thread(int taskfd, const char *tid, int full, struct thread_entry *t) {
+    char path[NAME_MAX + 16];
+    char buf[4096];
+
+    memset(t, 0, sizeof(*t));
+    t->tid = atoi(tid);
+    snprintf(path, sizeof(path), "%s/stat", tid);
+    if (psutil_read_at(taskfd, path, buf, sizeof(buf)) == -1)
+        return (errno == ENOENT || errno == ESRCH) ? 1 : -1;
+    if (parse_thread_stat(buf, t) != 0)
+        return 1;  // empty, the thread is being torn down
+    if (!full)
+        return 0;
+
+    // These are best effort: if the thread is gone by now we still
+    // have a consistent stat line to return.
+    snprintf(path, sizeof(path), "%s/status", tid);
+    if (psutil_read_at(taskfd, path, buf, sizeof(buf)) > 0)
+        parse_thread_status(buf, t);
+    // Requires CONFIG_SCHED_INFO, else left to 0.
+    snprintf(path, sizeof(path), "%s/schedstat", tid);
+    if (psutil_read_at(taskfd, path, buf, sizeof(buf)) > 0)
+        sscanf(buf, "%llu %llu", &t->run_ns, &t->wait_ns);
+    return 0;
+}
+
+
+// Return the threads of a process as a (threads, hit_enoent) tuple,
+// where threads is a list sorted by thread ID. If `full` is false
+// each thread is a (tid, utime, stime) tuple, else a
+// (tid, name, status, cpu_num, utime, stime, vol_ctxsw, invol_ctxsw,
+// run_ns, wait_ns) tuple. Times are in clock ticks, except run_ns and
+// wait_ns. `hit_enoent` is true if a thread disappeared while being
+// read, in which case the caller should check whether the process is
+// still alive.
+PyObject *
+psutil_proc_threads(PyObject *self, PyObject *args) {
+    char *procfs;
+    char path[PATH_MAX];
+    int pid;
+    int full;
+    int taskfd;
+    int ret;
+    int saved_errno = 0;
+    int hit_enoent = 0;
+    size_t count = 0;
+    size_t capacity = 0;
+    struct thread_entry *threads = NULL;
+    struct thread_entry *tmp;
+    struct dirent *de;
+    DIR *dir = NULL;
+    PyObject *py_name = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "sip", &procfs, &pid, &full))
+        return NULL;
+    snprintf(path, sizeof(path), "%s/%d/task", procfs, pid);
+
+    Py_BEGIN_ALLOW_THREADS
+    taskfd = psutil_open_dir(path);
+    if (taskfd != -1)
+        dir = fdopendir(taskfd);
+    if (dir == NULL) {
+        saved_errno = errno;
+        if (taskfd != -1)
+            close(taskfd);
+    }
+    else {
+        while ((de = readdir(dir)) != NULL) {
+            if (de->d_name[0] < '0' || de->d_name[0] > '9')
+                continue;
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                tmp = realloc(threads, capacity * sizeof(*tmp));
+                if (tmp == NULL) {
+                    saved_errno = ENOMEM;
+                    break;
+                }
+                threads = tmp;
+            }
+            ret = read_thread(taskfd, de->d_name, full, &threads[count]);
+            if (ret == 0) {
+                count++;
+            }
+            else if (ret == 1) {
+                hit_enoent = 1;
+            }
+            else {
+                saved_errno = errno;
+                snprintf(path, sizeof(path), "%s/%d/task/%s/stat", procfs,
+                         pid, de->d_name);
+                break;
+            }
+        }
+        closedir(dir);
+        if (saved_errno == 0)
+            qsort(threads, count, sizeof(*threads), thread_cmp);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (saved_errno == ENOMEM) {
+        free(threads);
+        return PyErr_NoMemory();
+    }
+    if (saved_errno != 0) {
+        free(threads);
+        errno = saved_errno;
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < count; i++) {
+        if (!full) {
+            if (!pylist_append_fmt(
+                    py_retlist,
+                    "(iKK)",
+                    threads[i].tid,
+                    threads[i].utime,
+                    threads[i].stime
+                ))
+                goto error;
+            continue;
+        }
+        py_name = PyUnicode_DecodeFSDefault(threads[i].name);
+        if (py_name == NULL)
+            goto error;
+        if (!pylist_append_fmt(
+                py_retlist,
+                "(iOCiKKKKKK)",
+                threads[i].tid,
+                py_name,
+                threads[i].status,
+                threads[i].cpu_num,
+                threads[i].utime,
+                threads[i].stime,
+                threads[i].vol_ctxsw,
+                threads[i].invol_ctxsw,
+                threads[i].run_ns,
+                threads[i].wait_ns
+            ))
+            goto error;
+        Py_CLEAR(py_name);
+    }
+
+    free(threads);
+    return Py_BuildValue("NO", py_retlist, hit_enoent ? Py_True : Py_False);
+
+error:
+    free(threads);
+    Py_XDECREF(py_name);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
+
+
+// ====================================================================
+// --- children
+// ====================================================================
+
+
+struct pid_list {
+    pid_t *items;
+    size_t count;
+    size_t capacity;
+};
+
+
+static int
+pid_list_append(struct pid_list *list, pid_t pid) {
+    pid_t *tmp;
+
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        tmp = realloc(list->items, list->capacity * sizeof(*tmp));
+        if (tmp == NULL)
+            return -1;
+        list->items = tmp;
+    }
+    list->items[list->count++] = pid;
+    return 0;
+}
+
+
+// Append the PIDs listed in `path` (relative to `dirfd`), a
+// space-separated /proc/<pid>/task/<tid>/children file, to `list`.
+// The file is read in one go, because the kernel may skip entries
+// across reads if children exit in between. Return 0 on success, -1
+// on error with errno set.
+static int
+read_children_file(int dirfd, const char *path, struct pid_list *list) {
+    size_t size = 4096;
+    ssize_t nbytes;
+    char *buf = NULL;
+    char *tmp;
+    char *ptr;
+    char *end;
+    long pid;
+
+    for (;;) {
+        tmp = realloc(buf, size);
+        if (tmp == NULL) {
+            free(buf);
+            errno = ENOMEM;
+            return -1;
+        }
+        buf = tmp;
+        nbytes = psutil_read_at(dirfd, path, buf, size);
+        if (nbytes == -1) {
+            free(buf);
+            return -1;
+        }
+        if ((size_t)nbytes < size - 1)
+            break;
+        size *= 2;  // possibly truncated, retry with a bigger buffer
+    }
+
+    ptr = buf;
+    for (;;) {
+        pid = strtol(ptr, &end, 10);
+        if (end == ptr)
+            break;
+        ptr = end;
+        if (pid > 0 && pid_list_append(list, (pid_t)pid) != 0) {
+            free(buf);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    free(buf);
+    return 0;
+}
+
+
+// Append the direct children of `pid` to `list`, reading the children
+// file of all of its threads. Return 0 on success, 1 if the kernel
+// has no children files (CONFIG_PROC_CHILDREN not set), -1 on error
+// with errno set.
+static int
+read_children(const char *procfs, pid_t pid, struct pid_list *list) {
+    char path[PATH_MAX];
+    char name[NAME_MAX + 16];
+    struct dirent *de;
+    DIR *dir;
+    int taskfd;
+    int ret = 0;
+
+    snprintf(path, sizeof(path), "%s/%d/task", procfs, (int)pid);
+    taskfd = psutil_open_dir(path);
+    if (taskfd == -1)
+        return -1;
+    // The thread group leader is there as long as the process is.
+    snprintf(name, sizeof(name), "%d/children", (int)pid);
+    if (faccessat(taskfd, name, F_OK, 0) == -1) {
+        ret = (errno == ENOENT) ? 1 : -1;
+        close(taskfd);
+        return ret;
+    }
+    dir = fdopendir(taskfd);
+    if (dir == NULL) {
+        close(taskfd);
+        return -1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] < '0' || de->d_name[0] > '9')
+            continue;
+        snprintf(name, sizeof(name), "%s/children", de->d_name);
+        if (read_children_file(taskfd, name, list) == -1) {
+            if (errno == ENOENT || errno == ESRCH)
+                continue;  // thread exited
+            ret = -1;
+            break;
+        }
+    }
+    closedir(dir);
+    return ret;
+}
+
+
+// Return the PIDs of the children of a process (of all its
+// descendants if `recursive` is true) by reading
+// /proc/<pid>/task/<tid>/children, which only requires visiting the
+// descendants instead of all processes. Return None if the kernel
+// doesn't provide these files (CONFIG_PROC_CHILDREN), in which case
+// the caller has to fall back on scanning all PIDs.
+PyObject *
+psutil_proc_children(PyObject *self, PyObject *args) {
+    char *procfs;
+    int pid;
+    int recursive;
+    int ret;
+    int saved_errno = 0;
+    size_t next = 0;
+    struct pid_list list = {NULL, 0, 0};
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "sip", &procfs, &pid, &recursive))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = read_children(procfs, (pid_t)pid, &list);
+    if (ret == -1)
+        saved_errno = errno;
+    // Visit descendants breadth-first. Those which exit in the
+    // meantime are skipped. A process has one parent, hence children
+    // lists are disjoint and no dedup is needed here (a PID reparented
+    // while we walk may show up twice though: the caller handles it).
+    while (ret == 0 && recursive && next < list.count) {
+        if (read_children(procfs, list.items[next++], &list) == -1) {
+            if (errno == ENOENT || errno == ESRCH)
+                continue;
+            saved_errno = errno;
+            ret = -1;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (ret == 1) {
+        free(list.items);
+        Py_RETURN_NONE;
+    }
+    if (ret == -1) {
+        free(list.items);
+        if (saved_errno == ENOMEM)
+            return PyErr_NoMemory();
+        errno = saved_errno;
+        return psutil_oserror();
+    }
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (size_t i = 0; i < list.count; i++) {
+        if (!pylist_append_fmt(py_retlist, "i", (int)list.items[i]))
+            goto error;
+    }
+    free(list.items);
+    return py_retlist;
+
+error:
+    free(list.items);
+    Py_XDECREF(py_retlist);
+    return NULL;
+}
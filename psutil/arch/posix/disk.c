@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2009, Giampaolo Rodola'. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// statvfs() many paths concurrently from a small pool of threads, and
+// give up on the ones which don't return within a timeout. statvfs()
+// on a hung NFS / FUSE / CIFS mount can block forever (and can't be
+// interrupted), so the stuck threads are detached and left behind:
+// they free their own resources if and when the syscall returns. The
+// number of threads is bounded, both per call and process-wide, so
+// that many paths (or many hung mounts) can't exhaust them.
+
+#include <Python.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/statvfs.h>
+#include <time.h>
+
+#include "../../arch/all/init.h"
+
+#define STATVFS_STACK_SIZE (64 * 1024)
+// Max threads started by a single call.
+#define STATVFS_MAX_WORKERS 8
+// Max threads running at any time, including the ones still stuck
+// from previous calls.
+#define STATVFS_MAX_THREADS 32
+
+typedef struct statvfs_batch statvfs_batch;
+
+typedef struct statvfs_job {
+    char *path;
+    int done;
+    int timedout;  // only accessed by the caller
+    int err;
+    struct statvfs st;
+    statvfs_batch *batch;
+    struct statvfs_job *next;  // in the `inflight` list
+} statvfs_job;
+
+struct statvfs_batch {
+    pthread_cond_t cond;
+    int refcnt;  // the caller + one per running thread
+    int abandoned;  // the caller stopped waiting
+    size_t pending;  // jobs neither done nor skipped
+    size_t next;  // index of the next job to hand out
+    size_t count;
+    statvfs_job *jobs;
+};
+
+// Protects all batches, the `inflight` list and `nthreads`.
+static pthread_mutex_t statvfs_lock = PTHREAD_MUTEX_INITIALIZER;
+// Jobs whose thread is still running, possibly from a previous call.
+static statvfs_job *inflight = NULL;
+// Number of worker threads running, possibly from previous calls.
+static int nthreads = 0;
+
+
+// Must be called with `statvfs_lock` held.
+static void
+batch_decref(statvfs_batch *batch) {
+    if (--batch->refcnt > 0)
+        return;
+    for (size_t i = 0; i < batch->count; i++)
+        free(batch->jobs[i].path);
+    free(batch->jobs);
+    pthread_cond_destroy(&batch->cond);
+    free(batch);
+}
+
+
+// Must be called with `statvfs_lock` held.
+static void
+inflight_remove(statvfs_job *job) {
+    statvfs_job **ptr;
+
+    for (ptr = &inflight; *ptr != NULL; ptr = &(*ptr)->next) {
+        if (*ptr == job) {
+            *ptr = job->next;
+            return;
+        }
+    }
+}
+
+
+// Return 1 if a thread left behind by a previous call is still stuck
+// on `path`, in which case there's no point in trying it again.
+// Must be called with `statvfs_lock` held.
+static int
+inflight_abandoned(const char *path) {
+    statvfs_job *job;
+
+    for (job = inflight; job != NULL; job = job->next) {
+        if (job->batch->abandoned && strcmp(job->path, path) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+
+// Return the next job to run, or NULL if there are none left or the
+// caller stopped waiting. Jobs for paths on which a previous call is
+// still stuck are skipped (and stay not done, meaning timed out).
+// Must be called with `statvfs_lock` held.
+static statvfs_job *
+batch_next_job(statvfs_batch *batch) {
+    statvfs_job *job;
+
+    while (!batch->abandoned && batch->next < batch->count) {
+        job = &batch->jobs[batch->next++];
+        if (inflight_abandoned(job->path)) {
+            if (--batch->pending == 0)
+                pthread_cond_signal(&batch->cond);
+            continue;
+        }
+        job->batch = batch;
+        job->next = inflight;
+        inflight = job;
+        return job;
+    }
+    return NULL;
+}
+
+
+static void *
+statvfs_worker(void *arg) {
+    statvfs_batch *batch = arg;
+    statvfs_job *job;
+    struct statvfs st;
+    int err;
+
+    pthread_mutex_lock(&statvfs_lock);
+    while ((job = batch_next_job(batch)) != NULL) {
+        pthread_mutex_unlock(&statvfs_lock);
+        err = 0;
+        memset(&st, 0, sizeof(st));
+        if (statvfs(job->path, &st) != 0)
+            err = errno;
+        pthread_mutex_lock(&statvfs_lock);
+        job->st = st;
+        job->err = err;
+        job->done = 1;
+        inflight_remove(job);
+        if (--batch->pending == 0)
+            pthread_cond_signal(&batch->cond);
+    }
+    nthreads--;
+    batch_decref(batch);
+    pthread_mutex_unlock(&statvfs_lock);
+    return NULL;
+}
+
+
+// Start up to STATVFS_MAX_WORKERS detached threads, which pick the
+// batch jobs one after the other. At least one is started even if
+// STATVFS_MAX_THREADS is reached, so that every call makes progress.
+// If no thread can be started the jobs are left not done. Must be
+// called with `statvfs_lock` held.
+static void
+batch_start(statvfs_batch *batch) {
+    pthread_t thread;
+    pthread_attr_t attr;
+    size_t stacksize = STATVFS_STACK_SIZE;
+    size_t nworkers;
+
+    batch->pending = batch->count;
+    nworkers = batch->count;
+    if (nworkers > STATVFS_MAX_WORKERS)
+        nworkers = STATVFS_MAX_WORKERS;
+
+#ifdef PTHREAD_STACK_MIN
+    if (stacksize < (size_t)PTHREAD_STACK_MIN)
+        stacksize = (size_t)PTHREAD_STACK_MIN;
+#endif
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, stacksize);
+
+    for (size_t i = 0; i < nworkers; i++) {
+        if (i > 0 && nthreads >= STATVFS_MAX_THREADS)
+            break;
+        batch->refcnt++;
+        nthreads++;
+        if (pthread_create(&thread, &attr, statvfs_worker, batch) != 0) {
+            batch->refcnt--;
+            nthreads--;
+            break;
+        }
+    }
+    pthread_attr_destroy(&attr);
+    // No thread could be started: don't wait for nothing.
+    if (batch->refcnt == 1)
+        batch->pending = 0;
+}
+
+
+#if defined(__APPLE__)
+// pthread_condattr_setclock() is not available: wait a relative
+// amount of time, measured against the monotonic clock.
+static int
+batch_cond_init(statvfs_batch *batch) {
+    return pthread_cond_init(&batch->cond, NULL);
+}
+#else
+// Make pthread_cond_timedwait() use CLOCK_MONOTONIC, so that the
+// deadline is not affected by changes of the system clock.
+static int
+batch_cond_init(statvfs_batch *batch) {
+    pthread_condattr_t attr;
+    int ret;
+
+    if ((ret = pthread_condattr_init(&attr)) != 0)
+        return ret;
+    ret = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (ret == 0)
+        ret = pthread_cond_init(&batch->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return ret;
+}
+#endif
+
+
+static double
+monotonic(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// Wait until all jobs are done or `timeout` seconds have passed
+// (forever if negative). Must be called with `statvfs_lock` held.
+static void
+batch_wait(statvfs_batch *batch, double timeout) {
+    struct timespec ts;
+    double deadline;
+#if defined(__APPLE__)
+    double secs;
+#endif
+
+    if (timeout < 0) {
+        while (batch->pending > 0)
+            pthread_cond_wait(&batch->cond, &statvfs_lock);
+        return;
+    }
+
+    deadline = monotonic() + timeout;
+    while (batch->pending > 0) {
+#if defined(__APPLE__)
+        secs = deadline - monotonic();
+        if (secs <= 0)
+            break;
+        ts.tv_sec = (time_t)secs;
+        ts.tv_nsec = (long)((secs - (double)ts.tv_sec) * 1e9);
+        if (pthread_cond_timedwait_relative_np(
+                &batch->cond, &statvfs_lock, &ts
+            )
+            == ETIMEDOUT)
+        {
+            break;
+        }
+#else
+        ts.tv_sec = (time_t)deadline;
+        ts.tv_nsec = (long)((deadline - (double)ts.tv_sec) * 1e9);
+        if (pthread_cond_timedwait(&batch->cond, &statvfs_lock, &ts)
+            == ETIMEDOUT)
+        {
+            break;
+        }
+#endif
+    }
+}
+
+
+// Given a sequence of paths and a timeout in seconds (None means no
+// timeout), statvfs() all of them concurrently with the GIL released.
+// Return a list with one item per path, which is either a
+// (f_frsize, f_blocks, f_bfree, f_bavail, f_files, f_ffree, f_favail)
+// tuple, an errno int if statvfs() failed, or None if it didn't return
+// in time.
+PyObject *
+psutil_disk_usage_many(PyObject *self, PyObject *args) {
+    Py_ssize_t n;
+    double timeout = -1;
+    statvfs_batch *batch = NULL;
+    statvfs_job *job;
+    PyObject *py_paths;
+    PyObject *py_timeout;
+    PyObject *py_path;
+    PyObject *py_bytes = NULL;
+    PyObject *py_retlist = NULL;
+
+    if (!PyArg_ParseTuple(args, "OO", &py_paths, &py_timeout))
+        return NULL;
+    if (py_timeout != Py_None) {
+        timeout = PyFloat_AsDouble(py_timeout);
+        if (timeout == -1 && PyErr_Occurred())
+            return NULL;
+        if (timeout < 0) {
+            PyErr_SetString(PyExc_ValueError, "timeout must be positive");
+            return NULL;
+        }
+    }
+    n = PySequence_Size(py_paths);
+    if (n == -1)
+        return NULL;
+
+    batch = calloc(1, sizeof(*batch));
+    if (batch == NULL)
+        return PyErr_NoMemory();
+    batch->refcnt = 1;
+    batch->jobs = calloc(n + 1, sizeof(*batch->jobs));
+    if (batch->jobs == NULL || batch_cond_init(batch) != 0) {
+        free(batch->jobs);
+        free(batch);
+        return PyErr_NoMemory();
+    }
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        py_path = PySequence_GetItem(py_paths, i);
+        if (py_path == NULL)
+            goto error;
+        if (!PyUnicode_FSConverter(py_path, &py_bytes)) {
+            Py_DECREF(py_path);
+            goto error;
+        }
+        Py_DECREF(py_path);
+        batch->jobs[i].path = strdup(PyBytes_AsString(py_bytes));
+        Py_CLEAR(py_bytes);
+        batch->count++;
+        if (batch->jobs[i].path == NULL) {
+            PyErr_NoMemory();
+            goto error;
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    pthread_mutex_lock(&statvfs_lock);
+    batch_start(batch);
+    batch_wait(batch, timeout);
+    // From now on threads still running are on their own: they won't
+    // pick new jobs, and the ones they'll complete are ignored.
+    batch->abandoned = 1;
+    for (size_t i = 0; i < batch->count; i++)
+        batch->jobs[i].timedout = !batch->jobs[i].done;
+    pthread_mutex_unlock(&statvfs_lock);
+    Py_END_ALLOW_THREADS
+
+    py_retlist = PyList_New(0);
+    if (py_retlist == NULL)
+        goto error;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        job = &batch->jobs[i];
+        if (job->timedout) {
+            Py_INCREF(Py_None);
+            if (!pylist_append_obj(py_retlist, Py_None))
+                goto error;
+        }
+        else if (job->err != 0) {
+            if (!pylist_append_fmt(py_retlist, "i", job->err))
+                goto error;
+        }
+        else if (!pylist_append_fmt(
+                     py_retlist,
+                     "(KKKKKKK)",
+                     (unsigned long long)job->st.f_frsize,
+                     (unsigned long long)job->st.f_blocks,
+                     (unsigned long long)job->st.f_bfree,
+                     (unsigned long long)job->st.f_bavail,
+                     (unsigned long long)job->st.f_files,
+                     (unsigned long long)job->st.f_ffree,
+                     (unsigned long long)job->st.f_favail
+                 ))
+        {
+            goto error;
+        }
+    }
+
+    pthread_mutex_lock(&statvfs_lock);
+    batch_decref(batch);
+    pthread_mutex_unlock(&statvfs_lock);
+    return py_retlist;
+
+error:
+    Py_XDECREF(py_retlist);
+    pthread_mutex_lock(&statvfs_lock);
+    batch->abandoned = 1;
+    batch_decref(batch);
+    pthread_mutex_unlock(&statvfs_lock);
+    return NULL;
+}
@@ -45,6 +45,7 @@ psutil_getpagesize_pywrapper(PyObject *self, PyObject *args) {
 
 // POSIX-only methods.
 static PyMethodDef posix_methods[] = {
+    {"disk_usage_many", psutil_disk_usage_many, METH_VARARGS},
     {"getpagesize", psutil_getpagesize_pywrapper, METH_VARARGS},
     {"net_if_addrs", psutil_net_if_addrs, METH_VARARGS},
     {"net_if_flags", psutil_net_if_flags, METH_VARARGS},
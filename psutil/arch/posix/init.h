@@ -42,12 +42,14 @@ extern PyObject *ZombieProcessError;
 
 int psutil_pid_exists(pid_t pid);
 long psutil_getpagesize(void);
+int psutil_net_if_flags_append(PyObject *py_retlist, int flags);
 int psutil_posix_add_constants(PyObject *mod);
 int psutil_posix_add_methods(PyObject *mod);
 PyObject *psutil_raise_for_pid(pid_t pid, char *msg);
 
 // --- Python wrappers
 
+PyObject *psutil_disk_usage_many(PyObject *self, PyObject *args);
 PyObject *psutil_getpagesize_pywrapper(PyObject *self, PyObject *args);
 PyObject *psutil_net_if_addrs(PyObject *self, PyObject *args);
 PyObject *psutil_net_if_flags(PyObject *self, PyObject *args);
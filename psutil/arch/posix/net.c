@@ -271,43 +271,10 @@ append_flag(PyObject *py_retlist, const char *flag_name) {
     return pylist_append_obj(py_retlist, PyUnicode_FromString(flag_name));
 }
 
-// Get all of the NIC flags and return them.
-PyObject *
-psutil_net_if_flags(PyObject *self, PyObject *args) {
-    char *nic_name;
-    int sock = -1;
-    int ret;
-    struct ifreq ifr;
-    PyObject *py_retlist = PyList_New(0);
-    short int flags;
-
-    if (py_retlist == NULL)
-        return NULL;
-
-    if (!PyArg_ParseTuple(args, "s", &nic_name))
-        goto error;
-
-    sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock == -1) {
-        psutil_oserror_wsyscall("socket(SOCK_DGRAM)");
-        goto error;
-    }
-
-    str_copy(ifr.ifr_name, sizeof(ifr.ifr_name), nic_name);
-    // A NIC driver may take a while to answer.
-    Py_BEGIN_ALLOW_THREADS
-    ret = ioctl(sock, SIOCGIFFLAGS, &ifr);
-    Py_END_ALLOW_THREADS
-    if (ret == -1) {
-        psutil_oserror_wsyscall("ioctl(SIOCGIFFLAGS)");
-        goto error;
-    }
-
-    close(sock);
-    sock = -1;
-
-    flags = ifr.ifr_flags & 0xFFFF;
-
+// Append the names of the IFF_* bits set in `flags` to `py_retlist`.
+// Return 0 on error.
+int
+psutil_net_if_flags_append(PyObject *py_retlist, int flags) {
     // Linux/glibc IFF flags:
     // https://sourceware.org/git/?p=glibc.git;a=blob;f=sysdeps/gnu/net/if.h;h=251418f82331c0426e58707fe4473d454893b132;hb=HEAD
     // macOS IFF flags:
@@ -321,135 +288,178 @@ psutil_net_if_flags(PyObject *self, PyObject *args) {
     // Available in (at least) Linux, macOS, AIX, BSD
     if (flags & IFF_UP)
         if (!append_flag(py_retlist, "up"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_BROADCAST
     // Available in (at least) Linux, macOS, AIX, BSD
     if (flags & IFF_BROADCAST)
         if (!append_flag(py_retlist, "broadcast"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_DEBUG
     // Available in (at least) Linux, macOS, BSD
     if (flags & IFF_DEBUG)
         if (!append_flag(py_retlist, "debug"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_LOOPBACK
     // Available in (at least) Linux, macOS, BSD
     if (flags & IFF_LOOPBACK)
         if (!append_flag(py_retlist, "loopback"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_POINTOPOINT
     // Available in (at least) Linux, macOS, BSD
     if (flags & IFF_POINTOPOINT)
         if (!append_flag(py_retlist, "pointopoint"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_NOTRAILERS
     // Available in (at least) Linux, macOS, AIX
     if (flags & IFF_NOTRAILERS)
         if (!append_flag(py_retlist, "notrailers"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_RUNNING
     // Available in (at least) Linux, macOS, AIX, BSD
     if (flags & IFF_RUNNING)
         if (!append_flag(py_retlist, "running"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_NOARP
     // Available in (at least) Linux, macOS, BSD
     if (flags & IFF_NOARP)
         if (!append_flag(py_retlist, "noarp"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_PROMISC
     // Available in (at least) Linux, macOS, BSD
     if (flags & IFF_PROMISC)
         if (!append_flag(py_retlist, "promisc"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_ALLMULTI
     // Available in (at least) Linux, macOS, BSD
     if (flags & IFF_ALLMULTI)
         if (!append_flag(py_retlist, "allmulti"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_MASTER
     // Available in (at least) Linux
     if (flags & IFF_MASTER)
         if (!append_flag(py_retlist, "master"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_SLAVE
     // Available in (at least) Linux
     if (flags & IFF_SLAVE)
         if (!append_flag(py_retlist, "slave"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_MULTICAST
     // Available in (at least) Linux, macOS, BSD
     if (flags & IFF_MULTICAST)
         if (!append_flag(py_retlist, "multicast"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_PORTSEL
     // Available in (at least) Linux
     if (flags & IFF_PORTSEL)
         if (!append_flag(py_retlist, "portsel"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_AUTOMEDIA
     // Available in (at least) Linux
     if (flags & IFF_AUTOMEDIA)
         if (!append_flag(py_retlist, "automedia"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_DYNAMIC
     // Available in (at least) Linux
     if (flags & IFF_DYNAMIC)
         if (!append_flag(py_retlist, "dynamic"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_OACTIVE
     // Available in (at least) macOS, BSD
     if (flags & IFF_OACTIVE)
         if (!append_flag(py_retlist, "oactive"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_SIMPLEX
     // Available in (at least) macOS, AIX, BSD
     if (flags & IFF_SIMPLEX)
         if (!append_flag(py_retlist, "simplex"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_LINK0
     // Available in (at least) macOS, BSD
     if (flags & IFF_LINK0)
         if (!append_flag(py_retlist, "link0"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_LINK1
     // Available in (at least) macOS, BSD
     if (flags & IFF_LINK1)
         if (!append_flag(py_retlist, "link1"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_LINK2
     // Available in (at least) macOS, BSD
     if (flags & IFF_LINK2)
         if (!append_flag(py_retlist, "link2"))
-            goto error;
+            return 0;
 #endif
 #ifdef IFF_D2
     // Available in (at least) AIX
     if (flags & IFF_D2)
         if (!append_flag(py_retlist, "d2"))
-            goto error;
+            return 0;
 #endif
 
+    return 1;
+}
+
+
+// Get all of the NIC flags and return them.
+PyObject *
+psutil_net_if_flags(PyObject *self, PyObject *args) {
+    char *nic_name;
+    int sock = -1;
+    int ret;
+    struct ifreq ifr;
+    PyObject *py_retlist = PyList_New(0);
+    short int flags;
+
+    if (py_retlist == NULL)
+        return NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &nic_name))
+        goto error;
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == -1) {
+        psutil_oserror_wsyscall("socket(SOCK_DGRAM)");
+        goto error;
+    }
+
+    str_copy(ifr.ifr_name, sizeof(ifr.ifr_name), nic_name);
+    // A NIC driver may take a while to answer.
+    Py_BEGIN_ALLOW_THREADS
+    ret = ioctl(sock, SIOCGIFFLAGS, &ifr);
+    Py_END_ALLOW_THREADS
+    if (ret == -1) {
+        psutil_oserror_wsyscall("ioctl(SIOCGIFFLAGS)");
+        goto error;
+    }
+
+    close(sock);
+    sock = -1;
+
+    flags = ifr.ifr_flags & 0xFFFF;
+    if (!psutil_net_if_flags_append(py_retlist, flags))
+        goto error;
+
     return py_retlist;
 
 error:
@@ -183,6 +183,8 @@ def main():
             args = (PID,)
         elif name == 'disk_usage':
             args = (os.getcwd(),)
+        elif name == 'top_processes':
+            args = ('rss',)
         timecall(name, fun, *args)
     timecall('cpu_count (cores)', psutil.cpu_count, logical=False)
     timecall('process_iter (all)', lambda: list(psutil.process_iter()))
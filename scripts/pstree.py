@@ -8,61 +8,46 @@
 as a tree structure.
 
 $ python3 scripts/pstree.py
-0 ?
-|- 1 init
-| |- 289 cgmanager
-| |- 616 upstart-socket-bridge
-| |- 628 rpcbind
-| |- 892 upstart-file-bridge
-| |- 907 dbus-daemon
-| |- 978 avahi-daemon
-| | `_ 979 avahi-daemon
-| |- 987 NetworkManager
-| | |- 2242 dnsmasq
-| | `_ 10699 dhclient
-| |- 993 polkitd
-| |- 1061 getty
-| |- 1066 su
-| | `_ 1190 salt-minion...
+1 init
+|- 289 cgmanager
+|- 616 upstart-socket-bridge
+|- 628 rpcbind
+|- 892 upstart-file-bridge
+|- 907 dbus-daemon
+|- 978 avahi-daemon
+| `_ 979 avahi-daemon
+|- 987 NetworkManager
+| |- 2242 dnsmasq
+| `_ 10699 dhclient
+|- 993 polkitd
+|- 1061 getty
+|- 1066 su
+| `_ 1190 salt-minion...
 ...
 """
 
-import collections
 import sys
 
 import psutil
 
 
-def print_tree(parent, tree, indent=''):
-    try:
-        name = psutil.Process(parent).name()
-    except psutil.Error:
-        name = "?"
-    print(parent, name)
-    if parent not in tree:
+def print_tree(tree, pid, indent=''):
+    print(pid, tree.name(pid))
+    children = tree.children(pid)
+    if not children:
         return
-    children = tree[parent][:-1]
-    for child in children:
+    for child in children[:-1]:
         sys.stdout.write(indent + "|- ")
-        print_tree(child, tree, indent + "| ")
-    child = tree[parent][-1]
+        print_tree(tree, child, indent + "| ")
     sys.stdout.write(indent + "`_ ")
-    print_tree(child, tree, indent + "  ")
+    print_tree(tree, children[-1], indent + "  ")
 
 
 def main():
-    # construct a dict where 'values' are all the processes
-    # having 'key' as their parent
-    tree = collections.defaultdict(list)
-    for p in psutil.process_iter():
-        try:
-            tree[p.ppid()].append(p.pid)
-        except (psutil.NoSuchProcess, psutil.ZombieProcess):
-            pass
-    # on systems supporting PID 0, PID 0's parent is usually 0
-    if 0 in tree and 0 in tree[0]:
-        tree[0].remove(0)
-    print_tree(min(tree), tree)
+    # A snapshot of the whole process tree, taken in one go.
+    tree = psutil.ProcessTree()
+    for root in sorted(tree.roots()):
+        print_tree(tree, root)
 
 
 if __name__ == '__main__':
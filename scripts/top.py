@@ -15,7 +15,7 @@ $ python3 scripts/top.py
  CPU3  [||||                                    ]  11.5%
  Mem   [|||||||||||||||||||||||||||||           ]  73.0% 11017M / 15936M
  Swap  [                                        ]   1.3%   276M / 20467M
- Processes: 347 (sleeping=273, running=1, idle=73)
+ Processes: 347 total, 1 running
  Load average: 1.10 1.28 1.34  Uptime: 8 days, 21:15:40
 
 PID    USER       NI   VIRT    RES  CPU%  MEM%     TIME+  NAME
@@ -34,7 +34,6 @@ PID    USER       NI   VIRT    RES  CPU%  MEM%     TIME+  NAME
 
 import datetime
 import sys
-import time
 
 try:
     import curses
@@ -74,36 +73,34 @@ def printl(line, color=None, bold=False, highlight=False):
 
 
 def poll(interval):
-    # sleep some time
-    time.sleep(interval)
+    # Only the processes fitting in the window (the ones which used
+    # more CPU during the interval) are inspected.
+    interval = max(interval, 0.1)
+    rows = win.getmaxyx()[0]
+    top = psutil.top_processes("cpu", n=rows, interval=interval)
     procs = []
-    procs_status = {}
-    for p in psutil.process_iter():
+    for p, cpu_time in top:
         try:
             p.dict = p.as_dict([
                 'username',
                 'nice',
                 'memory_info',
                 'memory_percent',
-                'cpu_percent',
                 'cpu_times',
                 'name',
-                'status',
             ])
-            try:
-                procs_status[p.dict['status']] += 1
-            except KeyError:
-                procs_status[p.dict['status']] = 1
         except psutil.NoSuchProcess:
             pass
         else:
+            p.dict['cpu_percent'] = round(cpu_time / interval * 100, 1)
             procs.append(p)
 
-    # return processes sorted by CPU percent usage
-    processes = sorted(
-        procs, key=lambda p: p.dict['cpu_percent'], reverse=True
-    )
-    return (processes, procs_status)
+    # Count processes without inspecting each one of them (the status
+    # filter is evaluated natively on Linux).
+    num_procs = len(psutil.pids())
+    filters = {"status": [psutil.STATUS_RUNNING]}
+    num_running = sum(1 for _ in psutil.process_iter(filters=filters))
+    return (procs, num_procs, num_running)
 
 
 def get_color(perc):
@@ -115,7 +112,7 @@ def get_color(perc):
         return "red"
 
 
-def print_header(procs_status, num_procs):
+def print_header(num_procs, num_running):
     """Print system-related info, above the process list."""
 
     def get_dashes(perc):
@@ -157,12 +154,7 @@ def print_header(procs_status, num_procs):
     printl(line, color=get_color(swap.percent))
 
     # processes number and status
-    st = []
-    for x, y in procs_status.items():
-        if y:
-            st.append(f"{x}={y}")
-    st.sort(key=lambda x: x[:3] in {'run', 'sle'}, reverse=1)
-    printl(f" Processes: {num_procs} ({', '.join(st)})")
+    printl(f" Processes: {num_procs} total, {num_running} running")
     # load average, uptime
     uptime = datetime.datetime.now() - datetime.datetime.fromtimestamp(
         psutil.boot_time()
@@ -177,7 +169,7 @@ def print_header(procs_status, num_procs):
     printl(line)
 
 
-def refresh_window(procs, procs_status):
+def refresh_window(procs, num_procs, num_running):
     """Print results on screen by using curses."""
     curses.endwin()
     templ = "{:<6} {:<8} {:>4} {:>6} {:>6} {:>5} {:>5} {:>9}  {:>2}"
@@ -193,7 +185,7 @@ def refresh_window(procs, procs_status):
         "TIME+",
         "NAME",
     )
-    print_header(procs_status, len(procs))
+    print_header(num_procs, num_running)
     printl("")
     printl(header, bold=True, highlight=True)
     for p in procs:
@@ -69,10 +69,14 @@ __all__ = [
     'PYPY', 'PYTHON_EXE', 'PYTHON_EXE_ENV', 'ROOT_DIR',
     'TESTFN_PREFIX', 'UNICODE_SUFFIX', 'INVALID_UNICODE_SUFFIX',
     'CI_TESTING', 'VALID_PROC_STATUSES', 'TOLERANCE_DISK_USAGE',
-    "HAS_PROC_CPU_AFFINITY", "HAS_CPU_FREQ", "HAS_PROC_ENVIRON",
+    "HAS_PROC_CPU_AFFINITY", "HAS_CPU_FREQ", "HAS_CPU_FREQ_TIMES",
+    "HAS_DISK_IO_STATS", "HAS_OPEN_FILES",
+    "HAS_PROC_ENVIRON",
     "HAS_PROC_IO_COUNTERS", "HAS_PROC_IONICE",
     "HAS_PROC_MEMORY_FOOTPRINT", "HAS_PROC_MEMORY_MAPS",
-    "HAS_PROC_CPU_NUM", "HAS_PROC_RLIMIT", "HAS_SENSORS_BATTERY",
+    "HAS_PROC_CPU_NUM", "HAS_PROC_NUM_FDS_BY_KIND", "HAS_PROC_RLIMIT",
+    "HAS_PROC_THREADS_INFO",
+    "HAS_SENSORS_BATTERY",
     "HAS_BATTERY", "HAS_SENSORS_FANS", "HAS_SENSORS_TEMPERATURES",
     "HAS_NET_CONNECTIONS_UNIX", "HAS_PROC_OPEN_FILES_PATH",
     "MACOS_11PLUS", "MACOS_12PLUS", "COVERAGE",
@@ -91,6 +95,7 @@ __all__ = [
     'check_ntuple_type_hints', 'check_fun_type_hints',
     # fs utils
     'chdir', 'safe_rmpath', 'create_py_exe', 'create_c_exe', 'get_testfn',
+    'write_tree',
     # os
     'get_winver', 'kernel_version', 'is_busybox',
     # sync primitives
@@ -187,9 +192,12 @@ ROOT_DIR = os.environ.get("PSUTIL_ROOT_DIR") or str(
 
 # --- support
 
+HAS_CPU_FREQ_TIMES = hasattr(psutil, "cpu_freq_times")
+HAS_DISK_IO_STATS = hasattr(psutil, "disk_io_stats")
 HAS_HEAP_INFO = hasattr(psutil, "heap_info")
 HAS_NET_CONNECTIONS_UNIX = POSIX and not SUNOS
 HAS_NET_IO_COUNTERS = hasattr(psutil, "net_io_counters")
+HAS_OPEN_FILES = hasattr(psutil, "open_files")
 HAS_SENSORS_BATTERY = hasattr(psutil, "sensors_battery")
 HAS_SENSORS_FANS = hasattr(psutil, "sensors_fans")
 HAS_SENSORS_TEMPERATURES = hasattr(psutil, "sensors_temperatures")
@@ -202,7 +210,9 @@ HAS_PROC_IONICE = hasattr(psutil.Process, "ionice")
 HAS_PROC_MEMORY_FOOTPRINT = hasattr(psutil.Process, "memory_footprint")
 HAS_PROC_MEMORY_MAPS = hasattr(psutil.Process, "memory_maps")
 HAS_PROC_RLIMIT = hasattr(psutil.Process, "rlimit")
+HAS_PROC_NUM_FDS_BY_KIND = hasattr(psutil.Process, "num_fds_by_kind")
 HAS_PROC_THREADS = hasattr(psutil.Process, "threads")
+HAS_PROC_THREADS_INFO = hasattr(psutil.Process, "threads_info")
 HAS_PROC_OPEN_FILES_PATH = not (NETBSD or OPENBSD)
 
 SKIP_SYSCONS = (MACOS or AIX) and os.getuid() != 0
@@ -930,6 +940,26 @@ def chdir(dirname):
         os.chdir(curdir)
 
 
+def write_tree(root, files):
+    """Create the files in the {"path/relative/to/root": content} dict
+    *files* (content being bytes or str, or None for an empty dir)
+    under *root*, which is created too. Used to emulate /proc and /sys
+    trees: most of them are read from C, so mocking open() wouldn't
+    work.
+    """
+    os.makedirs(root, exist_ok=True)
+    for relpath, content in files.items():
+        path = os.path.join(root, relpath)
+        if content is None:
+            os.makedirs(path, exist_ok=True)
+            continue
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        mode = "w" if isinstance(content, str) else "wb"
+        with open(path, mode) as f:
+            f.write(content)
+    return root
+
+
 def create_py_exe(path):
     """Create a Python executable file in the given location."""
     assert not os.path.exists(path), path
@@ -1291,6 +1321,10 @@ class process_namespace:
         getters += [('gids', (), {})]
         getters += [('terminal', (), {})]
         getters += [('num_fds', (), {})]
+    if HAS_PROC_NUM_FDS_BY_KIND:
+        getters += [('num_fds_by_kind', (), {})]
+    if HAS_PROC_THREADS_INFO:
+        getters += [('threads_info', (), {})]
     if HAS_PROC_IO_COUNTERS:
         getters += [('io_counters', (), {})]
     if HAS_PROC_IONICE:
@@ -1420,6 +1454,16 @@ class system_namespace:
     if HAS_CPU_FREQ:
         getters += [('cpu_freq', (), {'percpu': False})]
         getters += [('cpu_freq', (), {'percpu': True})]
+    if HAS_CPU_FREQ_TIMES:
+        getters += [('cpu_freq_times', (), {'percpu': False})]
+        getters += [('cpu_freq_times', (), {'percpu': True})]
+    if POSIX:
+        getters += [('disk_usage_many', (), {'timeout': 5})]
+    if HAS_DISK_IO_STATS:
+        getters += [('disk_io_stats', (), {'perdisk': False})]
+    if HAS_OPEN_FILES:
+        getters += [('open_files', (), {})]
+        getters += [('disk_io_stats', (), {'perdisk': True})]
     if HAS_SENSORS_TEMPERATURES:
         getters += [('sensors_temperatures', (), {})]
     if HAS_SENSORS_FANS:
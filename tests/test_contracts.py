@@ -257,6 +257,18 @@ class TestAvailSystemAPIs(PsutilTestCase):
             LINUX or MACOS or WINDOWS or FREEBSD or OPENBSD
         )
 
+    def test_cpu_freq_times(self):
+        assert hasattr(psutil, "cpu_freq_times") == LINUX
+
+    def test_disk_io_stats(self):
+        assert hasattr(psutil, "disk_io_stats") == LINUX
+
+    def test_disk_usage_many(self):
+        assert hasattr(psutil, "disk_usage_many") == POSIX
+
+    def test_open_files(self):
+        assert hasattr(psutil, "open_files") == LINUX
+
     def test_sensors_temperatures(self):
         assert hasattr(psutil, "sensors_temperatures") == (LINUX or FREEBSD)
 
@@ -318,9 +330,15 @@ class TestAvailProcessAPIs(PsutilTestCase):
     def test_num_fds(self):
         assert hasattr(psutil.Process, "num_fds") == POSIX
 
+    def test_num_fds_by_kind(self):
+        assert hasattr(psutil.Process, "num_fds_by_kind") == LINUX
+
     def test_num_handles(self):
         assert hasattr(psutil.Process, "num_handles") == WINDOWS
 
+    def test_threads_info(self):
+        assert hasattr(psutil.Process, "threads_info") == LINUX
+
     def test_cpu_affinity(self):
         assert hasattr(psutil.Process, "cpu_affinity") == (
             LINUX or WINDOWS or FREEBSD
@@ -383,12 +401,54 @@ class TestSystemAPITypes(PsutilTestCase):
             return pytest.skip("cpu_freq() returns None")
         self.assert_ntuple_of_nums(psutil.cpu_freq(), type_=(float, int))
 
+    @skipif(not LINUX, reason="LINUX only")
+    def test_cpu_freq_times(self):
+        for freqs in [psutil.cpu_freq_times()] + psutil.cpu_freq_times(
+            percpu=True
+        ):
+            assert isinstance(freqs, dict)
+            for freq, secs in freqs.items():
+                assert isinstance(freq, float)
+                assert isinstance(secs, float)
+
     def test_disk_io_counters(self):
         # Duplicate of test_system.py. Keep it anyway.
         for k, v in psutil.disk_io_counters(perdisk=True).items():
             assert isinstance(k, str)
             self.assert_ntuple_of_nums(v, type_=int)
 
+    @skipif(not LINUX, reason="LINUX only")
+    def test_disk_io_stats(self):
+        for k, v in psutil.disk_io_stats(perdisk=True).items():
+            assert isinstance(k, str)
+            self.assert_ntuple_of_nums(v, type_=float)
+        ret = psutil.disk_io_stats()
+        if ret is not None:
+            self.assert_ntuple_of_nums(ret, type_=float)
+
+    @skipif(not POSIX, reason="POSIX only")
+    def test_disk_usage_many(self):
+        for k, v in psutil.disk_usage_many(timeout=5).items():
+            assert isinstance(k, str)
+            if not isinstance(v, Exception):
+                self.assert_ntuple_of_nums(v, type_=(int, float))
+                assert isinstance(v.total, int)
+                assert isinstance(v.inodes_total, int)
+                assert isinstance(v.percent, float)
+                assert isinstance(v.inodes_percent, float)
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_open_files(self):
+        for nt in psutil.open_files():
+            assert isinstance(nt.pid, int)
+            assert isinstance(nt.fd, int)
+            assert isinstance(nt.path, str)
+            assert isinstance(nt.kind, str)
+            assert isinstance(nt.inode, int)
+            assert isinstance(nt.position, int)
+            assert isinstance(nt.mode, str)
+            assert isinstance(nt.flags, int)
+
     def test_disk_partitions(self):
         # Duplicate of test_system.py. Keep it anyway.
         for disk in psutil.disk_partitions():
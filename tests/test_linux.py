@@ -9,7 +9,6 @@
 import collections
 import contextlib
 import errno
-import glob
 import io
 import os
 import platform
@@ -18,6 +17,7 @@ import shutil
 import socket
 import struct
 import textwrap
+import threading
 import time
 import warnings
 from unittest import mock
@@ -26,7 +26,6 @@ import psutil
 from psutil import LINUX
 from psutil import _psutil
 
-from . import AARCH64
 from . import GLOBAL_TIMEOUT
 from . import HAS_BATTERY
 from . import HAS_CPU_FREQ
@@ -47,6 +46,7 @@ from . import serial
 from . import sh
 from . import skip_on_not_implemented
 from . import skipif
+from . import write_tree
 
 if LINUX:
     from psutil._pslinux import CLOCK_TICKS
@@ -815,9 +815,21 @@ class TestCpuCountCores(LinuxTestCase):
 
 
 class TestCpuFreq(LinuxTestCase):
+    @contextlib.contextmanager
+    def fake_tree(self, files, cpuinfo=b""):
+        """Create a fake /sys/devices/system/cpu tree (see write_tree())
+        plus a fake /proc/cpuinfo, and make psutil use them.
+        """
+        root = self.get_testfn()
+        write_tree(f"{root}/sys", files)
+        write_tree(f"{root}/proc", {"cpuinfo": cpuinfo})
+        with mock.patch("psutil._pslinux.CPU_SYSFS_PATH", f"{root}/sys"):
+            with mock.patch("psutil.PROCFS_PATH", f"{root}/proc"):
+                yield f"{root}/sys"
+
     def test_cpuinfo_freq_ppc(self):
         content = b"clock\t\t: 2750.000000MHz\nclock\t\t: 2500.000000MHz\n"
-        with mock_open_content({"/proc/cpuinfo": content}):
+        with self.fake_tree({}, cpuinfo=content):
             assert _cpu_get_cpuinfo_freq() == [2750.0, 2500.0]
 
     def test_cpuinfo_freq_s390x(self):
@@ -825,275 +837,191 @@ class TestCpuFreq(LinuxTestCase):
             b"cpu MHz dynamic : 5200\ncpu MHz static  : 5000\n"
             b"cpu MHz dynamic : 5100\ncpu MHz static  : 5000\n"
         )
-        with mock_open_content({"/proc/cpuinfo": content}):
+        with self.fake_tree({}, cpuinfo=content):
             assert _cpu_get_cpuinfo_freq() == [5200.0, 5100.0]
 
-    @skipif(not HAS_CPU_FREQ, reason="not supported")
-    @skipif(AARCH64, reason="aarch64 does not always expose frequency")
     def test_emulate_use_second_file(self):
         # https://github.com/giampaolo/psutil/issues/981
-        def path_exists_mock(path):
-            if path.startswith("/sys/devices/system/cpu/cpufreq/policy"):
-                return False
-            else:
-                return orig_exists(path)
-
-        orig_exists = os.path.exists
-        with mock.patch(
-            "os.path.exists", side_effect=path_exists_mock, create=True
-        ):
-            assert psutil.cpu_freq()
+        files = {
+            "cpu0/cpufreq/scaling_cur_freq": b"500000",
+            "cpu0/cpufreq/scaling_min_freq": b"600000",
+            "cpu0/cpufreq/scaling_max_freq": b"700000",
+        }
+        with self.fake_tree(files):
+            assert psutil.cpu_freq() == (500.0, 600.0, 700.0)
 
-    @skipif(not HAS_CPU_FREQ, reason="not supported")
-    @skipif(not CPUINFO_HAS_MHZ, reason="no 'cpu MHz' in /proc/cpuinfo")
     def test_emulate_use_cpuinfo(self):
         # Emulate a case where /sys/devices/system/cpu/cpufreq* does not
         # exist and /proc/cpuinfo is used instead.
-        def path_exists_mock(path):
-            if path.startswith('/sys/devices/system/cpu/'):
-                return False
-            else:
-                return os_path_exists(path)
-
-        os_path_exists = os.path.exists
-        try:
-            with mock.patch("os.path.exists", side_effect=path_exists_mock):
-                reload_module(psutil._pslinux)
-                ret = psutil.cpu_freq()
-                assert ret, ret
-                assert ret.max == 0.0
-                assert ret.min == 0.0
-                for freq in psutil.cpu_freq(percpu=True):
-                    assert freq.max == 0.0
-                    assert freq.min == 0.0
-        finally:
-            reload_module(psutil._pslinux)
-            reload_module(psutil)
+        cpuinfo = b"cpu MHz\t\t: 500\ncpu MHz\t\t: 700\n"
+        with self.fake_tree({}, cpuinfo=cpuinfo):
+            ret = psutil.cpu_freq()
+            assert ret == (600.0, 0.0, 0.0)
+            for freq in psutil.cpu_freq(percpu=True):
+                assert freq.max == 0.0
+                assert freq.min == 0.0
 
-    @skipif(not HAS_CPU_FREQ, reason="not supported")
     def test_emulate_data(self):
-        def open_mock(name, *args, **kwargs):
-            if name.endswith('/scaling_cur_freq') and name.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy"
-            ):
-                return io.BytesIO(b"500000")
-            elif name.endswith('/scaling_min_freq') and name.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy"
-            ):
-                return io.BytesIO(b"600000")
-            elif name.endswith('/scaling_max_freq') and name.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy"
-            ):
-                return io.BytesIO(b"700000")
-            elif name == '/proc/cpuinfo':
-                return io.BytesIO(b"cpu MHz     : 500")
-            else:
-                return orig_open(name, *args, **kwargs)
-
-        orig_open = open
-        with mock.patch("builtins.open", side_effect=open_mock):
-            with mock.patch('os.path.exists', return_value=True):
-                freq = psutil.cpu_freq()
-                assert freq.current == 500.0
-                # when /proc/cpuinfo is used min and max frequencies are not
-                # available and are set to 0.
-                if freq.min != 0.0:
-                    assert freq.min == 600.0
-                if freq.max != 0.0:
-                    assert freq.max == 700.0
+        files = {
+            "cpufreq/policy0/scaling_cur_freq": b"500000",
+            "cpufreq/policy0/scaling_min_freq": b"600000",
+            "cpufreq/policy0/scaling_max_freq": b"700000",
+        }
+        with self.fake_tree(files, cpuinfo=b"cpu MHz     : 500"):
+            freq = psutil.cpu_freq()
+            assert freq.current == 500.0
+            assert freq.min == 600.0
+            assert freq.max == 700.0
 
-    @skipif(not HAS_CPU_FREQ, reason="not supported")
     def test_emulate_multi_cpu(self):
-        def open_mock(name, *args, **kwargs):
-            n = name
-            if n.endswith('/scaling_cur_freq') and n.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy0"
-            ):
-                return io.BytesIO(b"100000")
-            elif n.endswith('/scaling_min_freq') and n.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy0"
-            ):
-                return io.BytesIO(b"200000")
-            elif n.endswith('/scaling_max_freq') and n.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy0"
-            ):
-                return io.BytesIO(b"300000")
-            elif n.endswith('/scaling_cur_freq') and n.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy1"
-            ):
-                return io.BytesIO(b"400000")
-            elif n.endswith('/scaling_min_freq') and n.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy1"
-            ):
-                return io.BytesIO(b"500000")
-            elif n.endswith('/scaling_max_freq') and n.startswith(
-                "/sys/devices/system/cpu/cpufreq/policy1"
-            ):
-                return io.BytesIO(b"600000")
-            elif n.endswith('/affected_cpus'):
-                return io.BytesIO(b"0" if "/policy0/" in n else b"1")
-            elif name == '/proc/cpuinfo':
-                return io.BytesIO(b"cpu MHz     : 100\ncpu MHz     : 400")
-            else:
-                return orig_open(name, *args, **kwargs)
-
-        def glob_mock(pattern):
-            if pattern == "/sys/devices/system/cpu/cpufreq/policy[0-9]*":
-                return list(policies)
-            return orig_glob(pattern)
-
-        policies = [
-            f"/sys/devices/system/cpu/cpufreq/policy{n}" for n in range(2)
-        ]
-        orig_glob = glob.glob
-        orig_open = open
-        with mock.patch("builtins.open", side_effect=open_mock):
-            with mock.patch('os.path.exists', return_value=True):
-                with mock.patch("glob.glob", side_effect=glob_mock):
-                    # min and max are 0 when the /proc/cpuinfo-only
-                    # implementation is in use, e.g. in a container
-                    # with no /sys/devices/system/cpu/cpufreq.
-                    freq = psutil.cpu_freq(percpu=True)
-                    assert freq[0].current == 100.0
-                    if freq[0].min != 0.0:
-                        assert freq[0].min == 200.0
-                    if freq[0].max != 0.0:
-                        assert freq[0].max == 300.0
-                    assert freq[1].current == 400.0
-                    if freq[1].min != 0.0:
-                        assert freq[1].min == 500.0
-                    if freq[1].max != 0.0:
-                        assert freq[1].max == 600.0
+        files = {
+            "cpufreq/policy0/affected_cpus": b"0",
+            "cpufreq/policy0/scaling_cur_freq": b"100000",
+            "cpufreq/policy0/scaling_min_freq": b"200000",
+            "cpufreq/policy0/scaling_max_freq": b"300000",
+            "cpufreq/policy1/affected_cpus": b"1",
+            "cpufreq/policy1/scaling_cur_freq": b"400000",
+            "cpufreq/policy1/scaling_min_freq": b"500000",
+            "cpufreq/policy1/scaling_max_freq": b"600000",
+        }
+        cpuinfo = b"cpu MHz     : 100\ncpu MHz     : 400"
+        with self.fake_tree(files, cpuinfo=cpuinfo):
+            freq = psutil.cpu_freq(percpu=True)
+            assert freq[0] == (100.0, 200.0, 300.0)
+            assert freq[1] == (400.0, 500.0, 600.0)
+        # cpuinfo does not match the number of CPUs: read sysfs
+        with self.fake_tree(files, cpuinfo=b"cpu MHz     : 999"):
+            freq = psutil.cpu_freq(percpu=True)
+            assert freq[0] == (100.0, 200.0, 300.0)
+            assert freq[1] == (400.0, 500.0, 600.0)
 
-    @skipif(not HAS_CPU_FREQ, reason="not supported")
     def test_emulate_shared_policy(self):
         # A single policy governing 4 CPUs must yield 4 entries, see:
         # https://github.com/giampaolo/psutil/issues/2512
-        def open_mock(name, *args, **kwargs):
-            if name.endswith('/affected_cpus'):
-                return io.BytesIO(b"0 1 2 3")
-            elif name.endswith('/scaling_cur_freq'):
-                return io.BytesIO(b"100000")
-            elif name.endswith('/scaling_min_freq'):
-                return io.BytesIO(b"200000")
-            elif name.endswith('/scaling_max_freq'):
-                return io.BytesIO(b"300000")
-            elif name == '/proc/cpuinfo':
-                return io.BytesIO(b"")
-            return orig_open(name, *args, **kwargs)
-
-        def glob_mock(pattern):
-            if pattern == "/sys/devices/system/cpu/cpufreq/policy[0-9]*":
-                return ["/sys/devices/system/cpu/cpufreq/policy0"]
-            return orig_glob(pattern)
-
-        def exists_mock(path):
-            # Make sure the sysfs-based implementation is used.
-            if path.startswith("/sys/devices/system/cpu/"):
-                return True
-            return orig_exists(path)
-
-        orig_exists = os.path.exists
-        orig_glob = glob.glob
-        orig_open = open
-        try:
-            with mock.patch("os.path.exists", side_effect=exists_mock):
-                reload_module(psutil._pslinux)
-                with mock.patch("glob.glob", side_effect=glob_mock):
-                    with mock.patch("builtins.open", side_effect=open_mock):
-                        freq = psutil.cpu_freq(percpu=True)
-            assert len(freq) == 4
-            for nt in freq:
-                assert nt == (100.0, 200.0, 300.0)
-        finally:
-            reload_module(psutil._pslinux)
-            reload_module(psutil)
+        files = {
+            "cpufreq/policy0/affected_cpus": b"0 1 2 3",
+            "cpufreq/policy0/scaling_cur_freq": b"100000",
+            "cpufreq/policy0/scaling_min_freq": b"200000",
+            "cpufreq/policy0/scaling_max_freq": b"300000",
+        }
+        with self.fake_tree(files):
+            freq = psutil.cpu_freq(percpu=True)
+        assert len(freq) == 4
+        for nt in freq:
+            assert nt == (100.0, 200.0, 300.0)
 
-    @skipif(not HAS_CPU_FREQ, reason="not supported")
     def test_emulate_no_scaling_cur_freq_file(self):
         # See: https://github.com/giampaolo/psutil/issues/1071
-        def open_mock(name, *args, **kwargs):
-            if name.endswith('/scaling_cur_freq'):
-                raise FileNotFoundError
-            if name.endswith('/cpuinfo_cur_freq'):
-                return io.BytesIO(b"200000")
-            elif name == '/proc/cpuinfo':
-                return io.BytesIO(b"cpu MHz     : 200")
-            else:
-                return orig_open(name, *args, **kwargs)
-
-        orig_open = open
-        with mock.patch("builtins.open", side_effect=open_mock):
-            with mock.patch('os.path.exists', return_value=True):
-                with mock.patch(
-                    'psutil._pslinux.cpu_count_logical', return_value=1
-                ):
-                    freq = psutil.cpu_freq()
-                    assert freq.current == 200
+        files = {
+            "cpufreq/policy0/cpuinfo_cur_freq": b"200000",
+            "cpufreq/policy0/scaling_min_freq": b"100000",
+            "cpufreq/policy0/scaling_max_freq": b"300000",
+        }
+        with self.fake_tree(files):
+            freq = psutil.cpu_freq()
+            assert freq.current == 200
+
+    def test_emulate_no_cur_freq_file(self):
+        files = {
+            "cpufreq/policy0/scaling_min_freq": b"100000",
+            "cpufreq/policy0/scaling_max_freq": b"300000",
+        }
+        with self.fake_tree(files):
+            with pytest.raises(NotImplementedError):
+                psutil.cpu_freq()
 
-    @skipif(not HAS_CPU_FREQ, reason="not supported")
     def test_emulate_offline_cpus(self):
         # Offline CPU cores must not be taken into account, else they
         # drag down the average frequency. See:
         # https://github.com/giampaolo/psutil/issues/2628
-        policies = [
-            f"/sys/devices/system/cpu/cpufreq/policy{n}" for n in range(4)
-        ]
+        files = {}
+        for n in range(4):
+            files[f"cpufreq/policy{n}/affected_cpus"] = str(n).encode()
+        # Only CPUs 0 and 1 are online; offline cores have no
+        # frequency files.
+        for n, cur in ((0, b"200000"), (1, b"400000")):
+            files[f"cpufreq/policy{n}/scaling_cur_freq"] = cur
+            files[f"cpufreq/policy{n}/scaling_min_freq"] = b"100000"
+            files[f"cpufreq/policy{n}/scaling_max_freq"] = b"300000"
+        files["cpu2/online"] = b"0\n"
+        files["cpu3/online"] = b"0\n"
+        cpuinfo = b"cpu MHz\t: 200\ncpu MHz\t: 400"
+        with self.fake_tree(files, cpuinfo=cpuinfo):
+            percpu = psutil.cpu_freq(percpu=True)
+            assert len(percpu) == 2
+            assert [f.current for f in percpu] == [200.0, 400.0]
+
+            freq = psutil.cpu_freq()
+            assert freq.current == 300.0
+            assert freq.min == 100.0
+            assert freq.max == 300.0
+
+    def test_topology_cache(self):
+        files = {
+            "online": b"0-1\n",
+            "cpufreq/policy0/affected_cpus": b"0 1",
+            "cpufreq/policy0/scaling_cur_freq": b"100000",
+            "cpufreq/policy0/scaling_min_freq": b"200000",
+            "cpufreq/policy0/scaling_max_freq": b"300000",
+        }
 
-        def exists_mock(path):
-            # Make sure the sysfs-based implementation is used.
-            if path.startswith("/sys/devices/system/cpu/"):
-                return True
-            return orig_exists(path)
+        def write(relpath, content):
+            with open(os.path.join(root, relpath), "wb") as f:
+                f.write(content)
+
+        with self.fake_tree(files) as root:
+            assert psutil.cpu_freq() == (100.0, 200.0, 300.0)
+            # the current frequency is always re-read, min / max and
+            # the policy -> CPUs map are not
+            write("cpufreq/policy0/scaling_cur_freq", b"150000")
+            write("cpufreq/policy0/scaling_max_freq", b"400000")
+            write("cpufreq/policy0/affected_cpus", b"0")
+            assert psutil.cpu_freq() == (150.0, 200.0, 300.0)
+            assert len(psutil.cpu_freq(percpu=True)) == 2
+            # a CPU going offline invalidates the cache
+            write("online", b"0\n")
+            assert psutil.cpu_freq(percpu=True) == [(150.0, 200.0, 400.0)]
+            # ...and so does cache_clear()
+            write("cpufreq/policy0/scaling_max_freq", b"500000")
+            assert psutil.cpu_freq() == (150.0, 200.0, 400.0)
+            psutil.cpu_freq.cache_clear()
+            assert psutil.cpu_freq() == (150.0, 200.0, 500.0)
+
+    def test_cpu_freq_times(self):
+        ticks = psutil._pslinux.CLOCK_TICKS
+        files = {
+            "cpufreq/policy0/affected_cpus": b"0 1",
+            "cpufreq/policy0/scaling_cur_freq": b"800000",
+            "cpufreq/policy0/stats/time_in_state": (
+                f"1600000 {ticks * 2}\n800000 {ticks * 4}\n".encode()
+            ),
+            "cpufreq/policy2/affected_cpus": b"2",
+            "cpufreq/policy2/scaling_cur_freq": b"800000",
+        }
+        with self.fake_tree(files):
+            percpu = psutil.cpu_freq_times(percpu=True)
+            assert percpu == [
+                {800.0: 4.0, 1600.0: 2.0},
+                {800.0: 4.0, 1600.0: 2.0},
+                {},  # no stats
+            ]
+            assert list(percpu[0]) == [800.0, 1600.0]
+            # policy0 is shared by 2 CPUs but counted once
+            assert psutil.cpu_freq_times() == {800.0: 4.0, 1600.0: 2.0}
 
-        def glob_mock(pattern):
-            if pattern == "/sys/devices/system/cpu/cpufreq/policy[0-9]*":
-                return list(policies)
-            return orig_glob(pattern)
+    def test_cpu_freq_times_no_cpufreq(self):
+        with self.fake_tree({}):
+            assert psutil.cpu_freq_times(percpu=True) == []
+            assert psutil.cpu_freq_times() == {}
 
-        def open_mock(name, *args, **kwargs):
-            # Only CPUs 0 and 1 are online; 2 and 3 are offline.
-            if name == '/proc/cpuinfo':
-                return io.BytesIO(b"cpu MHz\t: 200\ncpu MHz\t: 400")
-            elif name.endswith('/affected_cpus'):
-                num = re.search(r"/policy(\d+)/", name).group(1)
-                return io.BytesIO(num.encode())
-            elif "/policy0/" in name or "/policy1/" in name:
-                if name.endswith('/scaling_cur_freq'):
-                    cur = b"200000" if "/policy0/" in name else b"400000"
-                    return io.BytesIO(cur)
-                elif name.endswith('/scaling_min_freq'):
-                    return io.BytesIO(b"100000")
-                elif name.endswith('/scaling_max_freq'):
-                    return io.BytesIO(b"300000")
-            elif "/policy2/" in name or "/policy3/" in name:
-                # Offline cores have no frequency files.
-                if name.endswith(('/scaling_cur_freq', '/cpuinfo_cur_freq')):
-                    raise FileNotFoundError
-            elif name.endswith('/online'):
-                # CPUs 2 and 3 are offline.
-                return io.StringIO("0\n")
-            return orig_open(name, *args, **kwargs)
-
-        orig_exists = os.path.exists
-        orig_glob = glob.glob
-        orig_open = open
-        try:
-            with mock.patch("os.path.exists", side_effect=exists_mock):
-                reload_module(psutil._pslinux)
-                with mock.patch("glob.glob", side_effect=glob_mock):
-                    with mock.patch("builtins.open", side_effect=open_mock):
-                        percpu = psutil.cpu_freq(percpu=True)
-                        assert len(percpu) == 2
-                        assert [f.current for f in percpu] == [200.0, 400.0]
-
-                        freq = psutil.cpu_freq()
-                        assert freq.current == 300.0
-                        assert freq.min == 100.0
-                        assert freq.max == 300.0
-        finally:
-            reload_module(psutil._pslinux)
-            reload_module(psutil)
+    @skipif(not HAS_CPU_FREQ, reason="not supported")
+    def test_cpu_freq_times_real(self):
+        ls = psutil.cpu_freq_times(percpu=True)
+        assert len(ls) in {0, len(psutil.cpu_freq(percpu=True))}
+        for freqs in ls:
+            for freq, secs in freqs.items():
+                assert freq > 0
+                assert secs >= 0
 
 
 class TestCpuTimes(LinuxTestCase):
@@ -1257,6 +1185,87 @@ class TestNetIfAddrs(LinuxTestCase):
         assert len(nics) == found
 
 
+class TestNetIfAddrsCached(LinuxTestCase):
+    def setUp(self):
+        super().setUp()
+        psutil.net_if_addrs.cache_clear()
+
+    def tearDown(self):
+        psutil.net_if_addrs.cache_clear()
+        super().tearDown()
+
+    def test_same_as_uncached(self):
+        assert psutil.net_if_addrs(cached=True) == psutil.net_if_addrs()
+
+    def test_no_change(self):
+        ret = psutil.net_if_addrs(cached=True)
+        with mock.patch(
+            "psutil._pslinux._psutil.net_if_notify_drain", return_value=False
+        ):
+            with mock.patch("psutil._psplatform.net_if_addrs") as m:
+                assert psutil.net_if_addrs(cached=True) == ret
+                assert not m.called
+
+    def test_change(self):
+        psutil.net_if_addrs(cached=True)
+        with mock.patch(
+            "psutil._pslinux._psutil.net_if_notify_drain", return_value=True
+        ):
+            with mock.patch(
+                "psutil._psplatform.net_if_addrs", return_value=[]
+            ) as m:
+                assert psutil.net_if_addrs(cached=True) == {}
+                assert m.called
+
+    def test_cache_clear(self):
+        psutil.net_if_addrs(cached=True)
+        psutil.net_if_addrs.cache_clear()
+        with mock.patch(
+            "psutil._pslinux._psutil.net_if_notify_drain", return_value=False
+        ):
+            with mock.patch(
+                "psutil._psplatform.net_if_addrs", return_value=[]
+            ) as m:
+                assert psutil.net_if_addrs(cached=True) == {}
+                assert m.called
+
+    def test_fork(self):
+        # A forked child must not share the notifications socket with
+        # its parent.
+        psutil.net_if_addrs(cached=True)
+        with mock.patch(
+            "psutil._pslinux.os.getpid", return_value=os.getpid() + 1
+        ):
+            with mock.patch(
+                "psutil._pslinux._psutil.net_if_notify_open",
+                side_effect=_psutil.net_if_notify_open,
+            ) as m:
+                assert psutil._psplatform.net_if_addrs_changed()
+                assert m.called
+
+    def test_returns_copy(self):
+        ret = psutil.net_if_addrs(cached=True)
+        ret.clear()
+        assert psutil.net_if_addrs(cached=True)
+
+    def test_real_change(self):
+        def lo_addrs():
+            return [x.address for x in psutil.net_if_addrs(cached=True)["lo"]]
+
+        ip = "127.0.0.77"
+        assert ip not in lo_addrs()
+        try:
+            sh(f"ip addr add {ip}/32 dev lo")
+        except RuntimeError as err:
+            return pytest.skip(f"can't add IP address: {err}")
+        try:
+            # notifications are asynchronous
+            call_until(lambda: ip in lo_addrs())
+        finally:
+            sh(f"ip addr del {ip}/32 dev lo")
+        call_until(lambda: ip not in lo_addrs())
+
+
 class TestNetIfStats(LinuxTestCase):
     @requires_cli("ifconfig")
     def test_against_ifconfig(self):
@@ -1307,6 +1316,36 @@ class TestNetIfStats(LinuxTestCase):
             return pytest.fail("no matches were found")
 
 
+class TestNetIfStatsNetlink(LinuxTestCase):
+    def test_against_ioctl(self):
+        # netlink dumps vs. per-NIC ioctls
+        for name, flags, mtu, duplex, speed in _psutil.net_if_stats_netlink():
+            try:
+                assert mtu == _psutil.net_if_mtu(name)
+                assert flags == _psutil.net_if_flags(name)
+                assert [duplex, speed] == _psutil.net_if_duplex_speed(name)
+            except OSError as err:
+                if err.errno != errno.ENODEV:
+                    raise
+
+    def test_netlink_failure(self):
+        # E.g. netlink forbidden by seccomp: fall back on ioctls.
+        with mock.patch(
+            "psutil._pslinux._psutil.net_if_stats_netlink",
+            side_effect=PermissionError,
+        ) as m:
+            ret = psutil.net_if_stats()
+            assert m.called
+        assert ret == psutil.net_if_stats()
+
+    def test_procfs_path(self):
+        # A custom PROCFS_PATH takes the NIC names from its net/dev.
+        with mock.patch("psutil._pslinux._psutil.net_if_stats_netlink") as m:
+            with mock.patch("psutil.PROCFS_PATH", "/proc/self"):
+                psutil.net_if_stats()
+            assert not m.called
+
+
 class TestNetIoCounters(LinuxTestCase):
     @requires_cli("ifconfig")
     @retry_on_failure
@@ -1362,6 +1401,60 @@ class TestNetIoCounters(LinuxTestCase):
             assert abs(stats.dropout - ifconfig_ret['dropout']) < 10
 
 
+class TestNetIoCountersNetlink(LinuxTestCase):
+    def test_against_procfs(self):
+        # A custom PROCFS_PATH makes net_io_counters() parse
+        # /proc/net/dev instead of using rtnetlink.
+        with mock.patch("psutil.PROCFS_PATH", "/proc/self"):
+            procfs = psutil.net_io_counters(pernic=True, nowrap=False)
+        netlink = psutil.net_io_counters(pernic=True, nowrap=False)
+        assert set(netlink) == set(procfs)
+        for name, nt in netlink.items():
+            for a, b in zip(nt, procfs[name]):
+                assert abs(a - b) < 1024 * 1024
+
+    def test_filters(self):
+        rawlist = _psutil.net_io_counters_netlink("", 0)
+        assert rawlist
+        for name, *_ in rawlist:
+            ret = _psutil.net_io_counters_netlink(name, 0)
+            assert name in [x[0] for x in ret]
+            assert all(x[0].startswith(name) for x in ret)
+            ifindex = socket.if_nametoindex(name)
+            ret = _psutil.net_io_counters_netlink("", ifindex)
+            assert [x[0] for x in ret] == [name]
+        assert _psutil.net_io_counters_netlink("?!?", 0) == []
+        assert _psutil.net_io_counters_netlink("", 2**31 - 1) == []
+
+    def test_emulate_filters_procfs(self):
+        content = textwrap.dedent("""\
+            Inter-|   Receive
+             face |bytes    packets errs drop fifo frame compressed
+                lo: 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16
+              eth0: 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16
+              eth1: 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16
+            """)
+        with mock.patch("psutil.PROCFS_PATH", "/fake"):
+            with mock_open_content({"/fake/net/dev": content}):
+                ret = psutil.net_io_counters(pernic=True, prefix="eth")
+                assert set(ret) == {"eth0", "eth1"}
+                assert ret["eth0"].bytes_sent == 9
+                assert ret["eth0"].bytes_recv == 1
+                with mock.patch("socket.if_indextoname", return_value="eth1"):
+                    ret = psutil.net_io_counters(pernic=True, ifindex=3)
+                assert set(ret) == {"eth1"}
+
+    def test_netlink_failure(self):
+        # E.g. netlink forbidden by seccomp: fall back on /proc/net/dev.
+        with mock.patch(
+            "psutil._psplatform._psutil.net_io_counters_netlink",
+            side_effect=PermissionError,
+        ) as m:
+            ret = psutil.net_io_counters(pernic=True, nowrap=False)
+            assert m.called
+        assert set(ret) == set(psutil.net_io_counters(pernic=True))
+
+
 class TestNetConnections(LinuxTestCase):
     @mock.patch('psutil._pslinux.socket.inet_ntop', side_effect=ValueError)
     @mock.patch('psutil._pslinux.supports_ipv6', return_value=False)
@@ -1410,12 +1503,99 @@ class TestNetConnections(LinuxTestCase):
         assert ss_ports == psutil_ports
 
 
+class TestOpenFiles(LinuxTestCase):
+    def mine(self, **kwargs):
+        return [
+            x for x in psutil.open_files(**kwargs) if x.pid == os.getpid()
+        ]
+
+    def test_regular_file(self):
+        testfn = self.get_testfn()
+        with open(testfn, "w") as f:
+            f.write("xxx")
+            f.flush()
+            ls = self.mine(prefix=os.path.abspath(testfn))
+            assert len(ls) == 1
+            nt = ls[0]
+            assert nt.fd == f.fileno()
+            assert nt.kind == "file"
+            assert nt.inode == os.fstat(f.fileno()).st_ino
+            assert nt.position == 3
+            [popen] = [
+                x for x in psutil.Process().open_files() if x.fd == nt.fd
+            ]
+            assert (nt.path, nt.mode, nt.flags) == (
+                popen.path,
+                popen.mode,
+                popen.flags,
+            )
+            # inode filter
+            ls = self.mine(inode=nt.inode)
+            assert [x.fd for x in ls] == [nt.fd]
+
+    def test_deleted_file(self):
+        testfn = os.path.abspath(self.get_testfn())
+        with open(testfn, "w") as f:
+            os.remove(testfn)
+            [nt] = self.mine(prefix=testfn)
+            assert nt.fd == f.fileno()
+            assert nt.path == testfn
+
+    def test_kinds(self):
+        r, w = os.pipe()
+        try:
+            ls = self.mine(kind="pipe")
+            assert {r, w} <= {x.fd for x in ls}
+            assert all(x.kind == "pipe" for x in ls)
+            assert all(x.path.startswith("pipe:[") for x in ls)
+            assert {r, w}.isdisjoint(x.fd for x in self.mine(kind="file"))
+        finally:
+            os.close(r)
+            os.close(w)
+        with socket.socket() as sock:
+            ls = self.mine(kind=("socket", "eventfd"))
+            assert sock.fileno() in [x.fd for x in ls]
+        if hasattr(os, "eventfd"):
+            fd = os.eventfd(0)
+            try:
+                ls = self.mine(kind="eventfd")
+                assert [x.fd for x in ls if x.fd == fd] == [fd]
+                assert ls[0].path == "anon_inode:[eventfd]"
+            finally:
+                os.close(fd)
+
+    def test_all(self):
+        with open(__file__) as f:
+            ls = self.mine()
+            fds = {int(x) for x in os.listdir(f"/proc/{os.getpid()}/fd")}
+            assert f.fileno() in [x.fd for x in ls]
+        for nt in ls:
+            if nt.fd not in fds:
+                # used internally to walk /proc
+                assert nt.path.startswith("/proc"), nt
+        assert {x.kind for x in ls} <= set(psutil._pslinux.FD_KINDS)
+
+    def test_invalid_kind(self):
+        with pytest.raises(ValueError, match="invalid kind"):
+            psutil.open_files(kind="foo")
+        with pytest.raises(ValueError):
+            _psutil.open_files_scan("/proc", -1, None, -1, ["foo"])
+
+
 # =====================================================================
 # --- system disks
 # =====================================================================
 
 
 class TestDiskPartitions(LinuxTestCase):
+    def setUp(self):
+        super().setUp()
+        psutil.disk_partitions.cache_clear()
+
+    def tearDown(self):
+        psutil.disk_partitions.cache_clear()
+        super().tearDown()
+
     @skipif(not hasattr(os, 'statvfs'), reason="os.statvfs() not available")
     @skip_on_not_implemented
     def test_against_df(self):
@@ -1476,46 +1656,144 @@ class TestDiskPartitions(LinuxTestCase):
         finally:
             psutil.PROCFS_PATH = "/proc"
 
+    def test_mountinfo_vs_mounts(self):
+        # The mountinfo parser must rebuild the same fields (options
+        # included) the kernel shows in /proc/self/mounts.
+        assert _psutil.disk_partitions(
+            "/proc/self/mountinfo", True
+        ) == _psutil.disk_partitions("/proc/self/mounts")
+
+    def test_mountinfo_parser(self):
+        testfn = self.get_testfn()
+        with open(testfn, "w") as f:
+            f.write(
+                "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1"
+                " rw,errors=remount-ro\n"
+                "23 22 8:2 / /mnt/my\\040disk ro,noatime master:2"
+                " propagation_from:1 - vfat /dev/sd\\134b"
+                " rw,sync,fmask=22\n"
+                "24 22 0:5 / /tmp rw - tmpfs none rw\n"
+                "malformed line\n"
+            )
+        assert _psutil.disk_partitions(testfn, True) == [
+            ("/dev/sda1", "/", "ext4", "rw,relatime,errors=remount-ro"),
+            ("/dev/sd\\b", "/mnt/my disk", "vfat", "ro,sync,noatime,fmask=22"),
+            ("none", "/tmp", "tmpfs", "rw"),
+        ]
+
+    def test_cached(self):
+        with mock.patch(
+            "psutil._psplatform._psutil.mounts_changed", return_value=False
+        ):
+            with mock.patch.object(
+                _psutil, "disk_partitions", wraps=_psutil.disk_partitions
+            ) as m:
+                first = psutil.disk_partitions()
+                assert psutil.disk_partitions() == first
+                assert m.call_count == 1
+                # `all` is part of the cache key
+                psutil.disk_partitions(all=True)
+                assert m.call_count == 2
+                # results are copies
+                first.clear()
+                assert psutil.disk_partitions()
+                assert m.call_count == 2
+
+    def test_cache_invalidated(self):
+        psutil.disk_partitions()
+        with mock.patch(
+            "psutil._psplatform._psutil.mounts_changed", return_value=True
+        ) as m1:
+            with mock.patch.object(
+                _psutil, "disk_partitions", wraps=_psutil.disk_partitions
+            ) as m2:
+                psutil.disk_partitions()
+                assert m1.called
+                assert m2.call_count == 1
+
+    def test_mounts_changed(self):
+        fd = os.open("/proc/self/mountinfo", os.O_RDONLY)
+        try:
+            assert _psutil.mounts_changed(fd) is False
+        finally:
+            os.close(fd)
+        with pytest.raises(OSError):
+            _psutil.mounts_changed(fd)
+
 
 class TestDiskIoCounters(LinuxTestCase):
+    @contextlib.contextmanager
+    def fake_diskstats(self, content, is_storage_device=True):
+        """Make disk_io_counters() read `content` as /proc/diskstats."""
+        root = write_tree(self.get_testfn(), {"diskstats": content})
+        if callable(is_storage_device):
+            kw = dict(side_effect=is_storage_device)
+        else:
+            kw = dict(return_value=is_storage_device)
+        psutil.disk_io_counters.cache_clear()
+        try:
+            with mock.patch("psutil.PROCFS_PATH", root):
+                with mock.patch(
+                    'psutil._pslinux.is_storage_device', **kw
+                ) as m:
+                    yield m
+        finally:
+            psutil.disk_io_counters.cache_clear()
+
     def test_emulate_kernel_2_4(self):
         # Tests /proc/diskstats parsing format for 2.4 kernels, see:
         # https://github.com/giampaolo/psutil/issues/767
         content = "   3     0   1 hda 2 3 4 5 6 7 8 9 10 11 12"
-        with mock_open_content({'/proc/diskstats': content}):
-            with mock.patch(
-                'psutil._pslinux.is_storage_device', return_value=True
-            ):
-                ret = psutil.disk_io_counters(nowrap=False)
-                assert ret.read_count == 1
-                assert ret.read_merged_count == 2
-                assert ret.read_bytes == 3 * SECTOR_SIZE
-                assert ret.read_time == 4
-                assert ret.write_count == 5
-                assert ret.write_merged_count == 6
-                assert ret.write_bytes == 7 * SECTOR_SIZE
-                assert ret.write_time == 8
-                assert ret.busy_time == 10
+        with self.fake_diskstats(content):
+            ret = psutil.disk_io_counters(nowrap=False)
+            assert ret.read_count == 1
+            assert ret.read_merged_count == 2
+            assert ret.read_bytes == 3 * SECTOR_SIZE
+            assert ret.read_time == 4
+            assert ret.write_count == 5
+            assert ret.write_merged_count == 6
+            assert ret.write_bytes == 7 * SECTOR_SIZE
+            assert ret.write_time == 8
+            assert ret.busy_time == 10
+            assert ret.weighted_time == 11
+            assert ret.discard_count == 0
 
     def test_emulate_kernel_2_6_full(self):
         # Tests /proc/diskstats parsing format for 2.6 kernels,
         # lines reporting all metrics:
         # https://github.com/giampaolo/psutil/issues/767
         content = "   3    0   hda 1 2 3 4 5 6 7 8 9 10 11"
-        with mock_open_content({"/proc/diskstats": content}):
-            with mock.patch(
-                'psutil._pslinux.is_storage_device', return_value=True
-            ):
-                ret = psutil.disk_io_counters(nowrap=False)
-                assert ret.read_count == 1
-                assert ret.read_merged_count == 2
-                assert ret.read_bytes == 3 * SECTOR_SIZE
-                assert ret.read_time == 4
-                assert ret.write_count == 5
-                assert ret.write_merged_count == 6
-                assert ret.write_bytes == 7 * SECTOR_SIZE
-                assert ret.write_time == 8
-                assert ret.busy_time == 10
+        with self.fake_diskstats(content):
+            ret = psutil.disk_io_counters(nowrap=False)
+            assert ret.read_count == 1
+            assert ret.read_merged_count == 2
+            assert ret.read_bytes == 3 * SECTOR_SIZE
+            assert ret.read_time == 4
+            assert ret.write_count == 5
+            assert ret.write_merged_count == 6
+            assert ret.write_bytes == 7 * SECTOR_SIZE
+            assert ret.write_time == 8
+            assert ret.busy_time == 10
+            assert ret.weighted_time == 11
+            assert ret.discard_count == 0
+            assert ret.flush_count == 0
+
+    def test_emulate_kernel_5_5(self):
+        # Linux 4.18 added 4 discard columns, 5.5 added 2 flush ones.
+        content = (
+            "   8    0   sda 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17\n"
+        )
+        with self.fake_diskstats(content):
+            ret = psutil.disk_io_counters(nowrap=False)
+            assert ret.read_count == 1
+            assert ret.busy_time == 10
+            assert ret.weighted_time == 11
+            assert ret.discard_count == 12
+            assert ret.discard_merged_count == 13
+            assert ret.discard_bytes == 14 * SECTOR_SIZE
+            assert ret.discard_time == 15
+            assert ret.flush_count == 16
+            assert ret.flush_time == 17
 
     def test_emulate_kernel_2_6_limited(self):
         # Tests /proc/diskstats parsing format for 2.6 kernels,
@@ -1523,21 +1801,23 @@ class TestDiskIoCounters(LinuxTestCase):
         # amount of metrics when it bumps into a partition
         # (instead of a disk). See:
         # https://github.com/giampaolo/psutil/issues/767
-        with mock_open_content({"/proc/diskstats": "   3    1   hda 1 2 3 4"}):
-            with mock.patch(
-                'psutil._pslinux.is_storage_device', return_value=True
-            ):
-                ret = psutil.disk_io_counters(nowrap=False)
-                assert ret.read_count == 1
-                assert ret.read_bytes == 2 * SECTOR_SIZE
-                assert ret.write_count == 3
-                assert ret.write_bytes == 4 * SECTOR_SIZE
-
-                assert ret.read_merged_count == 0
-                assert ret.read_time == 0
-                assert ret.write_merged_count == 0
-                assert ret.write_time == 0
-                assert ret.busy_time == 0
+        with self.fake_diskstats("   3    1   hda 1 2 3 4"):
+            ret = psutil.disk_io_counters(nowrap=False)
+            assert ret.read_count == 1
+            assert ret.read_bytes == 2 * SECTOR_SIZE
+            assert ret.write_count == 3
+            assert ret.write_bytes == 4 * SECTOR_SIZE
+
+            assert ret.read_merged_count == 0
+            assert ret.read_time == 0
+            assert ret.write_merged_count == 0
+            assert ret.write_time == 0
+            assert ret.busy_time == 0
+
+    def test_emulate_invalid_line(self):
+        with self.fake_diskstats("   3    1   hda 1 2 3 4 5 6\n"):
+            with pytest.raises(ValueError):
+                psutil.disk_io_counters(nowrap=False)
 
     def test_emulate_include_partitions(self):
         # Make sure that when perdisk=True disk partitions are returned,
@@ -1547,16 +1827,13 @@ class TestDiskIoCounters(LinuxTestCase):
             3    0   nvme0n1 1 2 3 4 5 6 7 8 9 10 11
             3    0   nvme0n1p1 1 2 3 4 5 6 7 8 9 10 11
             """)
-        with mock_open_content({"/proc/diskstats": content}):
-            with mock.patch(
-                'psutil._pslinux.is_storage_device', return_value=False
-            ):
-                ret = psutil.disk_io_counters(perdisk=True, nowrap=False)
-                assert len(ret) == 2
-                assert ret['nvme0n1'].read_count == 1
-                assert ret['nvme0n1p1'].read_count == 1
-                assert ret['nvme0n1'].write_count == 5
-                assert ret['nvme0n1p1'].write_count == 5
+        with self.fake_diskstats(content, is_storage_device=False):
+            ret = psutil.disk_io_counters(perdisk=True, nowrap=False)
+            assert len(ret) == 2
+            assert ret['nvme0n1'].read_count == 1
+            assert ret['nvme0n1p1'].read_count == 1
+            assert ret['nvme0n1'].write_count == 5
+            assert ret['nvme0n1p1'].write_count == 5
 
     def test_emulate_exclude_partitions(self):
         # Make sure that when perdisk=False partitions (e.g. 'sda1',
@@ -1566,29 +1843,41 @@ class TestDiskIoCounters(LinuxTestCase):
             3    0   nvme0n1 1 2 3 4 5 6 7 8 9 10 11
             3    0   nvme0n1p1 1 2 3 4 5 6 7 8 9 10 11
             """)
-        with mock_open_content({"/proc/diskstats": content}):
-            with mock.patch(
-                'psutil._pslinux.is_storage_device', return_value=False
-            ):
-                ret = psutil.disk_io_counters(perdisk=False, nowrap=False)
-                assert ret is None
+        with self.fake_diskstats(content, is_storage_device=False):
+            ret = psutil.disk_io_counters(perdisk=False, nowrap=False)
+            assert ret is None
 
         def is_storage_device(name):
             return name == 'nvme0n1'
 
+        with self.fake_diskstats(content, is_storage_device):
+            ret = psutil.disk_io_counters(perdisk=False, nowrap=False)
+            assert ret.read_count == 1
+            assert ret.write_count == 5
+
+    def test_storage_devices_cache(self):
+        # Whether a device is a disk or a partition is determined once,
+        # until the list of devices changes.
         content = textwrap.dedent("""\
-            3    0   nvme0n1 1 2 3 4 5 6 7 8 9 10 11
-            3    0   nvme0n1p1 1 2 3 4 5 6 7 8 9 10 11
+            3    0   sda 1 2 3 4 5 6 7 8 9 10 11
+            3    1   sda1 1 2 3 4 5 6 7 8 9 10 11
             """)
-        with mock_open_content({"/proc/diskstats": content}):
-            with mock.patch(
-                'psutil._pslinux.is_storage_device',
-                create=True,
-                side_effect=is_storage_device,
-            ):
-                ret = psutil.disk_io_counters(perdisk=False, nowrap=False)
-                assert ret.read_count == 1
-                assert ret.write_count == 5
+        with self.fake_diskstats(content) as m:
+            psutil.disk_io_counters(nowrap=False)
+            assert m.call_count == 2
+            psutil.disk_io_counters(nowrap=False)
+            assert m.call_count == 2
+            # perdisk=True doesn't need it
+            psutil.disk_io_counters(perdisk=True, nowrap=False)
+            assert m.call_count == 2
+            # a device is added
+            with open(os.path.join(psutil.PROCFS_PATH, "diskstats"), "a") as f:
+                f.write("8    0   sdb 1 2 3 4 5 6 7 8 9 10 11\n")
+            psutil.disk_io_counters(nowrap=False)
+            assert m.call_count == 5
+            psutil.disk_io_counters.cache_clear()
+            psutil.disk_io_counters(nowrap=False)
+            assert m.call_count == 8
 
     def test_emulate_use_sysfs(self):
         def exists(path):
@@ -1639,6 +1928,82 @@ class TestDiskIoCounters(LinuxTestCase):
             assert abs(stats.write_bytes - bytes_wrtn) < 1024 * 1024
 
 
+class TestDiskIoStats(LinuxTestCase):
+    @staticmethod
+    def raw(reads, writes, rtime, wtime, busy, weighted):
+        # The other columns (bytes, merged, discard, flush) are unused.
+        fields = [0] * 16
+        fields[0], fields[1] = reads, writes
+        fields[4], fields[5] = rtime, wtime
+        fields[8], fields[9] = busy, weighted
+        return tuple(fields)
+
+    def call(self, before, after, **kwargs):
+        with mock.patch(
+            "psutil._psplatform.disk_io_counters", side_effect=[before, after]
+        ):
+            with mock.patch("time.sleep"):
+                with mock.patch("time.monotonic", side_effect=[0.0, 1.0]):
+                    return psutil.disk_io_stats(interval=1, **kwargs)
+
+    def test_math(self):
+        before = {"sda": self.raw(0, 0, 0, 0, 0, 0)}
+        after = {"sda": self.raw(10, 10, 20, 60, 100, 200)}
+        ret = self.call(before, after)
+        assert ret.read_await == 2.0
+        assert ret.write_await == 6.0
+        assert ret.total_await == 4.0
+        assert ret.service_time == 5.0
+        assert ret.queue_depth == 0.2
+        assert ret.busy_percent == 10.0
+
+    def test_no_io(self):
+        before = after = {"sda": self.raw(5, 5, 5, 5, 5, 5)}
+        ret = self.call(before, after)
+        assert ret == (0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+
+    def test_perdisk(self):
+        before = {
+            "sda": self.raw(0, 0, 0, 0, 0, 0),
+            "sdb": self.raw(0, 0, 0, 0, 0, 0),
+        }
+        after = {
+            "sda": self.raw(10, 0, 20, 0, 1000, 0),
+            "sdb": self.raw(0, 0, 0, 0, 0, 0),
+            # appeared during the interval
+            "sdc": self.raw(10, 0, 20, 0, 1000, 0),
+        }
+        ret = self.call(before, after, perdisk=True)
+        assert set(ret) == {"sda", "sdb"}
+        assert ret["sda"].read_await == 2.0
+        assert ret["sda"].busy_percent == 100.0
+        assert ret["sdb"].busy_percent == 0.0
+        # totals: busy_percent is the average across disks
+        ret = self.call(before, after)
+        assert ret.read_await == 2.0
+        assert ret.busy_percent == 50.0
+
+    def test_counters_going_backwards(self):
+        before = {"sda": self.raw(10, 10, 10, 10, 10, 10)}
+        after = {"sda": self.raw(0, 0, 0, 0, 0, 0)}
+        assert self.call(before, after, perdisk=True) == {}
+
+    def test_no_disks(self):
+        assert self.call({}, {}) is None
+        assert self.call({}, {}, perdisk=True) == {}
+
+    def test_negative_interval(self):
+        with pytest.raises(ValueError):
+            psutil.disk_io_stats(interval=-1)
+
+    def test_real(self):
+        psutil.disk_io_stats()
+        ret = psutil.disk_io_stats(perdisk=True)
+        for k, v in ret.items():
+            assert k in psutil.disk_io_counters(perdisk=True)
+            assert 0 <= v.busy_percent <= 100
+
+
 class TestRootFsDeviceFinder(LinuxTestCase):
     def setUp(self):
         dev = os.stat("/").st_dev
@@ -1691,15 +2056,19 @@ class TestRootFsDeviceFinder(LinuxTestCase):
         )
 
     def test_disk_partitions_mocked(self):
-        with mock.patch.object(
-            _psutil,
-            'disk_partitions',
-            return_value=[('/dev/root', '/', 'ext4', 'rw')],
-        ) as m:
-            part = psutil.disk_partitions(all=True)[0]
-            assert m.called
-            assert part.device != "/dev/root"
-            assert part.device == RootFsDeviceFinder().find()
+        psutil.disk_partitions.cache_clear()
+        try:
+            with mock.patch.object(
+                _psutil,
+                'disk_partitions',
+                return_value=[('/dev/root', '/', 'ext4', 'rw')],
+            ) as m:
+                part = psutil.disk_partitions(all=True)[0]
+                assert m.called
+                assert part.device != "/dev/root"
+                assert part.device == RootFsDeviceFinder().find()
+        finally:
+            psutil.disk_partitions.cache_clear()
 
 
 # =====================================================================
@@ -1855,6 +2224,173 @@ class TestMisc(LinuxTestCase):
         finally:
             psutil.PROCFS_PATH = "/proc"
 
+    def test_pids(self):
+        pids = psutil._pslinux.pids()
+        assert len(pids) == len(set(pids))
+        ls = [int(x) for x in os.listdir("/proc") if x.isdigit()]
+        assert abs(len(pids) - len(ls)) < 5
+        assert os.getpid() in pids
+
+    def test_ppid_map(self):
+        ppids = psutil._pslinux.ppid_map()
+        assert ppids[os.getpid()] == os.getppid()
+        for pid, ppid in list(ppids.items())[:50]:
+            try:
+                assert psutil.Process(pid).ppid() == ppid
+            except psutil.NoSuchProcess:
+                pass
+
+    def test_ppid_map_access_denied(self):
+        exc = PermissionError(errno.EACCES, "denied", "/proc/123/stat")
+        with mock.patch.object(_psutil, "ppid_map", side_effect=exc):
+            with pytest.raises(psutil.AccessDenied) as cm:
+                psutil._pslinux.ppid_map()
+        assert cm.value.pid == 123
+
+    def test_pids_fake_procfs(self):
+        root = write_tree(
+            self.get_testfn(),
+            {
+                "1/stat": "1 (init) S 0 1 1 0 -1",
+                "23/stat": "23 (a) b) (c) R 1 23 23 0 -1",
+                "4x": None,
+                "self": None,
+                "sys": None,
+                "99999999999": None,
+            },
+        )
+        assert sorted(_psutil.pids(root)) == [1, 23]
+        assert _psutil.ppid_map(root) == {1: 0, 23: 1}
+        os.remove(os.path.join(root, "23", "stat"))  # gone
+        assert _psutil.ppid_map(root) == {1: 0}
+        with pytest.raises(FileNotFoundError):
+            _psutil.pids(os.path.join(root, "nope"))
+
+    def test_proc_top(self):
+        # compare against process_iter()
+        rss = {}
+        for p in psutil.process_iter():
+            try:
+                rss[p.pid] = p.memory_info().rss
+            except psutil.Error:
+                pass
+        top = _psutil.proc_top("/proc", "rss", 3, None, False)
+        assert len(top) == 3
+        for pid, value, starttime in top:
+            # the process may have grown / shrunk in the meantime
+            assert abs(value - rss.get(pid, value)) < 10 * 1024 * 1024
+            with contextlib.suppress(psutil.NoSuchProcess):
+                ctime = psutil.Process(pid)._ident[1]
+                assert starttime / CLOCK_TICKS == ctime
+        assert [x[1] for x in top] == sorted([x[1] for x in top])[::-1]
+
+        # delta against a previous state
+        ls, state = _psutil.proc_top("/proc", "cpu", 0, None, True)
+        assert ls == []
+        assert len(state) % 24 == 0
+        top = _psutil.proc_top("/proc", "cpu", 5, state, False)
+        total = _psutil.proc_top("/proc", "cpu", 5, None, False)
+        assert sum(x[1] for x in top) < sum(x[1] for x in total)
+
+        with pytest.raises(ValueError):
+            _psutil.proc_top("/proc", "foo", 3, None, False)
+        with pytest.raises(ValueError):
+            _psutil.proc_top("/proc", "cpu", 3, b"x", False)
+
+    def test_proc_rollup_fake_procfs(self):
+        def write(pid, name, uid, cgroup):
+            write_tree(
+                root,
+                {
+                    # utime=3 stime=4 num_threads=2 rss=10 pages
+                    f"{pid}/stat": (
+                        f"{pid} ({name}) S 1 1 1 0 -1 0 0 0 0 0 3 4 0 0 20"
+                        " 0 2 0 100 4096 10 0"
+                    ),
+                    f"{pid}/status": (
+                        f"Name:\t{name}\nUid:\t{uid}\t{uid}\t0\t0\n"
+                    ),
+                    f"{pid}/cgroup": cgroup,
+                    f"{pid}/io": "rchar: 1\nread_bytes: 100\nwrite_bytes: 5\n",
+                },
+            )
+
+        root = self.get_testfn()
+        write(1, "init", 0, "1:cpu:/\n0::/init.scope\n")
+        write(20, "a b", 1000, "0::/user.slice\n")
+        write(30, "a b", 1000, "1:cpu:/legacy\n")
+        pagesize = os.sysconf("SC_PAGE_SIZE")
+        d = _psutil.proc_rollup(root, "uid", False)
+        assert d == {
+            0: (1, 10 * pagesize, 0, 7, 105, 2, 0),
+            1000: (2, 20 * pagesize, 0, 14, 210, 4, 0),
+        }
+        d = _psutil.proc_rollup(root, "name", False)
+        assert sorted(d) == ["a b", "init"]
+        assert d["a b"][0] == 2
+        d = _psutil.proc_rollup(root, "cgroup", False)
+        assert sorted(d) == ["/init.scope", "/legacy", "/user.slice"]
+        with pytest.raises(ValueError):
+            _psutil.proc_rollup(root, "foo", False)
+
+    def test_proc_filter_scan_fake_procfs(self):
+        def write(pid, stat, uid):
+            status = f"Name:\tx\nUid:\t{uid}\t{uid}\t{uid}\t{uid}\n"
+            write_tree(root, {f"{pid}/stat": stat, f"{pid}/status": status})
+
+        def scan(uids=None, ppid=-1, states=None, rss=0, no_kthreads=False):
+            ls = _psutil.proc_filter_scan(
+                root, uids, ppid, states, rss, no_kthreads
+            )
+            return sorted(x[0] for x in ls)
+
+        root = self.get_testfn()
+        # fields: state ppid pgrp session tty tpgid flags ... rss (24th)
+        rest = " 0" * 14 + " 100 0"
+        write(1, "1 (init) S 0 1 1 0 -1 4194560" + rest, 0)
+        write(2, "2 (kthreadd) S 0 0 0 0 -1 2129984" + rest, 0)
+        write(30, "30 (a) b) R 1 30 30 0 -1 4194304" + rest[:-6] + " 7 0", 5)
+        assert scan() == [1, 2, 30]
+        assert scan(no_kthreads=True) == [1, 30]
+        assert scan(ppid=1) == [30]
+        assert scan(states="R") == [30]
+        assert scan(states="SD") == [1, 2]
+        assert scan(uids=(5, 6)) == [30]
+        assert scan(uids=()) == []
+        assert scan(rss=50) == [1, 2]
+        ls = _psutil.proc_filter_scan(root, None, 1, None, 0, False)
+        assert ls == [(30, 1, "a) b")]
+
+    def test_proc_stat_scan_row_status(self):
+        rest = " 0" * 16 + " 100 0"
+        root = write_tree(
+            self.get_testfn(),
+            {
+                "1/stat": "1 (x) S 1 1" + rest,
+                "2/stat": "2 (x) Z 1 2" + rest,
+                "3": None,  # gone
+                "4/stat": "4 (x) S 1 4" + rest,
+            },
+        )
+        os.chmod(os.path.join(root, "4", "stat"), 0)
+        ls = sorted(_psutil.proc_stat_scan(root))
+        # 3 is gone, hence skipped
+        assert [x[0] for x in ls] == [1, 2, 4]
+        assert ls[0] == (1, 1, 100, "x", _psutil.ROW_OK)
+        assert ls[1][4] == _psutil.ROW_ZOMBIE
+        if os.geteuid() != 0:
+            assert ls[2] == (4, -1, 0, "", _psutil.ROW_DENIED)
+
+        # process_iter() does not pay for a NoSuchProcess when the
+        # native scan already knows the process is gone
+        psutil.process_iter.cache_clear()
+        with mock.patch(
+            "psutil._pslinux.pid_idents", return_value={}
+        ) as m, mock.patch("psutil.Process._init") as m2:
+            assert list(psutil.process_iter()) == []
+        assert m.called
+        assert not m2.called
+
     @retry_on_failure
     @isolated
     def test_issue_687(self):
@@ -2052,92 +2588,129 @@ class TestSensorsBattery(LinuxTestCase):
         assert mopen.called
 
 
+@contextlib.contextmanager
+def fake_sysfs(root, files):
+    """Create a fake /sys tree in `root` (see write_tree()) and make
+    the sensors functions use it.
+    """
+    write_tree(root, files)
+    with mock.patch("psutil._pslinux.SYSFS_PATH", root):
+        yield root
+
+
 class TestSensorsTemperatures(LinuxTestCase):
     def test_emulate_class_hwmon(self):
-        def open_mock(name, *args, **kwargs):
-            if name.endswith('/name'):
-                return io.StringIO("name")
-            elif name.endswith('/temp1_label'):
-                return io.StringIO("label")
-            elif name.endswith('/temp1_input'):
-                return io.BytesIO(b"30000")
-            elif name.endswith('/temp1_max'):
-                return io.BytesIO(b"40000")
-            elif name.endswith('/temp1_crit'):
-                return io.BytesIO(b"50000")
-            else:
-                return orig_open(name, *args, **kwargs)
-
-        orig_open = open
-        with mock.patch("builtins.open", side_effect=open_mock):
+        files = {
+            "class/hwmon/hwmon0/name": b"name\n",
+            "class/hwmon/hwmon0/temp1_label": b"label\n",
+            "class/hwmon/hwmon0/temp1_input": b"30000\n",
+            "class/hwmon/hwmon0/temp1_max": b"40000\n",
+            "class/hwmon/hwmon0/temp1_crit": b"50000\n",
+        }
+        with fake_sysfs(self.get_testfn(), files):
             # Test case with /sys/class/hwmon
-            with mock.patch(
-                'glob.glob', return_value=['/sys/class/hwmon/hwmon0/temp1']
-            ):
-                temp = psutil.sensors_temperatures()['name'][0]
-                assert temp.label == 'label'
-                assert temp.current == 30.0
-                assert temp.high == 40.0
-                assert temp.critical == 50.0
+            temp = psutil.sensors_temperatures()['name'][0]
+            assert temp.label == 'label'
+            assert temp.current == 30.0
+            assert temp.high == 40.0
+            assert temp.critical == 50.0
+
+    def test_emulate_class_hwmon_device(self):
+        # CentOS has an intermediate /device directory:
+        # https://github.com/giampaolo/psutil/issues/971
+        files = {
+            "class/hwmon/hwmon0/device/name": b"name\n",
+            "class/hwmon/hwmon0/device/temp1_input": b"30000\n",
+        }
+        with fake_sysfs(self.get_testfn(), files):
+            temp = psutil.sensors_temperatures()['name'][0]
+            assert temp == ('', 30.0, None, None)
+
+    def test_emulate_unreadable_input(self):
+        # https://github.com/giampaolo/psutil/issues/1009
+        files = {
+            "class/hwmon/hwmon0/name": b"name\n",
+            "class/hwmon/hwmon0/temp1_input": b"",
+            "class/hwmon/hwmon0/temp2_input": b"30000\n",
+        }
+        with fake_sysfs(self.get_testfn(), files):
+            temps = psutil.sensors_temperatures()['name']
+            assert len(temps) == 1
+            assert temps[0].current == 30.0
 
     def test_emulate_class_thermal(self):
-        def open_mock(name, *args, **kwargs):
-            if name.endswith('0_temp'):
-                return io.BytesIO(b"50000")
-            elif name.endswith('temp'):
-                return io.BytesIO(b"30000")
-            elif name.endswith('0_type'):
-                return io.StringIO("critical")
-            elif name.endswith('type'):
-                return io.StringIO("name")
-            else:
-                return orig_open(name, *args, **kwargs)
-
-        def glob_mock(path):
-            if path in {
-                '/sys/class/hwmon/hwmon*/temp*_*',
-                '/sys/class/hwmon/hwmon*/device/temp*_*',
-            }:
-                return []
-            elif path == '/sys/class/thermal/thermal_zone*':
-                return ['/sys/class/thermal/thermal_zone0']
-            elif path == '/sys/class/thermal/thermal_zone0/trip_point*':
-                return [
-                    '/sys/class/thermal/thermal_zone1/trip_point_0_type',
-                    '/sys/class/thermal/thermal_zone1/trip_point_0_temp',
-                ]
-            return []
+        files = {
+            "class/thermal/thermal_zone0/temp": b"30000\n",
+            "class/thermal/thermal_zone0/type": b"name\n",
+            "class/thermal/thermal_zone0/trip_point_0_type": b"critical\n",
+            "class/thermal/thermal_zone0/trip_point_0_temp": b"50000\n",
+        }
+        with fake_sysfs(self.get_testfn(), files):
+            temp = psutil.sensors_temperatures()['name'][0]
+            assert temp.label == ''
+            assert temp.current == 30.0
+            assert temp.high == 50.0
+            assert temp.critical == 50.0
+
+    def test_cache(self):
+        files = {
+            "class/hwmon/hwmon0/name": b"name\n",
+            "class/hwmon/hwmon0/temp1_input": b"30000\n",
+            "class/hwmon/hwmon0/temp1_max": b"40000\n",
+        }
 
-        orig_open = open
-        with mock.patch("builtins.open", side_effect=open_mock):
-            with mock.patch('glob.glob', create=True, side_effect=glob_mock):
-                temp = psutil.sensors_temperatures()['name'][0]
-                assert temp.label == ''
-                assert temp.current == 30.0
-                assert temp.high == 50.0
-                assert temp.critical == 50.0
+        with fake_sysfs(self.get_testfn(), files) as root:
+            assert psutil.sensors_temperatures() == {
+                'name': [('', 30.0, 40.0, 40.0)]
+            }
+            # current values are always re-read, static ones are not
+            write_tree(
+                root,
+                {
+                    "class/hwmon/hwmon0/temp1_input": b"35000\n",
+                    "class/hwmon/hwmon0/temp1_max": b"45000\n",
+                    "class/hwmon/hwmon0/temp2_input": b"20000\n",
+                },
+            )
+            assert psutil.sensors_temperatures() == {
+                'name': [('', 35.0, 40.0, 40.0)]
+            }
+            # a new hwmon device triggers a re-scan
+            write_tree(
+                root,
+                {
+                    "class/hwmon/hwmon1/name": b"name2\n",
+                    "class/hwmon/hwmon1/temp1_input": b"10000\n",
+                },
+            )
+            temps = psutil.sensors_temperatures()
+            assert temps['name'] == [
+                ('', 35.0, 45.0, 45.0),
+                ('', 20.0, None, None),
+            ]
+            assert temps['name2'] == [('', 10.0, None, None)]
+            # ...and so does cache_clear()
+            write_tree(root, {"class/hwmon/hwmon1/temp1_label": b"label\n"})
+            assert psutil.sensors_temperatures()['name2'][0].label == ''
+            psutil.sensors_temperatures.cache_clear()
+            assert psutil.sensors_temperatures()['name2'][0].label == 'label'
 
 
 class TestSensorsFans(LinuxTestCase):
     def test_emulate_data(self):
-        def open_mock(name, *args, **kwargs):
-            if name.endswith('/name'):
-                return io.StringIO("name")
-            elif name.endswith('/fan1_label'):
-                return io.StringIO("label")
-            elif name.endswith('/fan1_input'):
-                return io.StringIO("2000")
-            else:
-                return orig_open(name, *args, **kwargs)
-
-        orig_open = open
-        with mock.patch("builtins.open", side_effect=open_mock):
-            with mock.patch(
-                'glob.glob', return_value=['/sys/class/hwmon/hwmon2/fan1']
-            ):
-                fan = psutil.sensors_fans()['name'][0]
-                assert fan.label == 'label'
-                assert fan.current == 2000
+        files = {
+            "class/hwmon/hwmon2/name": b"name\n",
+            "class/hwmon/hwmon2/fan1_label": b"label\n",
+            "class/hwmon/hwmon2/fan1_input": b"2000\n",
+        }
+        with fake_sysfs(self.get_testfn(), files) as root:
+            fan = psutil.sensors_fans()['name'][0]
+            assert fan.label == 'label'
+            assert fan.current == 2000
+            # the current speed is not cached
+            with open(f"{root}/class/hwmon/hwmon2/fan1_input", "wb") as f:
+                f.write(b"2500\n")
+            assert psutil.sensors_fans()['name'][0].current == 2500
 
 
 # =====================================================================
@@ -2279,8 +2852,146 @@ class TestProcess(LinuxTestCase):
                     assert p.open_files() == []
                     assert m.called
 
+    def test_threads_info(self):
+        def target():
+            with open("/proc/thread-self/comm", "w") as f:
+                f.write("psutil-test")
+            started.set()
+            stop.wait()
+
+        started = threading.Event()
+        stop = threading.Event()
+        t = threading.Thread(target=target)
+        t.start()
+        try:
+            started.wait()
+            p = psutil.Process()
+            info = p.threads_info()
+            threads = p.threads()
+        finally:
+            stop.set()
+            t.join()
+        assert [x.id for x in info] == [x.id for x in threads]
+        assert info == sorted(info, key=lambda x: x.id)
+        assert info[0].id == os.getpid()
+        assert info[0].name == p.name()[:15]
+        assert info[0].status == psutil.STATUS_RUNNING
+        names = [x.name for x in info]
+        assert "psutil-test" in names
+        for x in info:
+            assert x.status in set(psutil._pslinux.PROC_STATUSES.values())
+            assert 0 <= x.cpu_num < psutil.cpu_count()
+            assert x.voluntary_ctx_switches >= 0
+            assert x.involuntary_ctx_switches >= 0
+            assert x.run_time >= 0
+            assert x.wait_time >= 0
+        main = info[0]
+        assert main.voluntary_ctx_switches + main.involuntary_ctx_switches
+
+    def test_children_pids(self):
+        if psutil.Process()._proc.children_pids() is None:
+            raise pytest.skip("no CONFIG_PROC_CHILDREN")
+        parent = psutil.Process()
+        child, grandchild = self.spawn_children_pair()
+        assert parent._proc.children_pids() == [child.pid]
+        assert parent._proc.children_pids(recursive=True) == [
+            child.pid,
+            grandchild.pid,
+        ]
+        # The result must be the same as when scanning all PIDs.
+        with mock.patch.object(
+            psutil._pslinux.Process, "children_pids", return_value=None
+        ) as m:
+            assert parent.children() == [child]
+            assert parent.children(recursive=True) == [child, grandchild]
+            assert m.called
+
+    def test_children_pids_not_supported(self):
+        # No task/<tid>/children files: the caller has to fall back
+        # on scanning all PIDs.
+        root = write_tree(self.get_testfn(), {"1234/task/1234": None})
+        assert _psutil.proc_children(root, 1234, False) is None
+        write_tree(root, {"1234/task/1234/children": ""})
+        assert _psutil.proc_children(root, 1234, True) == []
+        with pytest.raises(FileNotFoundError):
+            _psutil.proc_children(root, 1235, False)
+
+    def test_num_fds(self):
+        p = psutil.Process()
+        with open(__file__):
+            fds = os.listdir(f"/proc/{os.getpid()}/fd")
+            # listdir() counts the fd it used to read the directory
+            assert p.num_fds() == len(fds) - 1
+
+    def test_num_fds_fake_procfs(self):
+        # A fake tree is not procfs: the fd count is not in st_size.
+        root = write_tree(
+            self.get_testfn(), {f"1234/fd/{fd}": "" for fd in "012"}
+        )
+        assert _psutil.proc_num_fds(root, 1234) == 3
+        with pytest.raises(FileNotFoundError):
+            _psutil.proc_num_fds(root, 1235)
+
+    def test_num_fds_by_kind(self):
+        p = psutil.Process()
+        before = p.num_fds_by_kind()
+        assert list(before) == list(psutil._pslinux.FD_KINDS)
+        assert sum(before.values()) == p.num_fds()
+        r, w = os.pipe()
+        try:
+            with socket.socket() as sock:  # noqa: F841
+                with open(__file__):
+                    after = p.num_fds_by_kind()
+        finally:
+            os.close(r)
+            os.close(w)
+        assert after["pipe"] == before["pipe"] + 2
+        assert after["socket"] == before["socket"] + 1
+        assert after["file"] == before["file"] + 1
+        assert p.num_fds_by_kind() == before
+
     # --- mocked tests
 
+    def test_oneshot_plan(self):
+        plan = psutil._pslinux.oneshot_plan
+        assert plan(frozenset(["name", "ppid"])) == set()
+        assert plan(frozenset(["memory_footprint"])) == set()
+        assert plan(frozenset(["memory_footprint", "memory_maps"])) == {
+            "smaps"
+        }
+        assert plan(frozenset(["num_fds"])) == set()
+        assert plan(frozenset(["num_fds", "open_files"])) == {"fd"}
+
+    def test_as_dict_shared_reads(self):
+        # open_files() lists the fd dir and num_fds() reuses it
+        p = psutil.Process()
+        listdir = os.listdir
+        with mock.patch("psutil._pslinux._psutil.proc_num_fds") as m1:
+            with mock.patch(
+                "psutil._pslinux.os.listdir", side_effect=listdir
+            ) as m2:
+                d = p.as_dict(attrs=["num_fds", "open_files"])
+        assert not m1.called
+        assert m2.call_count == 1
+        assert d["num_fds"] > 0
+        # outside of as_dict()
+        with mock.patch(
+            "psutil._pslinux._psutil.proc_num_fds", return_value=5
+        ) as m1:
+            assert p.num_fds() == 5
+            assert m1.called
+
+    def test_as_dict_smaps_rollup_from_smaps(self):
+        if not psutil._pslinux.HAS_PROC_SMAPS_ROLLUP:
+            return pytest.skip("no smaps_rollup")
+        p = psutil.Process()
+        with mock.patch.object(
+            psutil._pslinux.Process, "_parse_smaps_rollup"
+        ) as m:
+            d = p.as_dict(attrs=["memory_footprint", "memory_maps"])
+        assert not m.called
+        assert d["memory_footprint"].uss > 0
+
     def test_terminal_mocked(self):
         with mock.patch(
             'psutil._pslinux._psposix._get_terminal_map', return_value={}
@@ -2337,29 +3048,27 @@ class TestProcess(LinuxTestCase):
             assert psutil.Process().cwd() == "/home/foo"
 
     def test_threads_mocked(self):
-        # Test the case where os.listdir() returns a file (thread)
-        # which no longer exists by the time we open() it (race
+        # Test the case where a thread listed in /proc/<pid>/task no
+        # longer exists by the time we read its stat file (race
         # condition). threads() is supposed to ignore that instead
         # of raising NSP.
-        def open_mock_1(name, *args, **kwargs):
-            if name.startswith(f"/proc/{os.getpid()}/task"):
-                raise FileNotFoundError
-            return orig_open(name, *args, **kwargs)
-
-        orig_open = open
-        with mock.patch("builtins.open", side_effect=open_mock_1) as m:
-            ret = psutil.Process().threads()
-            assert m.called
-            assert ret == []
+        task = f"{os.getpid()}/task"
+        stat = "11 (foo (bar)) S 1 " + "0 " * 9 + "500 100"
+        root = write_tree(
+            self.get_testfn(), {f"{task}/10": None, f"{task}/11/stat": stat}
+        )  # 10 is gone
+        p = psutil.Process()
+        with mock.patch.object(p._proc, "_procfs_path", root):
+            ret = p.threads()
+        assert [x.id for x in ret] == [11]
+        assert ret[0].user_time == 500 / psutil._pslinux.CLOCK_TICKS
+        assert ret[0].system_time == 100 / psutil._pslinux.CLOCK_TICKS
 
         # ...but if it bumps into something != ENOENT we want an
         # exception.
-        def open_mock_2(name, *args, **kwargs):
-            if name.startswith(f"/proc/{os.getpid()}/task"):
-                raise PermissionError
-            return orig_open(name, *args, **kwargs)
-
-        with mock.patch("builtins.open", side_effect=open_mock_2):
+        with mock.patch(
+            "psutil._pslinux._psutil.proc_threads", side_effect=PermissionError
+        ):
             with pytest.raises(psutil.AccessDenied):
                 psutil.Process().threads()
 
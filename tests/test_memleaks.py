@@ -144,6 +144,10 @@ class TestProcess(MemoryLeakTestCase):
     def test_num_fds(self):
         self.execute(self.proc.num_fds)
 
+    @skipif(not LINUX, reason="LINUX only")
+    def test_num_fds_by_kind(self):
+        self.execute(self.proc.num_fds_by_kind)
+
     def test_num_ctx_switches(self):
         self.execute(self.proc.num_ctx_switches)
 
@@ -151,6 +155,10 @@ class TestProcess(MemoryLeakTestCase):
     def test_threads(self):
         self.execute(self.proc.threads, times=50 if WINDOWS else TIMES)
 
+    @skipif(not LINUX, reason="LINUX only")
+    def test_threads_info(self):
+        self.execute(self.proc.threads_info)
+
     def test_cpu_times(self):
         self.execute(self.proc.cpu_times)
 
@@ -331,6 +339,10 @@ class TestModuleFunctions(MemoryLeakTestCase):
         times = FEW_TIMES if LINUX else self.times
         self.execute(psutil.cpu_freq, times=times)
 
+    @skipif(not LINUX, reason="LINUX only")
+    def test_cpu_freq_times(self):
+        self.execute(psutil.cpu_freq_times)
+
     @skipif(not WINDOWS, reason="WINDOWS only")
     def test_getloadavg(self):
         psutil.getloadavg()
@@ -359,6 +371,14 @@ class TestModuleFunctions(MemoryLeakTestCase):
     def test_disk_partitions(self):
         self.execute(psutil.disk_partitions)
 
+    @skipif(not POSIX, reason="POSIX only")
+    def test_disk_usage_many(self):
+        self.execute(lambda: psutil.disk_usage_many(['.', '/'], timeout=5))
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_open_files(self):
+        self.execute(lambda: psutil.open_files(kind=("file", "pipe")))
+
     @skipif(
         LINUX and not os.path.exists('/proc/diskstats'),
         reason="/proc/diskstats not available on this Linux version",
@@ -366,17 +386,38 @@ class TestModuleFunctions(MemoryLeakTestCase):
     def test_disk_io_counters(self):
         self.execute(lambda: psutil.disk_io_counters(nowrap=False))
 
+    @skipif(not LINUX, reason="LINUX only")
+    def test_disk_io_stats(self):
+        self.execute(psutil.disk_io_stats)
+
     # --- proc
 
     def test_pids(self):
         self.execute(psutil.pids)
 
+    def test_process_tree(self):
+        self.execute(lambda: psutil.ProcessTree().refresh())
+
+    def test_top_processes(self):
+        self.execute(lambda: psutil.top_processes("rss", n=5))
+
+    def test_process_rollup(self):
+        self.execute(lambda: psutil.process_rollup("name"))
+
+    def test_process_iter_filters(self):
+        flt = {"uids": [os.getuid()], "status": [psutil.STATUS_RUNNING]}
+        self.execute(lambda: list(psutil.process_iter(filters=flt)))
+
     # --- net
 
     @skipif(not HAS_NET_IO_COUNTERS, reason="not supported")
     def test_net_io_counters(self):
         self.execute(lambda: psutil.net_io_counters(nowrap=False))
 
+    def test_net_io_counters_filters(self):
+        self.execute(lambda: psutil.net_io_counters(nowrap=False, ifindex=1))
+        self.execute(lambda: psutil.net_io_counters(nowrap=False, prefix="?"))
+
     @skipif(MACOS and os.getuid() != 0, reason="need root access")
     @skipif(LINUX, reason="pure python, too slow")
     def test_net_connections(self):
@@ -393,6 +434,9 @@ class TestModuleFunctions(MemoryLeakTestCase):
         tolerance = 80 * 1024 if WINDOWS else self.tolerance
         self.execute(psutil.net_if_addrs, tolerance=tolerance)
 
+    def test_net_if_addrs_cached(self):
+        self.execute(lambda: psutil.net_if_addrs(cached=True))
+
     def test_net_if_stats(self):
         self.execute(psutil.net_if_stats)
 
@@ -568,6 +612,112 @@ class TestBadargs2(MemoryLeakTestCase):
     @skipif(not LINUX, reason="LINUX only")
     def test_disk_partitions(self):
         self.execute_w_exc(OSError, _psutil.disk_partitions, "/does/not/exist")
+        self.execute_w_exc(
+            OSError, _psutil.disk_partitions, "/does/not/exist", True
+        )
+
+    @skipif(not POSIX, reason="POSIX only")
+    def test_disk_usage_many(self):
+        self.execute_w_exc(TypeError, _psutil.disk_usage_many, [1], None)
+        self.execute_w_exc(ValueError, _psutil.disk_usage_many, ["."], -1)
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_open_files_scan(self):
+        self.execute_w_exc(
+            OSError,
+            _psutil.open_files_scan,
+            "/does/not/exist",
+            -1,
+            None,
+            -1,
+            None,
+        )
+        self.execute_w_exc(
+            ValueError, _psutil.open_files_scan, "/proc", -1, None, -1, ["x"]
+        )
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_pids(self):
+        self.execute_w_exc(OSError, _psutil.pids, "/does/not/exist")
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_ppid_map(self):
+        self.execute_w_exc(OSError, _psutil.ppid_map, "/does/not/exist")
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_filter_scan(self):
+        self.execute_w_exc(
+            OSError,
+            _psutil.proc_filter_scan,
+            "/does/not/exist",
+            (0, 1),
+            -1,
+            "R",
+            0,
+            True,
+        )
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_top(self):
+        self.execute_w_exc(
+            OSError, _psutil.proc_top, "/does/not/exist", "cpu", 3, None, True
+        )
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_rollup(self):
+        self.execute_w_exc(
+            OSError, _psutil.proc_rollup, "/does/not/exist", "uid", False
+        )
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_stat_scan(self):
+        self.execute_w_exc(OSError, _psutil.proc_stat_scan, "/does/not/exist")
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_num_fds(self):
+        self.execute_w_exc(OSError, _psutil.proc_num_fds, "/proc", -1)
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_fd_counts(self):
+        self.execute_w_exc(OSError, _psutil.proc_fd_counts, "/proc", -1)
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_children(self):
+        self.execute_w_exc(OSError, _psutil.proc_children, "/proc", -1, True)
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_proc_threads(self):
+        self.execute_w_exc(OSError, _psutil.proc_threads, "/proc", -1, True)
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_mounts_changed(self):
+        self.execute_w_exc(OSError, _psutil.mounts_changed, -1)
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_sysfs_read_ints(self):
+        self.execute_w_exc(
+            OSError, _psutil.sysfs_read_ints, "/does/not/exist", ["x"]
+        )
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_cpuinfo_freqs(self):
+        self.execute_w_exc(OSError, _psutil.cpuinfo_freqs, "/does/not/exist")
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_cpufreq_time_in_state(self):
+        self.execute_w_exc(
+            OSError, _psutil.cpufreq_time_in_state, "/does/not/exist", ["x"]
+        )
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_disk_io_counters_procfs(self):
+        self.execute_w_exc(
+            OSError, _psutil.disk_io_counters_procfs, "/does/not/exist"
+        )
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_net_if_notify_drain(self):
+        self.execute_w_exc(OSError, _psutil.net_if_notify_drain, -1)
 
     @skipif(not LINUX, reason="LINUX only")
     def test_net_if_duplex_speed(self):
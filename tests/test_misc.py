@@ -23,12 +23,14 @@ import psutil
 from psutil import POSIX
 from psutil import WINDOWS
 from psutil import _psutil
+from psutil._common import ScanContext
 from psutil._common import bcat
 from psutil._common import broadcast_addr
 from psutil._common import cat
 from psutil._common import debug
 from psutil._common import isfile_strict
 from psutil._common import memoize_when_activated
+from psutil._common import memoize_when_scanning
 from psutil._common import parse_environ_block
 from psutil._common import supports_ipv6
 from psutil._common import warn
@@ -198,6 +200,7 @@ class TestMisc(PsutilTestCase):
         assert len(dir_psutil) == len(set(dir_psutil))
         for name in dir_psutil:
             if name in {
+                'aio',
                 'debug',
                 'warn',
                 'tests',
@@ -325,6 +328,10 @@ class TestMisc(PsutilTestCase):
             with pytest.raises(ImportError) as cm:
                 reload_module(psutil)
             assert "version conflict" in str(cm.value).lower()
+        # The failed reload left the module half re-executed (e.g.
+        # module globals such as _SENTINEL were replaced, but not the
+        # classes using them as defaults).
+        reload_module(psutil)
 
     def test_reload_keeps_all(self):
         # A reload reuses the module dict, so the enum constants are
@@ -402,6 +409,45 @@ class TestCommonModule(PsutilTestCase):
         f.foo()
         assert len(calls) == 2
 
+    def test_memoize_when_scanning(self):
+        @memoize_when_scanning
+        def foo():
+            calls.append(None)
+            return len(calls)
+
+        calls = []
+        foo()
+        foo()
+        assert len(calls) == 2
+
+        # the cache survives across multiple enters of the same ctx
+        calls = []
+        ctx = ScanContext()
+        with ctx:
+            assert foo() == 1
+            assert foo() == 1
+        foo()
+        with ctx:
+            assert foo() == 1
+        assert len(calls) == 2
+
+        # a nested ctx uses the outer cache
+        calls = []
+        with ScanContext():
+            foo()
+            with ScanContext():
+                foo()
+            foo()
+        assert len(calls) == 1
+
+        # a new ctx starts from scratch
+        calls = []
+        with ScanContext():
+            foo()
+        with ScanContext():
+            foo()
+        assert len(calls) == 2
+
     def test_parse_environ_block(self):
         def k(s):
             return s.upper() if WINDOWS else s
@@ -787,6 +833,14 @@ class TestWrapNumbers(PsutilTestCase):
         caches = wrap_numbers.cache_info()
         assert caches == ({}, {}, {})
 
+        # filtered queries have their own cache
+        nic = next(iter(psutil.net_io_counters(pernic=True)))
+        psutil.net_io_counters(prefix=nic)
+        caches = wrap_numbers.cache_info()
+        assert f'psutil.net_io_counters.{nic}.' in caches[0]
+        psutil.net_io_counters.cache_clear()
+        assert wrap_numbers.cache_info() == ({}, {}, {})
+
 
 # ===================================================================
 # --- Test setup.py
@@ -196,9 +196,85 @@ class TestProcess(PosixTestCase):
         # a username in which case psutil is supposed to return
         # the stringified uid.
         p = psutil.Process()
-        with mock.patch("psutil.pwd.getpwuid", side_effect=KeyError) as fun:
-            assert p.username() == str(p.uids().real)
-            assert fun.called
+        psutil._psposix.username_cache_clear()
+        try:
+            with mock.patch(
+                "psutil.pwd.getpwuid", side_effect=KeyError
+            ) as fun:
+                assert p.username() == str(p.uids().real)
+                assert fun.called
+        finally:
+            psutil._psposix.username_cache_clear()
+
+    def test_username_cache(self):
+        cache = psutil._psposix.UsernameCache(
+            maxsize=2, passwd_path=self.get_testfn()
+        )
+        with open(cache.passwd_path, "w") as f:
+            f.write("")
+        with mock.patch("pwd.getpwuid", side_effect=KeyError) as fun:
+            assert cache.get(1) == "1"
+            assert cache.get(1) == "1"
+            assert fun.call_count == 1
+            # bounded size: uid 1 is evicted
+            cache.get(2)
+            cache.get(3)
+            assert fun.call_count == 3
+            assert list(cache._cache) == [2, 3]
+            cache.get(1)
+            assert fun.call_count == 4
+            # TTL
+            cache.ttl = 0
+            cache.get(4)
+            cache.get(4)
+            assert fun.call_count == 6
+            cache.ttl = 300
+            cache.get(4)
+            cache.get(4)
+            assert fun.call_count == 7
+            # /etc/passwd modified: everything is dropped
+            st = os.stat(cache.passwd_path)
+            os.utime(
+                cache.passwd_path, ns=(st.st_atime_ns, st.st_mtime_ns + 10**9)
+            )
+            cache._checked = 0
+            cache.get(4)
+            assert fun.call_count == 8
+            cache.cache_clear()
+            cache.get(4)
+            assert fun.call_count == 9
+
+    def test_username_cache_passwd_changed(self):
+        # /etc/passwd is modified while a name is being looked up: the
+        # (possibly stale) result is not cached.
+        cache = psutil._psposix.UsernameCache(passwd_path=self.get_testfn())
+        with open(cache.passwd_path, "w") as f:
+            f.write("")
+
+        def getpwuid(uid):
+            st = os.stat(cache.passwd_path)
+            os.utime(
+                cache.passwd_path, ns=(st.st_atime_ns, st.st_mtime_ns + 10**9)
+            )
+            raise KeyError
+
+        with mock.patch("pwd.getpwuid", side_effect=getpwuid):
+            assert cache.get(1) == "1"
+        assert 1 not in cache._cache
+
+    def test_username_cache_uid(self):
+        cache = psutil._psposix.UsernameCache(passwd_path=self.get_testfn())
+        pw = mock.Mock(pw_uid=1234)
+        with mock.patch("pwd.getpwnam", return_value=pw) as fun:
+            assert cache.uid("foo") == 1234
+            assert cache.uid("foo") == 1234
+            assert fun.call_count == 1
+        with mock.patch("pwd.getpwnam", side_effect=KeyError) as fun:
+            with pytest.raises(KeyError):
+                cache.uid("bar")
+            with pytest.raises(KeyError):
+                cache.uid("bar")
+            assert fun.call_count == 1
 
     @skip_on_access_denied
     @retry_on_failure
@@ -6,6 +6,7 @@
 
 """Tests for psutil.Process class."""
 
+import asyncio
 import collections
 import contextlib
 import enum
@@ -22,10 +23,12 @@ import stat
 import string
 import subprocess
 import sys
+import threading
 import time
 from unittest import mock
 
 import psutil
+import psutil.aio
 from psutil import AIX
 from psutil import BSD
 from psutil import FREEBSD
@@ -142,6 +145,14 @@ class TestProcess(PsutilTestCase):
         with pytest.raises(ValueError):
             p.cpu_percent(interval=-1)
 
+    def test_aio_cpu_percent(self):
+        p = psutil.Process()
+        percent = asyncio.run(psutil.aio.process_cpu_percent(p, 0.01))
+        assert isinstance(percent, float)
+        assert percent >= 0.0
+        with pytest.raises(ValueError):
+            asyncio.run(psutil.aio.process_cpu_percent(p, -1))
+
     def test_cpu_percent_numcpus_none(self):
         # See: https://github.com/giampaolo/psutil/issues/1087
         with mock.patch('psutil.cpu_count', return_value=None) as m:
@@ -1232,6 +1243,77 @@ class TestProcess(PsutilTestCase):
         with pytest.raises(ValueError):
             p.as_dict(['foo', 'bar'])
 
+    def test_as_dict_timeout(self):
+        p = psutil.Process()
+        d = p.as_dict(attrs=["name", "ppid"], timeout=GLOBAL_TIMEOUT)
+        assert d == p.as_dict(attrs=["name", "ppid"])
+
+        # A method which blocks is abandoned.
+        unblock = threading.Event()
+        with mock.patch(
+            "psutil.Process.nice",
+            create=True,
+            side_effect=lambda *_: unblock.wait(GLOBAL_TIMEOUT),
+        ) as m:
+            t = time.monotonic()
+            d = p.as_dict(attrs=["nice"], ad_value="foo", timeout=0.1)
+            assert time.monotonic() - t < GLOBAL_TIMEOUT
+            assert d == {"nice": "foo"}
+            # While it's stuck the process is not retried.
+            d = p.as_dict(
+                attrs=["nice"], ad_value="foo", timeout=1, timeout_value="t"
+            )
+            assert d == {"nice": "t"}
+            assert m.call_count == 1
+            # ...and so is a process_iter() pre-fetch.
+            for proc in psutil.process_iter(
+                attrs=["nice"], ad_value="foo", timeout=0.01
+            ):
+                assert proc._prefetch == {"nice": "foo"}
+                break
+            unblock.set()
+        # the workers left behind go away
+        call_until(lambda: not psutil._common._stuck)
+
+        # Exceptions still bubble up.
+        with mock.patch(
+            "psutil.Process.nice",
+            create=True,
+            side_effect=psutil.NoSuchProcess(p.pid, "name"),
+        ):
+            with pytest.raises(psutil.NoSuchProcess):
+                p.as_dict(attrs=["nice"], timeout=GLOBAL_TIMEOUT)
+        with pytest.raises(ValueError):
+            p.as_dict(timeout=-1)
+
+    def test_as_dict_timeout_max_stuck(self):
+        # Once too many workers are stuck nothing is retrieved anymore.
+        p = psutil.Process()
+        with mock.patch.object(psutil._common, "_MAX_STUCK_WORKERS", 0):
+            with mock.patch("psutil.Process.name") as m:
+                d = p.as_dict(attrs=["name"], timeout=GLOBAL_TIMEOUT)
+        assert d == {"name": None}
+        assert not m.called
+
+    def test_process_iter_scan_timeout(self):
+        # Once the scan deadline is passed the remaining processes
+        # are not inspected.
+        with mock.patch("psutil.Process.name") as m:
+            procs = list(
+                psutil.process_iter(
+                    attrs=["name"], scan_timeout=0, timeout_value="t"
+                )
+            )
+        assert len(procs) > 1
+        assert all(x._prefetch == {"name": "t"} for x in procs)
+        assert not m.called
+        procs = list(
+            psutil.process_iter(["name"], scan_timeout=GLOBAL_TIMEOUT)
+        )
+        assert any(x._prefetch["name"] for x in procs)
+        with pytest.raises(ValueError):
+            list(psutil.process_iter(["name"], scan_timeout=-1))
+
     def test_attrs(self):
         # The `Process.attrs` attribute to use with `as_dict()`.
         p = psutil.Process()
@@ -1624,6 +1706,54 @@ class TestProcessPidReuse(PsutilTestCase):
 
 
 class TestProcessWait(PsutilTestCase):
+    def test_aio_wait(self):
+        async def wait(proc, timeout=None):
+            # make sure the event loop is not blocked meanwhile
+            ticks = 0
+
+            async def tick():
+                nonlocal ticks
+                while True:
+                    await asyncio.sleep(0.001)
+                    ticks += 1
+
+            task = asyncio.ensure_future(tick())
+            try:
+                return await psutil.aio.wait(proc, timeout), ticks
+            finally:
+                task.cancel()
+
+        code = "import sys, time; time.sleep(0.1); sys.exit(5)"
+        p = self.spawn_psproc([PYTHON_EXE, "-c", code])
+        code, ticks = asyncio.run(wait(p))
+        assert code == 5
+        assert ticks > 0
+        # already gone
+        assert asyncio.run(psutil.aio.wait(p)) == 5
+        self.assert_proc_gone(p)
+
+        p = self.spawn_psproc()
+        with pytest.raises(psutil.TimeoutExpired):
+            asyncio.run(psutil.aio.wait(p, 0.01))
+        with pytest.raises(psutil.TimeoutExpired):
+            asyncio.run(psutil.aio.wait(p, 0))
+        with pytest.raises(ValueError):
+            asyncio.run(psutil.aio.wait(p, -1))
+        p.terminate()
+        code, _ = asyncio.run(wait(p, GLOBAL_TIMEOUT))
+        if POSIX:
+            assert code == -signal.SIGTERM
+            # no pidfd: poll
+            p = self.spawn_psproc()
+            with mock.patch(
+                "psutil._psposix.can_use_pidfd_open", return_value=False
+            ) as m:
+                with pytest.raises(psutil.TimeoutExpired):
+                    asyncio.run(psutil.aio.wait(p, 0.01))
+                p.terminate()
+                code, _ = asyncio.run(wait(p, GLOBAL_TIMEOUT))
+            assert code == -signal.SIGTERM
+            assert m.called
 
     def test_wait_exited(self):
         # Test waitpid() + WIFEXITED -> WEXITSTATUS.
@@ -1884,6 +2014,114 @@ class TestProcessWait(PsutilTestCase):
                 wait_pid_kqueue(sproc.pid)
 
 
+# ===================================================================
+# --- psutil.ProcessTree tests
+# ===================================================================
+
+
+class TestProcessTree(PsutilTestCase):
+    # (pid, ppid, create_time, name)
+    ROWS = [
+        (1, 0, 1.0, "init"),
+        (10, 1, 5.0, "a"),
+        (11, 10, 6.0, "b"),
+        (12, 11, 7.0, "c"),
+        (20, 1, 5.0, "d"),
+        (21, 20, 4.0, "e"),  # created before its "parent": PID reused
+    ]
+
+    def make_tree(self, rows):
+        with mock.patch("psutil._proc_tree_scan", return_value=rows) as m:
+            tree = psutil.ProcessTree()
+            assert m.called
+        return tree
+
+    def assert_same_tree(self, t1, t2):
+        assert sorted(t1) == sorted(t2)
+        for pid in t1:
+            assert t1.ppid(pid) == t2.ppid(pid)
+            assert t1.name(pid) == t2.name(pid)
+            assert t1.parent(pid) == t2.parent(pid)
+            assert sorted(t1.children(pid)) == sorted(t2.children(pid))
+
+    def test_real(self):
+        child, grandchild = self.spawn_children_pair()
+        tree = psutil.ProcessTree()
+        me = os.getpid()
+        assert me in tree
+        assert len(tree) == len(tree.pids())
+        assert tree.ppid(me) == os.getppid()
+        assert tree.create_time(me) == psutil.Process().create_time()
+        assert psutil.Process().name().startswith(tree.name(me))
+        assert tree.children(me) == [child.pid]
+        assert tree.descendants(me) == [child.pid, grandchild.pid]
+        assert tree.ancestors(grandchild.pid)[:2] == [child.pid, me]
+        assert tree.ancestors(me) == [
+            x.pid for x in psutil.Process().parents()
+        ]
+        assert tree.parent(child.pid) == me
+
+    def test_queries(self):
+        tree = self.make_tree(self.ROWS)
+        assert tree.pids() == [1, 10, 11, 12, 20, 21]
+        assert tree.name(10) == "a"
+        assert tree.create_time(10) == 5.0
+        assert tree.children(1) == [10, 20]
+        assert tree.children(1, recursive=True) == [10, 20, 11, 12]
+        assert tree.descendants(10) == [11, 12]
+        assert tree.descendants(12) == []
+        assert tree.ancestors(12) == [11, 10, 1]
+        assert tree.ancestors(1) == []
+        assert tree.parent(1) is None
+        assert tree.parent(12) == 11
+        # PID reused: 21 is not a child of 20.
+        assert tree.ppid(21) == 20
+        assert tree.parent(21) is None
+        assert tree.children(20) == []
+        assert tree.roots() == [1, 21]
+        with pytest.raises(psutil.NoSuchProcess):
+            tree.children(99)
+        with pytest.raises(psutil.NoSuchProcess):
+            tree.name(99)
+
+    def test_subtree_totals(self):
+        tree = self.make_tree(self.ROWS)
+        values = {1: 1, 10: 10, 11: 100, 12: 1000, 21: 5}
+        totals = tree.subtree_totals(values)
+        assert totals == {1: 1111, 10: 1110, 11: 1100, 12: 1000, 20: 0, 21: 5}
+
+    def test_refresh(self):
+        tree = self.make_tree(self.ROWS)
+        rows = [
+            (1, 0, 1.0, "init"),
+            (10, 1, 5.0, "a2"),  # exec()
+            (11, 1, 6.0, "b"),  # reparented
+            (12, 11, 7.0, "c"),
+            (20, 1, 8.0, "d2"),  # PID reused: 21 is still an orphan
+            (22, 20, 9.0, "f"),  # new
+        ]
+        with mock.patch("psutil._proc_tree_scan", return_value=rows):
+            new = tree.refresh()
+        self.assert_same_tree(new, self.make_tree(rows))
+        assert sorted(new.children(1)) == [10, 11, 20]
+        assert new.children(20) == [22]
+        assert new.name(10) == "a2"
+        # The old snapshot is left untouched.
+        self.assert_same_tree(tree, self.make_tree(self.ROWS))
+
+        # Parent gone, then its PID reused by a process which adopts
+        # the old children.
+        rows = [(1, 0, 1.0, "init"), (11, 1, 6.0, "b"), (12, 11, 7.0, "c")]
+        with mock.patch("psutil._proc_tree_scan", return_value=rows):
+            new2 = new.refresh()
+        self.assert_same_tree(new2, self.make_tree(rows))
+        rows = [(1, 0, 1.0, "init"), (11, 1, 10.0, "x"), (12, 11, 7.0, "c")]
+        with mock.patch("psutil._proc_tree_scan", return_value=rows):
+            new3 = new2.refresh()
+        self.assert_same_tree(new3, self.make_tree(rows))
+        assert new3.parent(12) is None
+
+
 # ===================================================================
 # --- psutil.Popen tests
 # ===================================================================
@@ -388,6 +388,17 @@ class TestFetchAllProcesses(PsutilTestCase):
             for field in t:
                 assert isinstance(field, (int, float))
 
+    def threads_info(self, ret, info):
+        assert isinstance(ret, list)
+        for t in ret:
+            assert t.id >= 0
+            assert isinstance(t.name, str)
+            assert t.status in VALID_PROC_STATUSES
+            assert t.cpu_num >= 0
+            for field in t[4:]:
+                assert isinstance(field, (int, float))
+                assert field >= 0
+
     def cpu_times(self, ret, info):
         for n in ret:
             assert isinstance(n, float)
@@ -445,6 +456,13 @@ class TestFetchAllProcesses(PsutilTestCase):
         assert isinstance(ret, int)
         assert ret >= 0
 
+    def num_fds_by_kind(self, ret, info):
+        assert isinstance(ret, dict)
+        for kind, count in ret.items():
+            assert isinstance(kind, str)
+            assert isinstance(count, int)
+            assert count >= 0
+
     def net_connections(self, ret, info):
         assert len(ret) == len(set(ret))
         for conn in ret:
@@ -6,11 +6,14 @@
 
 """Tests for system APIS."""
 
+import asyncio
+import contextlib
 import datetime
 import enum
 import errno
 import os
 import pprint
+import re
 import shutil
 import signal
 import socket
@@ -20,6 +23,7 @@ import warnings
 from unittest import mock
 
 import psutil
+import psutil.aio
 from psutil import AIX
 from psutil import BSD
 from psutil import FREEBSD
@@ -47,8 +51,10 @@ from . import HAS_SENSORS_BATTERY
 from . import HAS_SENSORS_FANS
 from . import HAS_SENSORS_TEMPERATURES
 from . import MACOS_12PLUS
+from . import PYTHON_EXE
 from . import UNICODE_SUFFIX
 from . import PsutilTestCase
+from . import call_until
 from . import check_net_address
 from . import pytest
 from . import retry_on_failure
@@ -150,6 +156,64 @@ class TestProcessIter(PsutilTestCase):
                 assert p.memory_percent() is None
                 assert p.memory_info_ex() is None
 
+    def test_filters(self):
+        me = psutil.Process()
+        sproc = self.spawn_subproc()
+
+        def pids(**filters):
+            return [p.pid for p in psutil.process_iter(filters=filters)]
+
+        assert pids(ppid=me.pid) == [sproc.pid]
+        assert pids(ppid=me.pid, status=[psutil.STATUS_ZOMBIE]) == []
+        assert me.pid in pids(name=re.escape(me.name()))
+        assert me.pid not in pids(name="^$")
+        assert sproc.pid in pids(cmdline=re.escape(PYTHON_EXE))
+        assert me.pid in pids(min_rss=me.memory_info().rss // 2)
+        assert me.pid not in pids(min_rss=2**62)
+        if POSIX:
+            assert me.pid in pids(uids=[me.uids().real])
+            assert me.pid not in pids(uids=[me.uids().real + 1])
+            assert me.pid in pids(uids=[me.username()])
+        # filters + attrs
+        procs = list(
+            psutil.process_iter(attrs=["ppid"], filters={"ppid": me.pid})
+        )
+        assert [p.ppid() for p in procs] == [me.pid]
+        with pytest.raises(ValueError, match="invalid filter"):
+            pids(foo=1)
+
+    @skipif(not POSIX, reason="POSIX only")
+    def test_filters_long_name(self):
+        # The name is truncated to 15 chars by the kernel: the filter
+        # matches the full name only, same as Process.name().
+        exe = os.path.join(self.get_testfn(), "abcdefghijklmnopqrs")
+        os.mkdir(os.path.dirname(exe))
+        shutil.copyfile(shutil.which("sleep"), exe)
+        os.chmod(exe, 0o755)
+        sproc = self.spawn_subproc([exe, "60"])
+        call_until(lambda: psutil.Process(sproc.pid).cmdline())
+        assert psutil.Process(sproc.pid).name() == "abcdefghijklmnopqrs"
+
+        def pids(name):
+            filters = {"name": name, "ppid": os.getpid()}
+            return [p.pid for p in psutil.process_iter(filters=filters)]
+
+        assert pids("^abcdefghijklmnopqrs$") == [sproc.pid]
+        assert pids("^abcdefghijklmno$") == []
+        assert pids("^abcdefghijklmno") == [sproc.pid]
+
+    def test_prefetch_shares_system_values(self):
+        # cpu_count() is retrieved once per process_iter() pass and
+        # not once per process.
+        with mock.patch("psutil.cpu_count", return_value=4) as m:
+            procs = list(psutil.process_iter(attrs=["cpu_percent"]))
+            assert len(procs) > 1
+            assert m.call_count == 1
+            # ...but not while the caller uses the process
+            procs[0].cpu_percent(interval=None)
+            procs[0].cpu_percent(interval=None)
+            assert m.call_count == 3
+
     @skipif(not POSIX, reason="POSIX only")
     def test_prefetch_derived_username(self):
         # username() derives from uids(), which is POSIX only.
@@ -231,6 +295,67 @@ class TestProcessIter(PsutilTestCase):
             assert p.status()
             break
 
+    def test_cache_denied(self):
+        def scan(**kwargs):
+            with mock.patch(
+                "psutil._psplatform.Process.cpu_times",
+                side_effect=psutil.AccessDenied(0, ""),
+            ) as m:
+                for p in psutil.process_iter(
+                    attrs=["pid", "cpu_times"], ad_value=flag, **kwargs
+                ):
+                    assert p.cpu_times() is flag
+            return m.call_count
+
+        flag = object()
+        psutil.process_iter.cache_clear()
+        assert scan(cache_denied=True) > 0
+        # AccessDenied is remembered: cpu_times() is not retried.
+        assert scan(cache_denied=True) == 0
+        # ...unless not asked to.
+        assert scan() > 0
+        assert scan(cache_denied=True) > 0
+
+    def test_cache_denied_pid_reused(self):
+        list(psutil.process_iter(attrs=["name"], cache_denied=True))
+        p = psutil._pmap[os.getpid()]
+        p._denied.add("name")
+        p._ident = (p.pid, p._ident[1] - 1)  # emulate PID reuse
+        for x in psutil.process_iter(attrs=["name"], cache_denied=True):
+            if x.pid == os.getpid():
+                assert x is not p
+                assert x.name() == psutil.Process().name()
+                break
+        else:
+            pytest.fail("process not found")
+
+    @skipif(
+        not hasattr(psutil._psplatform, "pid_idents"), reason="not supported"
+    )
+    def test_cache_denied_gone_during_scan(self):
+        # A cached process with denied methods exits after pids() and
+        # is missing from the pid_idents() scan: it's skipped.
+        list(psutil.process_iter(attrs=["name"], cache_denied=True))
+        p = psutil._pmap[os.getpid()]
+        p._denied.add("name")
+        p._ident = (p.pid, p._ident[1] - 1)  # not running anymore
+        # Many new PIDs, so that pid_idents() is used.
+        psutil._pmap = {p.pid: p}
+        idents = psutil._psplatform.pid_idents()
+        del idents[p.pid]
+        with mock.patch.object(
+            psutil._psplatform, "pid_idents", return_value=idents
+        ):
+            pids = [
+                x.pid
+                for x in psutil.process_iter(
+                    attrs=["name"], cache_denied=True
+                )
+            ]
+        assert len(pids) > 1
+        assert p.pid not in pids
+        assert p.pid not in psutil._pmap
+
     def test_zombie_process_is_not_skipped(self):
         # ZombieProcess is a subclass of NoSuchProcess; make sure
         # process_iter() yields the process rather than removing it from
@@ -243,12 +368,45 @@ class TestProcessIter(PsutilTestCase):
             pids = [x.pid for x in psutil.process_iter(attrs=["name"])]
         assert p.pid in pids
 
+    def test_aio(self):
+        async def collect():
+            return [p async for p in psutil.aio.process_iter(chunksize=2)]
+
+        assert asyncio.run(collect()) == list(psutil.process_iter())
+        with pytest.raises(ValueError):
+            asyncio.run(psutil.aio.process_iter(chunksize=0).__anext__())
+
     def test_cache_clear(self):
         list(psutil.process_iter())  # populate cache
         assert psutil._pmap
         psutil.process_iter.cache_clear()
         assert not psutil._pmap
 
+    def test_lightweight_instances(self):
+        p = psutil.Process._from_ident(*psutil.Process()._ident)
+        assert "_proc" not in p.__dict__
+        assert "_lock" not in p.__dict__
+        assert p == psutil.Process()
+        assert hash(p) == hash(psutil.Process())
+        assert p.is_running()
+        assert p.name() == psutil.Process().name()
+        assert "_proc" in p.__dict__
+        assert p.as_dict(["pid"]) == {"pid": os.getpid()}
+        assert "_lock" in p.__dict__
+
+    @skipif(not LINUX, reason="LINUX only")
+    def test_lightweight_instances_cached(self):
+        psutil.process_iter.cache_clear()
+        for p in psutil.process_iter():
+            if p.pid == os.getpid():
+                break
+        assert "_proc" not in p.__dict__
+        assert p == psutil.Process()
+        assert p.cmdline() == psutil.Process().cmdline()
+        # Reused PIDs are still detected.
+        p._ident = (p.pid, p._ident[1] - 1)
+        assert not p.is_running()
+
 
 class TestProcessAPIs(PsutilTestCase):
     def test_wait_procs(self):
@@ -345,6 +503,66 @@ class TestProcessAPIs(PsutilTestCase):
 
 
 class TestMiscAPIs(PsutilTestCase):
+    def test_top_processes(self):
+        me = psutil.Process()
+        top = psutil.top_processes("rss", n=5)
+        assert 0 < len(top) <= 5
+        values = [value for _, value in top]
+        assert values == sorted(values, reverse=True)
+        for proc, value in top:
+            assert isinstance(proc, psutil.Process)
+            assert value >= 0
+        # the biggest one is at least as big as us
+        assert values[0] >= me.memory_info().rss // 2
+        assert len(psutil.top_processes("cpu", n=10**6)) > 1
+        assert psutil.top_processes("cpu", n=0) == []
+        # delta
+        top = psutil.top_processes("cpu", n=3, interval=0.01)
+        assert all(value >= 0 for _, value in top)
+        with pytest.raises(ValueError):
+            psutil.top_processes("foo")
+        with pytest.raises(ValueError):
+            psutil.top_processes("cpu", interval=-1)
+
+    def test_top_processes_pid_reused(self):
+        # The PID of a sampled process got reused before the Process
+        # instance was created: the instance refers to the old one.
+        me = psutil.Process()
+        ctime = me._ident[1] - 10
+        with mock.patch.object(
+            psutil, "_top_pids", return_value=[(me.pid, ctime, 100)]
+        ):
+            [(proc, value)] = psutil.top_processes("rss", n=1)
+        assert proc.pid == me.pid
+        assert value == 100
+        assert not proc.is_running()
+        assert proc != me
+
+    def test_process_rollup(self):
+        me = psutil.Process()
+        by_name = psutil.process_rollup("name")
+        # the kernel truncates names to 15 chars on Linux
+        group = by_name[me.name()[:15] if LINUX else me.name()]
+        assert isinstance(group, psutil._ntuples.sprocgroup)
+        assert group.count >= 1
+        assert group.rss >= me.memory_info().rss // 2
+        assert group.pss is None
+        assert group.num_threads >= 1
+        assert group.cpu_time > 0
+        # the number of processes is about the same
+        total = sum(x.count for x in by_name.values())
+        assert abs(total - len(psutil.pids())) < 10
+        if POSIX:
+            by_uid = psutil.process_rollup("uid")
+            assert me.uids().real in by_uid
+            assert abs(sum(x.count for x in by_uid.values()) - total) < 10
+        if LINUX:
+            by_cgroup = psutil.process_rollup("cgroup", pss=True)
+            assert all(isinstance(k, str) for k in by_cgroup)
+            assert any(x.pss for x in by_cgroup.values())
+        with pytest.raises(ValueError):
+            psutil.process_rollup("foo")
+
     def test_boot_time(self):
         bt = psutil.boot_time()
         assert isinstance(bt, float)
@@ -679,6 +897,14 @@ class TestCpuAPIs(PsutilTestCase):
         with pytest.raises(ValueError):
             psutil.cpu_percent(interval=-1)
 
+    def test_aio_cpu_percent(self):
+        percent = asyncio.run(psutil.aio.cpu_percent(0.01))
+        self._test_cpu_percent(percent, None, None)
+        ls = asyncio.run(psutil.aio.cpu_percent(0.01, percpu=True))
+        assert len(ls) == psutil.cpu_count()
+        with pytest.raises(ValueError):
+            asyncio.run(psutil.aio.cpu_percent(-1))
+
     def test_per_cpu_percent(self):
         last = psutil.cpu_percent(interval=0.001, percpu=True)
         assert len(last) == psutil.cpu_count()
@@ -822,6 +1048,43 @@ class TestDiskAPIs(PsutilTestCase):
     def test_disk_usage_bytes(self):
         psutil.disk_usage(b'.')
 
+    @skipif(not POSIX, reason="POSIX only")
+    def test_disk_usage_many(self):
+        fname = self.get_testfn()
+        paths = [os.getcwd(), fname, __file__]
+        ret = psutil.disk_usage_many(paths, timeout=5)
+        assert list(ret) == paths
+        usage = ret[os.getcwd()]
+        usage2 = psutil.disk_usage(os.getcwd())
+        tolerance = 5 * 1024 * 1024  # 5MB
+        assert usage.total == usage2.total
+        assert abs(usage.free - usage2.free) < tolerance
+        assert abs(usage.used - usage2.used) < tolerance
+        st = os.statvfs(os.getcwd())
+        assert usage.inodes_total == st.f_files
+        assert usage.inodes_used + usage.inodes_free <= st.f_files
+        assert 0 <= usage.inodes_percent <= 100
+        assert isinstance(ret[fname], FileNotFoundError)
+        assert ret[fname].filename == fname
+        assert ret[__file__].total == usage.total
+        # default: all mount points
+        mountpoints = [x.mountpoint for x in psutil.disk_partitions()]
+        assert list(psutil.disk_usage_many(timeout=5)) == mountpoints
+        assert psutil.disk_usage_many([]) == {}
+        with pytest.raises(ValueError):
+            psutil.disk_usage_many(paths, timeout=-1)
+
+    @skipif(not POSIX, reason="POSIX only")
+    def test_disk_usage_many_timeout(self):
+        # A hung mount can't be emulated, so fake the C result.
+        with mock.patch.object(
+            _psutil, "disk_usage_many", return_value=[None]
+        ) as m:
+            ret = psutil.disk_usage_many(["/"], timeout=0.5)
+            assert m.called
+        assert isinstance(ret["/"], psutil.TimeoutExpired)
+        assert ret["/"].seconds == 0.5
+
     def test_disk_partitions(self):
         def check_ntuple(nt):
             assert isinstance(nt.device, str)
@@ -966,9 +1229,27 @@ class TestNetAPIs(PsutilTestCase):
             assert psutil.net_io_counters(pernic=True) == {}
             assert m.called
 
+    @skipif(not HAS_NET_IO_COUNTERS, reason="not supported")
+    def test_net_io_counters_filters(self):
+        nics = psutil.net_io_counters(pernic=True, nowrap=False)
+        name = next(iter(nics))
+        ret = psutil.net_io_counters(pernic=True, prefix=name[:2])
+        assert set(ret) == {x for x in nics if x.startswith(name[:2])}
+        ret = psutil.net_io_counters(pernic=True, prefix="?!?")
+        assert ret == {}
+        assert psutil.net_io_counters(prefix="?!?") is None
+        try:
+            ifindex = socket.if_nametoindex(name)
+        except OSError:
+            return pytest.skip(f"can't get {name!r} index")
+        ret = psutil.net_io_counters(pernic=True, ifindex=ifindex)
+        assert list(ret) == [name]
+        assert psutil.net_io_counters(pernic=True, ifindex=2**31 - 1) == {}
+
     def test_net_if_addrs(self):
         nics = psutil.net_if_addrs()
         assert nics, nics
+        assert psutil.net_if_addrs(cached=True) == nics
 
         nic_stats = psutil.net_if_stats()
 
@@ -1089,11 +1370,24 @@ class TestNetAPIs(PsutilTestCase):
     )
     def test_net_if_stats_enodev(self):
         # See: https://github.com/giampaolo/psutil/issues/1279
-        with mock.patch.object(
-            _psutil,
-            'net_if_mtu',
-            side_effect=OSError(errno.ENODEV, ""),
-        ) as m:
+        with contextlib.ExitStack() as stack:
+            if LINUX:
+                # Per-NIC ioctls are only used if netlink is not
+                # available.
+                stack.enter_context(
+                    mock.patch.object(
+                        _psutil,
+                        'net_if_stats_netlink',
+                        side_effect=PermissionError,
+                    )
+                )
+            m = stack.enter_context(
+                mock.patch.object(
+                    _psutil,
+                    'net_if_mtu',
+                    side_effect=OSError(errno.ENODEV, ""),
+                )
+            )
             ret = psutil.net_if_stats()
             assert ret == {}
             assert m.called
@@ -52,6 +52,7 @@ from . import unix_socketpair
 from . import wait_for_file
 from . import wait_for_file_subproc
 from . import wait_for_pid
+from . import write_tree
 
 # ===================================================================
 # --- Unit tests for test utilities.
@@ -236,6 +237,17 @@ class TestFSTestUtils(PsutilTestCase):
             assert os.getcwd() == os.path.join(base, testfn)
         assert os.getcwd() == base
 
+    def test_write_tree(self):
+        root = write_tree(self.get_testfn(), {"a": "1", "b/c/d": b"2"})
+        with open(os.path.join(root, "a")) as f:
+            assert f.read() == "1"
+        with open(os.path.join(root, "b", "c", "d"), "rb") as f:
+            assert f.read() == b"2"
+        # existing dirs are fine
+        write_tree(root, {"b/e": b"", "b/f": None})
+        assert sorted(os.listdir(os.path.join(root, "b"))) == ["c", "e", "f"]
+        assert os.path.isdir(os.path.join(root, "b", "f"))
+
 
 class TestPythonExeEnv(PsutilTestCase):
     def test_subprocess_imports_our_psutil(self):